@@ -8,7 +8,6 @@ int main()
   SConfig config = {};
   SWorldCore world = wc_empty();
   SCollision collision = {};
-  STeeGrid tee_grid = {};
 
   map_data_t map = load_map("maps/tinycave.map");
   if(!map._map_file_data)
@@ -24,8 +23,7 @@ int main()
   }
 
   init_config(&config);
-  tg_init(&tee_grid, collision.m_MapData.width, collision.m_MapData.height);
-  wc_init(&world, &collision, &tee_grid, &config);
+  wc_init(&world, &collision, &config);
 
   if(!wc_add_character(&world, 1))
   {
@@ -56,6 +54,5 @@ int main()
   }
 
   wc_free(&world);
-  tg_destroy(&tee_grid);
   free_collision(&collision);
 }
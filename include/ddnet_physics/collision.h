@@ -20,6 +20,7 @@ extern "C" {
 #endif
 #include "stdbool.h"
 #include "vmath.h"
+#include <stddef.h>
 #include <stdint.h>
 
 enum {
@@ -36,6 +37,9 @@ enum {
 #define PHYSICALSIZEVEC vec2_init(28.f, 28.f)
 #define MAP_EXPAND 200
 #define MAP_EXPAND32 (200*32)
+// Only this many tiles of the MAP_EXPAND border are stored on each side of the map, the lookups of SCollision send the tiles further out
+// to the stored ones holding the same tiles. The outermost stored ring stands in for the outermost ring of the border alone.
+#define MAP_EXPAND_STORED 4
 
 enum {
   INFO_ISSOLID = 1 << 0,
@@ -47,6 +51,47 @@ enum {
   INFO_CANHITSTOPPER = 1 << 6,
 };
 
+// Bits of SCollision.m_pTileActions, one per effect cc_handle_tiles and cc_handle_skippable_tiles can have on a tee. A tile only gets
+// the bits of the effects that can happen there, so the tee handlers skip everything else without looking at the layers.
+enum {
+  // a tele checkpoint or a teleporter a tee can walk into
+  ACTION_TELE,
+  ACTION_SWITCH,
+  ACTION_HITKILL,
+  ACTION_SPEEDUP,
+  // tiles of the game or front layer in the order cc_handle_tiles handles them. The second tile of an enable/disable pair is left out
+  // where the first one always wins.
+  ACTION_START,
+  ACTION_FINISH,
+  ACTION_FREEZE,
+  ACTION_UNFREEZE,
+  ACTION_DFREEZE,
+  ACTION_DUNFREEZE,
+  ACTION_LFREEZE,
+  ACTION_LUNFREEZE,
+  ACTION_EHOOK_ENABLE,
+  ACTION_EHOOK_DISABLE,
+  ACTION_HIT_DISABLE,
+  ACTION_HIT_ENABLE,
+  ACTION_NPC_DISABLE,
+  ACTION_NPC_ENABLE,
+  ACTION_NPH_DISABLE,
+  ACTION_NPH_ENABLE,
+  ACTION_UNLIMITED_JUMPS_ENABLE,
+  ACTION_UNLIMITED_JUMPS_DISABLE,
+  ACTION_WALLJUMP,
+  ACTION_JETPACK_ENABLE,
+  ACTION_JETPACK_DISABLE,
+  ACTION_REFILL_JUMPS,
+  ACTION_TELE_GUN_ENABLE,
+  ACTION_TELE_GUN_DISABLE,
+  ACTION_TELE_GRENADE_ENABLE,
+  ACTION_TELE_GRENADE_DISABLE,
+  ACTION_TELE_LASER_ENABLE,
+  ACTION_TELE_LASER_DISABLE,
+  NUM_ACTIONS,
+};
+
 typedef struct TuningParams {
 #define MACRO_TUNING_PARAM(Name, Value) float m_##Name;
 #include <ddnet_physics/tuning.h>
@@ -70,23 +115,115 @@ typedef struct Pickup {
   uint8_t m_Subtype;
 } SPickup;
 
+// Everything a speedup tile does to a tee, the direction is the one get_speedup used to compute from the angle every tick. 16 bytes,
+// so a record never straddles two cache lines.
+typedef struct Speedup {
+  float m_aDirection[2];
+  uint8_t m_Force;
+  uint8_t m_MaxSpeed;
+  uint8_t m_Type;
+  uint8_t m_aPadding[5];
+} SSpeedup;
+
 enum {
   NUM_TUNE_ZONES = 256,
-  DISTANCE_FIELD_RESOLUTION = 32,
 };
 
+enum {
+  BROAD_SOLID,
+  BROAD_INDICES,
+  BROAD_TELE_IN,
+  NUM_BROAD_LAYERS,
+  BROAD_MAX_LEVELS = 16,
+};
+
+enum {
+  // one uint64 per tile and layer with a bit for every rectangle up to 8x8 tiles starting there, 8 bytes per tile and layer
+  BROAD_BACKEND_BITFIELDS,
+  // one bit per tile and layer, rectangles up to 8x8 OR together at most 8 rows of them, 1/64 of the memory
+  BROAD_BACKEND_COMPACT,
+};
+
+// How init_collision_backend allocates and lays out the tables of one collision, init_collision uses COLLISION_ALLOC_HUGE_PAGES.
+enum {
+  // tables of at least 2 MiB are aligned to 2 MiB and advised to be backed by transparent huge pages, random reads of move_box and
+  // the broad checks then miss the TLB far less often
+  COLLISION_ALLOC_HUGE_PAGES = 1 << 0,
+  // the layers and tile tables read through map_index store 8x8 tile blocks one after another instead of whole rows, a tile and its
+  // vertical neighbours usually share a cache line
+  COLLISION_ALLOC_BLOCKED_TILES = 1 << 1,
+};
+
+// Precompute stages of init_collision, in the order they run. Their wall times end up in SCollision.m_aInitTimes.
+enum {
+  INIT_STAGE_EXPAND,
+  INIT_STAGE_TILES,
+  INIT_STAGE_NEIGHBOURS,
+  INIT_STAGE_DISTANCE_FIELD,
+  INIT_STAGE_BROAD,
+  INIT_STAGE_PYRAMIDS,
+  INIT_STAGE_SPAWNS,
+  INIT_STAGE_TILE_ACTIONS,
+  INIT_STAGE_TILE_BLOCKS,
+  NUM_INIT_STAGES,
+};
+
+// Occupancy pyramid of one broad layer for rectangles that don't fit the 8x8 bit fields. Level 0 has one byte per tile and every
+// level above ORs 2x2 cells of the one below, so a cell of level k covers an aligned block of 2^k x 2^k tiles.
+typedef struct BroadPyramid {
+  uint8_t *m_apLevels[BROAD_MAX_LEVELS];
+  int m_aWidth[BROAD_MAX_LEVELS];
+  int m_aHeight[BROAD_MAX_LEVELS];
+  int m_NumLevels;
+} SBroadPyramid;
+
+// Bytes used by each derived table of an SCollision, see collision_memory().
+typedef struct CollisionMemory {
+  size_t m_MapLayers;
+  size_t m_WidthLookup;
+  size_t m_TileInfos;
+  size_t m_TileActions;
+  size_t m_TileBroadCheck;
+  size_t m_MoveRestrictions;
+  size_t m_Pickups;
+  size_t m_Speedups;
+  size_t m_DistanceField;
+  size_t m_BroadBitFields;
+  size_t m_BroadBits;
+  size_t m_BroadPyramids;
+  size_t m_Total;
+} SCollisionMemory;
+
 typedef struct Collision {
+  // width and height are those of the map with the MAP_EXPAND border, the layers only hold m_TableWidth x m_TableHeight tiles. This broke
+  // the old layout where both matched: indexing a layer with y * width + x reads past it, go through map_index() or use m_TableWidth.
   map_data_t m_MapData;
+  // map row -> row part of the tile index, map row -> stored row, map column -> stored column and map column -> column part of the
+  // tile index. Row-major the parts are the stored row * m_TableWidth and the stored column.
   uint32_t *m_pWidthLookup;
+  uint32_t *m_pRowLookup;
+  uint32_t *m_pColumnLookup;
+  uint32_t *m_pColumnIndexLookup;
   uint64_t *m_pBroadSolidBitField;
   uint64_t *m_pBroadIndicesBitField;
   uint8_t *m_pTileInfos;
+  // one bit per ACTION_* for every tile
+  uint32_t *m_pTileActions;
   SPickup *m_pPickups;
   SPickup *m_pFrontPickups;
+  // only there if the map has a speedup layer
+  SSpeedup *m_pSpeedups;
   uint8_t (*m_pMoveRestrictions)[5];
   uint8_t *m_pTileBroadCheck;
   uint8_t *m_pSolidTeleDistanceField;
   uint64_t *m_pBroadTeleInBitField;
+  // compact backend, one bit per tile with m_BroadBitsStride words per row and a spare word at the end of each row
+  uint64_t *m_apBroadBits[NUM_BROAD_LAYERS];
+  int m_BroadBitsStride;
+  int m_BroadBackend;
+  // COLLISION_ALLOC_* flags the tables were allocated with
+  int m_AllocPolicy;
+  SBroadPyramid m_aBroadPyramids[NUM_BROAD_LAYERS];
   mvec2 *m_apTeleOuts[256];
   mvec2 *m_apTeleCheckOuts[256];
   mvec2 *m_pSpawnPoints;
@@ -97,11 +234,35 @@ typedef struct Collision {
   STuningParams m_aTuningList[NUM_TUNE_ZONES];
 
   int m_HighestSwitchNumber;
+  int m_TableWidth;
+  int m_TableHeight;
+  // seconds each INIT_STAGE_* took
+  double m_aInitTimes[NUM_INIT_STAGES];
+  // read-only mapping of the collision cache file or the replica all tables point into, see load_collision_cache() and
+  // replicate_collision()
+  void *m_pCache;
+  size_t m_CacheSize;
 
   bool m_MoveRestrictionsFound;
+  bool m_BlockedTiles;
 } SCollision;
 
+// Index into the tile tables and layers of the tile at x, y in map coordinates.
+static inline int map_index(const SCollision *pCollision, int x, int y) {
+  return pCollision->m_pWidthLookup[y] + pCollision->m_pColumnIndexLookup[x];
+}
+
+// both take over the layers of pMap, a failed init frees them along with everything it allocated
 bool init_collision(SCollision *__restrict__ pCollision, map_data_t *__restrict__ pMap);
+bool init_collision_backend(SCollision *__restrict__ pCollision, map_data_t *__restrict__ pMap, int BroadBackend, int AllocPolicy);
+void collision_memory(const SCollision *pCollision, SCollisionMemory *pOut);
+// Write every table of an initialized collision to one file. Loading it maps the file read-only instead of running init_collision, the
+// pages are shared by all processes that load the same file. A cache only fits the build of the library that wrote it.
+bool save_collision_cache(const SCollision *pCollision, const char *pPath);
+bool load_collision_cache(SCollision *pCollision, const char *pPath);
+// Copy every table of pCollision into one read-only block owned by pReplica. The pages are placed on the NUMA node of the calling
+// thread, a replica per node lets every worker read a node-local copy.
+bool replicate_collision(SCollision *pReplica, const SCollision *pCollision);
 void free_collision(SCollision *pCollision);
 int get_pure_map_index(SCollision *pCollision, mvec2 Pos);
 unsigned char move_restrictions(unsigned char Direction, unsigned char Tile, unsigned char Flags);
@@ -140,11 +301,82 @@ bool intersect_line(SCollision *__restrict__ pCollision, mvec2 Pos0, mvec2 Pos1,
                     mvec2 *__restrict__ pOutBeforeCollision);
 void move_box(const SCollision *__restrict__ pCollision, mvec2 Pos, mvec2 Vel, mvec2 *__restrict__ pOutPos, mvec2 *__restrict__ pOutVel,
               mvec2 Elasticity, bool *__restrict__ pGrounded);
+
+#define MOVE_BOX_LANES 8
+
+// Arguments of MOVE_BOX_LANES move_box calls in SoA form, positions and velocities are moved in place.
+typedef struct MoveBoxLanes {
+  float m_aPosX[MOVE_BOX_LANES];
+  float m_aPosY[MOVE_BOX_LANES];
+  float m_aVelX[MOVE_BOX_LANES];
+  float m_aVelY[MOVE_BOX_LANES];
+  float m_aElasticityX[MOVE_BOX_LANES];
+  float m_aElasticityY[MOVE_BOX_LANES];
+  // only ever set, like the pGrounded of move_box
+  bool m_aGrounded[MOVE_BOX_LANES];
+} SMoveBoxLanes;
+
+// move_box for every lane whose bit is set in LaneMask, with AVX2. The results are exactly those of move_box, the other lanes are left
+// alone.
+void move_box_x8(const SCollision *__restrict__ pCollision, SMoveBoxLanes *__restrict__ pLanes, int LaneMask);
+
+#define HOOK_RAY_LANES 8
+
+// Arguments and results of HOOK_RAY_LANES intersect_line_tele_hook calls in SoA form. The tele number is only looked for on maps with a
+// tele layer and stays 0 unless the ray ends in a hook teleporter.
+typedef struct HookRayLanes {
+  float m_aFromX[HOOK_RAY_LANES];
+  float m_aFromY[HOOK_RAY_LANES];
+  float m_aToX[HOOK_RAY_LANES];
+  float m_aToY[HOOK_RAY_LANES];
+  float m_aOutX[HOOK_RAY_LANES];
+  float m_aOutY[HOOK_RAY_LANES];
+  unsigned char m_aHit[HOOK_RAY_LANES];
+  unsigned char m_aTeleNr[HOOK_RAY_LANES];
+} SHookRayLanes;
+
+// intersect_line_tele_hook for every lane whose bit is set in LaneMask. The tile rectangles of all rays are found together with AVX2,
+// only the rays whose rectangle holds a solid or hook teleporter tile walk their tiles.
+void intersect_line_tele_hook_x8(SCollision *__restrict__ pCollision, SHookRayLanes *__restrict__ pRays, int LaneMask);
 bool get_nearest_air_pos_player(SCollision *pCollision, mvec2 PlayerPos, mvec2 *pOutPos);
 bool get_nearest_air_pos(SCollision *pCollision, mvec2 Pos, mvec2 PrevPos, mvec2 *pOutPos);
 int get_index(SCollision *pCollision, mvec2 PrevPos, mvec2 Pos);
 unsigned char mover_speed(SCollision *pCollision, int x, int y, mvec2 *pSpeed);
 int entity(SCollision *pCollision, int x, int y, int Layer);
+bool broad_pyramid_check(const SCollision *pCollision, int Layer, int MinX, int MinY, int MaxX, int MaxY);
+
+// Is any tile of the broad layer inside the rectangle, corners in stored tiles and inclusive.
+static inline bool broad_table_rect_check(const SCollision *pCollision, int Layer, int MinX, int MinY, int MaxX, int MaxY) {
+  const int DiffX = MaxX - MinX;
+  const int DiffY = MaxY - MinY;
+  if (DiffX > 7 || DiffY > 7)
+    return broad_pyramid_check(pCollision, Layer, MinX, MinY, MaxX, MaxY);
+
+  if (pCollision->m_BroadBackend == BROAD_BACKEND_COMPACT) {
+    const int Stride = pCollision->m_BroadBitsStride;
+    const uint64_t *pRow = pCollision->m_apBroadBits[Layer] + (size_t)MinY * Stride + (MinX >> 6);
+    const int Shift = MinX & 63;
+    const uint64_t Mask = ((uint64_t)2 << DiffX) - 1;
+    for (int y = 0; y <= DiffY; ++y, pRow += Stride) {
+      // the spare word per row keeps pRow[1] in bounds, the split shift keeps Shift == 0 defined
+      const uint64_t Bits = (pRow[0] >> Shift) | ((pRow[1] << 1) << (63 - Shift));
+      if (Bits & Mask)
+        return true;
+    }
+    return false;
+  }
+
+  const uint64_t *pBitField = Layer == BROAD_SOLID     ? pCollision->m_pBroadSolidBitField
+                              : Layer == BROAD_INDICES ? pCollision->m_pBroadIndicesBitField
+                                                       : pCollision->m_pBroadTeleInBitField;
+  return pBitField[MinY * pCollision->m_TableWidth + MinX] & (uint64_t)1 << ((DiffY << 3) + DiffX);
+}
+
+// Same for corners in map coordinates inside the map. The lookups keep every stored tile between the corners, so the answer is exact.
+static inline bool broad_rect_check(const SCollision *pCollision, int Layer, int MinX, int MinY, int MaxX, int MaxY) {
+  return broad_table_rect_check(pCollision, Layer, pCollision->m_pColumnLookup[MinX], pCollision->m_pRowLookup[MinY],
+                                pCollision->m_pColumnLookup[MaxX], pCollision->m_pRowLookup[MaxY]);
+}
 
 #ifdef __cplusplus
 }
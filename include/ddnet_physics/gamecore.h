@@ -169,6 +169,8 @@ typedef struct Projectile {
   int m_Owner;
   int m_Type;
   int m_StartTick;
+  // first tick that has to test the flight segment against solid tiles, all ticks before it are known to be free
+  int m_ImpactTick;
   int m_Bouncing;
   bool m_Explosive;
   bool m_Freeze;
@@ -304,18 +306,63 @@ typedef struct {
   uint32_t m_Tile;  // Grid Child index. always exists
 } STeeLink;
 
-// global struct
+// maps an occupied tile to the first tee of its chain
 typedef struct {
-  int *m_pTeeGrid; // array for the whole map
-  uint64_t hash;
-} STeeGrid;
+  int32_t m_Tile; // -1 means the cell is empty
+  int32_t m_Head;
+} STeeCell;
+
+// open addressing hash of the occupied tiles, sized by the number of tees instead of the map
+typedef struct {
+  STeeCell *m_pCells;
+  uint32_t m_CellMask; // number of cells - 1. the number of cells is a power of two
+  int m_NumUsed;
+} STeeHash;
+
+enum { TEE_ACCELERATOR_MAX_MOVED = 16 };
 
 typedef struct {
-  STeeGrid *m_pGrid;
   STeeLink *m_pTeeList; // array of tees (world specific)
-  uint64_t hash;        // hash to compare between tee grid world changes
+  STeeHash m_Heads;     // first link of every occupied tile
+
+  // index for hit queries (projectiles, lasers, explosions, hammer). built from the current positions when needed, dropped once tees move
+  STeeHash m_Query;
+  int32_t *m_pQueryNext; // next tee in the same tile, per tee
+  int m_QueryCapacity;
+  bool m_QueryValid;
+  int m_NumMoved; // tees that moved after the index was built (ninja, teleports, deaths). queries check them separately
+  int32_t m_aMoved[TEE_ACCELERATOR_MAX_MOVED];
 } STeeAccelerator;
 
+// Entity pool {{{
+
+// every entity slot is big enough for any entity type
+typedef union EntitySlot {
+  SEntity m_Base;
+  SProjectile m_Projectile;
+  SLaser m_Laser;
+  union EntitySlot *m_pNextFree;
+} SEntitySlot;
+
+enum { ENTITY_CHUNK_SIZE = 64 };
+
+typedef struct EntityChunk {
+  struct EntityChunk *m_pNext;
+  SEntitySlot m_aSlots[ENTITY_CHUNK_SIZE];
+} SEntityChunk;
+
+// Slab pool per world. Chunks are never given back until wc_free, a reset just rewinds the bump pointer to the first chunk
+typedef struct {
+  SEntityChunk *m_pFirstChunk;
+  SEntityChunk *m_pChunk; // chunk the bump pointer is in
+  int m_ChunkIdx;         // index of m_pChunk in the chain
+  int m_NumBumped;        // used slots in m_pChunk
+  int m_NumFixedChunks;   // leading chunks that live in the flat world block and aren't freed with the pool
+  SEntitySlot *m_pFree;
+} SEntityPool;
+
+// }}}
+
 // We don't want teams for the physics, that makes switches easier
 typedef struct {
   bool m_Status;
@@ -336,6 +383,7 @@ typedef struct WorldCore {
 
   SEntity *m_pNextTraverseEntity;
   SEntity *m_apFirstEntityTypes[NUM_WORLD_ENTTYPES];
+  SEntityPool m_EntityPool;
 
   // Store and tick characters seperately from other entities since
   // the amount of players mostly only gets set once for simulations
@@ -348,18 +396,50 @@ typedef struct WorldCore {
   SSwitch *m_pSwitches;
 
   int m_GameTick;
+
+  // opt-in flat storage, see wc_flatten. characters, tee links, switches and the fixed entity chunks all live in this block
+  void *m_pFlatBlock;
+  size_t m_FlatSize;
 } SWorldCore;
 
-// }}}
+// events that end wc_tick_n after the tick they happen in
+enum { TICK_STOP_FINISH = 1 << 0, TICK_STOP_DEATH = 1 << 1 };
+
+// What wc_tick_n writes, every array holds one entry per tick and character at Tick * NumCharacters + Character. Null arrays aren't
+// written.
+typedef struct {
+  float *m_pPosX;
+  float *m_pPosY;
+  float *m_pVelX;
+  float *m_pVelY;
+  int8_t *m_pHookState;
+  // TICK_STOP_* flags to stop at
+  int m_StopOn;
+  // set by wc_tick_n, the event it stopped at or 0 and the character that caused it
+  int m_Stopped;
+  int m_StoppedCharacter;
+} STickTrace;
 
-STeeGrid tg_empty(void);
-void tg_init(STeeGrid *pGrid, int width, int height);
-void tg_destroy(STeeGrid *pGrid);
+// }}}
 
 void init_config(SConfig *pConfig);
-void wc_init(SWorldCore *pCore, SCollision *pCollision, STeeGrid *pGrid, SConfig *pConfig);
+void wc_init(SWorldCore *pCore, SCollision *pCollision, SConfig *pConfig);
 void wc_copy_world(SWorldCore *__restrict__ pTo, SWorldCore *__restrict__ pFrom);
+// Moves all mutable state of the world into one block with room for MaxEntities entities (more still work but live outside of it).
+// Copying a flat world into another one is then a single memcpy plus fixing up the pointers of the live objects. The number of characters
+// can't change anymore after this.
+bool wc_flatten(SWorldCore *pWorld, int MaxEntities);
 void wc_tick(SWorldCore *pCore);
+// same as calling wc_tick NumTicks times without new input. A single tee flying through free air without its hook skips most of the
+// tile checks of those ticks, a world whose tees all rest skips the ticks that would only count their freeze and respawn timers down
+void wc_tick_repeat(SWorldCore *pCore, int NumTicks);
+// NumTicks ticks with new input for the first NumChars characters before every tick, pInputs holds NumTicks * NumChars inputs in tick
+// order. Without inputs the characters keep theirs, like wc_tick_repeat. Resting worlds skip ticks with unchanged inputs. Returns the
+// number of ticks done, which is less than NumTicks when one of the events in pTrace->m_StopOn happened. pTrace can be null.
+int wc_tick_n(SWorldCore *pCore, const SPlayerInput *pInputs, int NumChars, int NumTicks, STickTrace *pTrace);
+// ticks Num independent worlds once. single character worlds get stepped together 8 at a time, the result is the same as calling wc_tick
+// on every world
+void wc_tick_batch(SWorldCore **ppWorlds, int Num);
 void wc_free(SWorldCore *pCore);
 SWorldCore wc_empty(void);
 
@@ -371,7 +451,11 @@ void wc_remove_character(SWorldCore *pWorld, int CharacterId);
 mvec2 prj_get_pos(SProjectile *pProj, float Time);
 SCharacterCore *wc_intersect_character(SWorldCore *pWorld, mvec2 Pos0, mvec2 Pos1, float Radius, mvec2 *pNewPos, const SCharacterCore *pNotThis,
                                        const SCharacterCore *pThisOnly);
-void wc_insert_entity(SWorldCore *pWorld, SEntity *pEnt);
+// entities are owned by the world, get the memory from wc_new_entity before initializing and inserting them. wc_new_entity returns null
+// if the pool can't grow. the world frees them into its pool, so wc_insert_entity rejects entities from anywhere else (malloc, another
+// world) and returns false
+SEntity *wc_new_entity(SWorldCore *pWorld);
+bool wc_insert_entity(SWorldCore *pWorld, SEntity *pEnt);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,54 @@
+#ifndef LIB_MAP_REGISTRY_H
+#define LIB_MAP_REGISTRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "collision.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Shares one SCollision per map between all users of a registry. Maps are keyed by the hash of their file, so two paths to the same
+// map share it as well. Loading and init_collision run on a background thread of the registry, a map that isn't used by anyone stays
+// loaded until the registry is over its memory budget, then the least recently used ones are freed.
+//
+// A collision is never written to after it is loaded, any number of SWorldCore on any threads can wc_init with the same one. All
+// functions are thread-safe.
+typedef struct MapRegistry SMapRegistry;
+typedef struct MapHandle SMapHandle;
+
+typedef struct MapRegistryStats {
+  uint64_t m_Loads;      // maps built with load_map and init_collision
+  uint64_t m_CacheLoads; // maps loaded from the cache directory
+  uint64_t m_Hits;       // acquires of a map that was already loaded or queued
+  uint64_t m_Evictions;
+  int m_NumMaps;   // maps held by the registry, loaded or not
+  size_t m_Memory; // bytes used by the loaded maps, see collision_memory()
+} SMapRegistryStats;
+
+// MemoryBudget of 0 keeps every map until the registry is destroyed. With a pCacheDir every map is loaded from and saved to a collision
+// cache named after its hash in that directory, see load_collision_cache(). Returns NULL if the loader thread can't be started.
+SMapRegistry *mr_create(size_t MemoryBudget, const char *pCacheDir);
+// All handles have to be released before.
+void mr_destroy(SMapRegistry *pRegistry);
+
+// Hashes the map file and queues loading it if the registry doesn't hold it yet. Returns NULL if the file can't be read. The returned
+// handle keeps the map loaded until mr_release.
+SMapHandle *mr_acquire(SMapRegistry *pRegistry, const char *pPath);
+// Whether mr_collision would return without waiting.
+bool mr_ready(const SMapHandle *pHandle);
+// Waits until the map is loaded. The collision is shared and must not be modified, it is valid until the handle is released. Returns
+// NULL if the map failed to load.
+SCollision *mr_collision(SMapHandle *pHandle);
+// Like mr_collision, but on machines with more than one NUMA node it returns a replica of the map on the node of the calling thread,
+// see replicate_collision(). The first call on a node builds its replica, the replicas count towards the memory budget.
+SCollision *mr_local_collision(SMapHandle *pHandle);
+void mr_release(SMapHandle *pHandle);
+void mr_stats(SMapRegistry *pRegistry, SMapRegistryStats *pOut);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIB_MAP_REGISTRY_H
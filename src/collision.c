@@ -1,3 +1,7 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // mmap
+#define _DEFAULT_SOURCE         // madvise
+#endif
 #include "collision_tables.h"
 #include "limits.h"
 #include <assert.h>
@@ -19,9 +23,43 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 enum { MR_DIR_HERE = 0, MR_DIR_RIGHT, MR_DIR_DOWN, MR_DIR_LEFT, MR_DIR_UP, NUM_MR_DIRS };
 
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+static void advise_huge_pages(int Policy, void *pData, size_t Size) {
+#ifdef MADV_HUGEPAGE
+  if (Policy & COLLISION_ALLOC_HUGE_PAGES)
+    madvise(pData, Size, MADV_HUGEPAGE);
+#else
+  (void)Policy;
+  (void)pData;
+  (void)Size;
+#endif
+}
+
+// Allocates a table that lives as long as the collision, freed with _mm_free. Big ones get whole huge pages to themselves.
+static void *alloc_table(int Policy, size_t Size) {
+  if (!(Policy & COLLISION_ALLOC_HUGE_PAGES) || Size < HUGE_PAGE_SIZE)
+    return _mm_malloc(Size, 64);
+  Size = (Size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  void *pData = _mm_malloc(Size, HUGE_PAGE_SIZE);
+  if (pData)
+    advise_huge_pages(Policy, pData, Size);
+  return pData;
+}
+
 static bool tile_exists_next(SCollision *pCollision, int Index) {
   const unsigned char *pTileIdx = pCollision->m_MapData.game_layer.data;
   const unsigned char *pTileFlgs = pCollision->m_MapData.game_layer.flags;
@@ -29,12 +67,11 @@ static bool tile_exists_next(SCollision *pCollision, int Index) {
   const unsigned char *pFrontFlgs = pCollision->m_MapData.front_layer.flags;
   const unsigned char *pDoorIdx = pCollision->m_MapData.door_layer.index;
   const unsigned char *pDoorFlgs = pCollision->m_MapData.door_layer.flags;
+  const int Width = pCollision->m_TableWidth;
   int TileOnTheLeft = (Index - 1 > 0) ? Index - 1 : Index;
-  int TileOnTheRight = (Index + 1 < pCollision->m_MapData.width * pCollision->m_MapData.height) ? Index + 1 : Index;
-  int TileBelow = (Index + pCollision->m_MapData.width < pCollision->m_MapData.width * pCollision->m_MapData.height)
-                      ? Index + pCollision->m_MapData.width
-                      : Index;
-  int TileAbove = (Index - pCollision->m_MapData.width > 0) ? Index - pCollision->m_MapData.width : Index;
+  int TileOnTheRight = (Index + 1 < Width * pCollision->m_TableHeight) ? Index + 1 : Index;
+  int TileBelow = (Index + Width < Width * pCollision->m_TableHeight) ? Index + Width : Index;
+  int TileAbove = (Index - Width > 0) ? Index - Width : Index;
 
   if ((pTileIdx[TileOnTheRight] == TILE_STOP && pTileFlgs[TileOnTheRight] == ROTATION_270) ||
       (pTileIdx[TileOnTheLeft] == TILE_STOP && pTileFlgs[TileOnTheLeft] == ROTATION_90))
@@ -109,77 +146,229 @@ static bool tile_exists(SCollision *pCollision, int Index) {
   return tile_exists_next(pCollision, Index);
 }
 
-#define SQRT2 1.4142135623730951
-__attribute__((unused)) static void init_distance_field(SCollision *pCollision) {
-  const size_t orig_width = pCollision->m_MapData.width;
-  const size_t orig_height = pCollision->m_MapData.height;
-  const unsigned char *pInfos = pCollision->m_pTileInfos;
+// Chessboard distance in tiles from every tile to the closest tile a hook or weapon ray has to look at (solid, hook through and tele-in
+// tiles), capped at 255. A ray walking tile by tile moves at most one tile in that metric per step, so from a tile with distance D
+// the next D - 1 tiles on any ray are known to be empty. The border of the map counts as such a tile so rays never skip out of it.
+static bool init_distance_field(SCollision *pCollision) {
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+  const unsigned char *pTiles = pCollision->m_MapData.game_layer.data;
+  const unsigned char *pFront = pCollision->m_MapData.front_layer.data;
+  const unsigned char *pTele = pCollision->m_MapData.tele_layer.type;
+
+  uint8_t *pField = alloc_table(pCollision->m_AllocPolicy, (size_t)Width * Height);
+  if (!pField) {
+    printf("Error: could not allocate %zu bytes for the distance field\n", (size_t)Width * Height);
+    return false;
+  }
 
-  const size_t hr_width = orig_width * DISTANCE_FIELD_RESOLUTION;
-  const size_t hr_height = orig_height * DISTANCE_FIELD_RESOLUTION;
-  float *hr_field = _mm_malloc(hr_width * hr_height * sizeof(float), 32);
-  if (!hr_field) {
-    printf("Error: could not allocate %zu bytes of memory\n", hr_width * hr_height * sizeof(float));
-    return;
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < Width * Height; ++i) {
+    bool Stop = pCollision->m_pTileInfos[i] & INFO_ISSOLID || pTiles[i] == TILE_THROUGH_ALL || pTiles[i] == TILE_THROUGH_DIR;
+    if (pFront && (pFront[i] == TILE_THROUGH_ALL || pFront[i] == TILE_THROUGH_DIR))
+      Stop = true;
+    if (pTele && (pTele[i] == TILE_TELEINHOOK || pTele[i] == TILE_TELEINWEAPON))
+      Stop = true;
+    pField[i] = Stop ? 0 : 255;
   }
-  for (size_t y = 0; y < hr_height; ++y) {
-    for (size_t x = 0; x < hr_width; ++x) {
-      const size_t orig_x = x / DISTANCE_FIELD_RESOLUTION;
-      const size_t orig_y = y / DISTANCE_FIELD_RESOLUTION;
-      const size_t orig_idx = orig_y * orig_width + orig_x;
-      const size_t tele = pCollision->m_MapData.tele_layer.type ? pCollision->m_MapData.tele_layer.type[orig_idx] : 0;
-      hr_field[y * hr_width + x] = (pInfos[orig_idx] & INFO_ISSOLID || tele == TILE_TELEINHOOK || tele == TILE_TELEINWEAPON) ? 0.0f : FLT_MAX;
+
+  // two chamfer passes with unit cost for all eight neighbours give the exact chessboard distance
+  for (int y = 0; y < Height; ++y) {
+    uint8_t *pRow = pField + (size_t)y * Width;
+    for (int x = 0; x < Width; ++x) {
+      if (!pRow[x])
+        continue;
+      int Dist = pRow[x];
+      if (x == 0 || y == 0 || x == Width - 1 || y == Height - 1)
+        Dist = 1;
+      else
+        Dist = imin(Dist, imin(imin(pRow[x - 1], pRow[x - Width - 1]), imin(pRow[x - Width], pRow[x - Width + 1])) + 1);
+      pRow[x] = imin(Dist, 255);
     }
   }
-
-  // First pass: left-top to right-bottom
-  for (size_t y = 1; y < hr_height - 1; ++y) {
-    for (size_t x = 1; x < hr_width - 1; ++x) {
-      const size_t idx = y * hr_width + x;
-      if (hr_field[idx] == 0.0f)
+  for (int y = Height - 2; y > 0; --y) {
+    uint8_t *pRow = pField + (size_t)y * Width;
+    for (int x = Width - 2; x > 0; --x) {
+      if (!pRow[x])
         continue;
+      int Dist = imin(imin(pRow[x + 1], pRow[x + Width + 1]), imin(pRow[x + Width], pRow[x + Width - 1])) + 1;
+      pRow[x] = imin(pRow[x], Dist);
+    }
+  }
 
-      float min_dist = FLT_MAX;
-      min_dist = fminf(min_dist, hr_field[idx - 1] + 1.0f);
-      min_dist = fminf(min_dist, hr_field[idx - hr_width] + 1.0f);
-      min_dist = fminf(min_dist, hr_field[idx - hr_width - 1] + (float)SQRT2);
-      min_dist = fminf(min_dist, hr_field[idx - hr_width + 1] + (float)SQRT2);
+  pCollision->m_pSolidTeleDistanceField = pField;
+  return true;
+}
 
-      hr_field[idx] = fminf(hr_field[idx], min_dist);
+// Takes ownership of pBase, the one byte per tile level 0 of the pyramid. Without KeepBase level 0 is dropped once level 1 is built and
+// the queries read the bit plane of the compact backend instead. On failure the levels built so far stay for free_broad_pyramid.
+static bool init_broad_pyramid(int Policy, SBroadPyramid *pPyramid, uint8_t *pBase, int Width, int Height, bool KeepBase) {
+  pPyramid->m_apLevels[0] = pBase;
+  pPyramid->m_aWidth[0] = Width;
+  pPyramid->m_aHeight[0] = Height;
+  pPyramid->m_NumLevels = 1;
+  while ((Width > 1 || Height > 1) && pPyramid->m_NumLevels < BROAD_MAX_LEVELS) {
+    const uint8_t *pPrev = pPyramid->m_apLevels[pPyramid->m_NumLevels - 1];
+    const int PrevWidth = Width;
+    const int PrevHeight = Height;
+    Width = (Width + 1) / 2;
+    Height = (Height + 1) / 2;
+    uint8_t *pLevel = alloc_table(Policy, (size_t)Width * Height);
+    if (!pLevel) {
+      printf("Error: could not allocate %zu bytes for a broad pyramid level\n", (size_t)Width * Height);
+      return false;
+    }
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < Height; ++y) {
+      const uint8_t *pRow0 = pPrev + (size_t)(2 * y) * PrevWidth;
+      const uint8_t *pRow1 = 2 * y + 1 < PrevHeight ? pRow0 + PrevWidth : pRow0;
+      for (int x = 0; x < Width; ++x) {
+        const int x1 = imin(2 * x + 1, PrevWidth - 1);
+        pLevel[y * Width + x] = pRow0[2 * x] | pRow0[x1] | pRow1[2 * x] | pRow1[x1];
+      }
     }
+    pPyramid->m_apLevels[pPyramid->m_NumLevels] = pLevel;
+    pPyramid->m_aWidth[pPyramid->m_NumLevels] = Width;
+    pPyramid->m_aHeight[pPyramid->m_NumLevels] = Height;
+    ++pPyramid->m_NumLevels;
+  }
+  if (!KeepBase) {
+    _mm_free(pPyramid->m_apLevels[0]);
+    pPyramid->m_apLevels[0] = NULL;
   }
+  return true;
+}
 
-  // Second pass: right-bottom to left-top
-  for (size_t y = hr_height - 2; y > 0; --y) {
-    for (size_t x = hr_width - 2; x > 0; --x) {
-      const size_t idx = y * hr_width + x;
-      if (hr_field[idx] == 0.0f)
-        continue;
+static void free_broad_pyramid(SBroadPyramid *pPyramid) {
+  for (int i = 0; i < pPyramid->m_NumLevels; ++i)
+    _mm_free(pPyramid->m_apLevels[i]);
+  pPyramid->m_NumLevels = 0;
+}
+
+static bool init_broad_pyramids(SCollision *pCollision) {
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+  const int MapSize = Width * Height;
+  const unsigned char *pTele = pCollision->m_MapData.tele_layer.type;
+  const bool KeepBase = pCollision->m_BroadBackend != BROAD_BACKEND_COMPACT;
+
+  uint8_t *pSolid = alloc_table(pCollision->m_AllocPolicy, MapSize);
+  uint8_t *pIndices = alloc_table(pCollision->m_AllocPolicy, MapSize);
+  if (!pSolid || !pIndices) {
+    printf("Error: could not allocate %zu bytes for the broad pyramids\n", (size_t)MapSize * 2);
+    _mm_free(pSolid);
+    _mm_free(pIndices);
+    return false;
+  }
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < MapSize; ++i) {
+    pSolid[i] = pCollision->m_pTileInfos[i] & INFO_ISSOLID;
+    pIndices[i] = pCollision->m_pTileBroadCheck[i];
+  }
+  if (!init_broad_pyramid(pCollision->m_AllocPolicy, &pCollision->m_aBroadPyramids[BROAD_SOLID], pSolid, Width, Height, KeepBase)) {
+    _mm_free(pIndices);
+    return false;
+  }
+  if (!init_broad_pyramid(pCollision->m_AllocPolicy, &pCollision->m_aBroadPyramids[BROAD_INDICES], pIndices, Width, Height, KeepBase))
+    return false;
 
-      float min_dist = FLT_MAX;
-      min_dist = fminf(min_dist, hr_field[idx + 1] + 1.0f);
-      min_dist = fminf(min_dist, hr_field[idx + hr_width] + 1.0f);
-      min_dist = fminf(min_dist, hr_field[idx + hr_width + 1] + (float)SQRT2);
-      min_dist = fminf(min_dist, hr_field[idx + hr_width - 1] + (float)SQRT2);
-      hr_field[idx] = fminf(hr_field[idx], min_dist);
+  if (pTele) {
+    uint8_t *pTeleIn = alloc_table(pCollision->m_AllocPolicy, MapSize);
+    if (!pTeleIn) {
+      printf("Error: could not allocate %zu bytes for the tele broad pyramid\n", (size_t)MapSize);
+      return false;
     }
+    for (int i = 0; i < MapSize; ++i)
+      pTeleIn[i] = pTele[i] == TILE_TELEINHOOK || pTele[i] == TILE_TELEINWEAPON;
+    return init_broad_pyramid(pCollision->m_AllocPolicy, &pCollision->m_aBroadPyramids[BROAD_TELE_IN], pTeleIn, Width, Height, KeepBase);
   }
+  return true;
+}
+
+static bool init_broad_bits(SCollision *pCollision) {
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+  const unsigned char *pTele = pCollision->m_MapData.tele_layer.type;
+  // one spare word per row so the two word reads of broad_rect_check never leave the row
+  const int Stride = (Width + 63) / 64 + 1;
+  const size_t Size = (size_t)Stride * Height * sizeof(uint64_t);
+  pCollision->m_BroadBitsStride = Stride;
 
-  pCollision->m_pSolidTeleDistanceField = _mm_malloc(hr_width * hr_height, 64);
-  if (!pCollision->m_pSolidTeleDistanceField) {
-    printf("Could not allocated %zu bytes for m_pSolidTeleDistanceField\n", hr_width * hr_height);
+  for (int l = 0; l < NUM_BROAD_LAYERS; ++l) {
+    if (l == BROAD_TELE_IN && !pTele)
+      continue;
+    pCollision->m_apBroadBits[l] = alloc_table(pCollision->m_AllocPolicy, Size);
+    if (!pCollision->m_apBroadBits[l]) {
+      printf("Error: could not allocate %zu bytes for the broad bit planes\n", Size);
+      return false;
+    }
+    memset(pCollision->m_apBroadBits[l], 0, Size);
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < Height; ++y) {
+    uint64_t *pSolid = pCollision->m_apBroadBits[BROAD_SOLID] + (size_t)y * Stride;
+    uint64_t *pIndices = pCollision->m_apBroadBits[BROAD_INDICES] + (size_t)y * Stride;
+    uint64_t *pTeleIn = pTele ? pCollision->m_apBroadBits[BROAD_TELE_IN] + (size_t)y * Stride : NULL;
+    for (int x = 0; x < Width; ++x) {
+      const int Idx = y * Width + x;
+      const uint64_t Bit = (uint64_t)1 << (x & 63);
+      if (pCollision->m_pTileInfos[Idx] & INFO_ISSOLID)
+        pSolid[x >> 6] |= Bit;
+      if (pCollision->m_pTileBroadCheck[Idx])
+        pIndices[x >> 6] |= Bit;
+      if (pTeleIn && (pTele[Idx] == TILE_TELEINHOOK || pTele[Idx] == TILE_TELEINWEAPON))
+        pTeleIn[x >> 6] |= Bit;
+    }
   }
+  return true;
+}
 
-  const float scale_to_world = 32.f / (float)DISTANCE_FIELD_RESOLUTION;
-  for (size_t i = 0; i < hr_width * hr_height; ++i) {
-    hr_field[i] -= 1.5f;
-    hr_field[i] *= scale_to_world;
-    hr_field[i] = fclamp(hr_field[i], 0, 255);
-    pCollision->m_pSolidTeleDistanceField[i] = (uint8_t)imax((int)hr_field[i] - 1, 0);
+static bool broad_pyramid_cell(const SCollision *pCollision, int Layer, int Level, int x, int y) {
+  const SBroadPyramid *pPyramid = &pCollision->m_aBroadPyramids[Layer];
+  if (pPyramid->m_apLevels[Level])
+    return pPyramid->m_apLevels[Level][y * pPyramid->m_aWidth[Level] + x];
+  // level 0 of the compact backend is its bit plane
+  return pCollision->m_apBroadBits[Layer][(size_t)y * pCollision->m_BroadBitsStride + (x >> 6)] >> (x & 63) & 1;
+}
+
+static bool broad_pyramid_rect(const SCollision *pCollision, int Layer, int Level, int MinX, int MinY, int MaxX, int MaxY) {
+  for (int by = MinY >> Level; by <= MaxY >> Level; ++by) {
+    for (int bx = MinX >> Level; bx <= MaxX >> Level; ++bx) {
+      if (!broad_pyramid_cell(pCollision, Layer, Level, bx, by))
+        continue;
+      const int x0 = bx << Level;
+      const int y0 = by << Level;
+      const int x1 = x0 + (1 << Level) - 1;
+      const int y1 = y0 + (1 << Level) - 1;
+      // a marked block completely inside the rectangle answers the query, blocks on the border have to look closer
+      if (x0 >= MinX && y0 >= MinY && x1 <= MaxX && y1 <= MaxY)
+        return true;
+      if (broad_pyramid_rect(pCollision, Layer, Level - 1, imax(MinX, x0), imax(MinY, y0), imin(MaxX, x1), imin(MaxY, y1)))
+        return true;
+    }
   }
-  free(hr_field);
+  return false;
+}
+
+// Exact "is any tile of this broad layer inside the rectangle" for rectangles of any size, corners in stored tiles and inclusive. The query
+// starts on the level where the rectangle covers at most 2x2 cells and only descends into marked cells on its border.
+bool broad_pyramid_check(const SCollision *pCollision, int Layer, int MinX, int MinY, int MaxX, int MaxY) {
+  const SBroadPyramid *pPyramid = &pCollision->m_aBroadPyramids[Layer];
+  if (!pPyramid->m_NumLevels)
+    return false;
+  MinX = imax(MinX, 0);
+  MinY = imax(MinY, 0);
+  MaxX = imin(MaxX, pPyramid->m_aWidth[0] - 1);
+  MaxY = imin(MaxY, pPyramid->m_aHeight[0] - 1);
+  if (MinX > MaxX || MinY > MaxY)
+    return false;
+
+  int Level = 0;
+  while (Level + 1 < pPyramid->m_NumLevels && ((MaxX >> Level) - (MinX >> Level) > 1 || (MaxY >> Level) - (MinY >> Level) > 1))
+    ++Level;
+  return broad_pyramid_rect(pCollision, Layer, Level, MinX, MinY, MaxX, MaxY);
 }
-#undef SQRT2
 
 static void init_tuning_params(STuningParams *pTunings) {
 #define MACRO_TUNING_PARAM(Name, Value) pTunings->m_##Name = Value;
@@ -506,355 +695,667 @@ fail:
   return false;
 }
 
-// SCollision now OWNS the pMap data, DO NOT FREE IT
-bool init_collision(SCollision *__restrict__ pCollision, map_data_t *__restrict__ pMap) {
-  pCollision->m_MapData = *pMap;
-  expand_and_shift_map(&pCollision->m_MapData, MAP_EXPAND);
-  if (!pCollision->m_MapData.game_layer.data)
-    return false;
+static bool is_spawn_tile(const map_data_t *pMapData, int Idx) {
+  return (pMapData->game_layer.data[Idx] >= 192 && pMapData->game_layer.data[Idx] <= 194) ||
+         (pMapData->front_layer.data && pMapData->front_layer.data[Idx] >= 192 && pMapData->front_layer.data[Idx] <= 194);
+}
 
-  map_data_t *pMapData = &pCollision->m_MapData;
-  const int Width = pMapData->width;
-  const int Height = pMapData->height;
-  const int MapSize = Width * Height;
+// Spawn points and tele outs in the border count once per tile of the whole border, as if it was stored. Rows without any of them
+// are skipped, so this stays cheap even though it walks the map coordinates.
+static bool init_spawns_and_tele_outs(SCollision *pCollision) {
+  const map_data_t *pMapData = &pCollision->m_MapData;
+  const unsigned char *pTele = pMapData->tele_layer.type;
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+
+  bool *pRowUsed = calloc(Height, sizeof(bool));
+  if (!pRowUsed) {
+    printf("Error: could not allocate %zu bytes for the spawn rows\n", (size_t)Height);
+    return false;
+  }
+  bool AnyUsed = false;
+  for (int i = 0; i < Width * Height; ++i) {
+    if (is_spawn_tile(pMapData, i) || (pTele && (pTele[i] == TILE_TELEOUT || pTele[i] == TILE_TELECHECKOUT))) {
+      pRowUsed[i / Width] = true;
+      AnyUsed = true;
+    }
+  }
+  if (!AnyUsed) {
+    free(pRowUsed);
+    return true;
+  }
 
-  pCollision->m_pTileInfos = _mm_malloc(MapSize * sizeof(char), 64);
-  memset(pCollision->m_pTileInfos, 0, MapSize * sizeof(char));
+  // the first pass counts, the second one fills the lists in the same order
+  int aTeleIdx[256] = {0}, aTeleCheckIdx[256] = {0}, SpawnPointIdx = 0;
+  for (int Pass = 0; Pass < 2; ++Pass) {
+    if (Pass == 1) {
+      if (pCollision->m_NumSpawnPoints > 0)
+        pCollision->m_pSpawnPoints = malloc(pCollision->m_NumSpawnPoints * sizeof(mvec2));
+      bool Ok = pCollision->m_NumSpawnPoints <= 0 || pCollision->m_pSpawnPoints;
+      for (int i = 0; i < 256; ++i) {
+        if (pCollision->m_aNumTeleOuts[i] > 0) {
+          pCollision->m_apTeleOuts[i] = malloc(pCollision->m_aNumTeleOuts[i] * sizeof(mvec2));
+          Ok = Ok && pCollision->m_apTeleOuts[i];
+        }
+        if (pCollision->m_aNumTeleCheckOuts[i] > 0) {
+          pCollision->m_apTeleCheckOuts[i] = malloc(pCollision->m_aNumTeleCheckOuts[i] * sizeof(mvec2));
+          Ok = Ok && pCollision->m_apTeleCheckOuts[i];
+        }
+      }
+      if (!Ok) {
+        printf("Error: could not allocate the spawn points and tele outs\n");
+        free(pRowUsed);
+        return false;
+      }
+    }
+    for (int y = 0; y < pMapData->height; ++y) {
+      if (!pRowUsed[pCollision->m_pRowLookup[y]])
+        continue;
+      for (int x = 0; x < pMapData->width; ++x) {
+        const int Idx = map_index(pCollision, x, y);
+        if (is_spawn_tile(pMapData, Idx)) {
+          if (Pass == 0)
+            ++pCollision->m_NumSpawnPoints;
+          else
+            pCollision->m_pSpawnPoints[SpawnPointIdx++] = vec2_init(x, y);
+        }
+        if (!pTele)
+          continue;
+        const int Number = pMapData->tele_layer.number[Idx];
+        if (pTele[Idx] == TILE_TELEOUT) {
+          if (Pass == 0)
+            ++pCollision->m_aNumTeleOuts[Number];
+          else
+            pCollision->m_apTeleOuts[Number][aTeleIdx[Number]++] = vec2_init((x * 32.f) + 16.f, (y * 32.f) + 16.f);
+        }
+        if (pTele[Idx] == TILE_TELECHECKOUT) {
+          if (Pass == 0)
+            ++pCollision->m_aNumTeleCheckOuts[Number];
+          else
+            pCollision->m_apTeleCheckOuts[Number][aTeleCheckIdx[Number]++] = vec2_init((x * 32.f) + 16.f, (y * 32.f) + 16.f);
+        }
+      }
+    }
+  }
+  free(pRowUsed);
+  return true;
+}
 
-  pCollision->m_pTileBroadCheck = _mm_malloc(MapSize * sizeof(char), 64);
-  memset(pCollision->m_pTileBroadCheck, 0, MapSize * sizeof(char));
+// The map is stored with a border of MAP_EXPAND_STORED tiles, m_MapData has the size with all MAP_EXPAND of it. Tiles of the border
+// repeat the closest tile of the map, so every tile further out reads the stored tile of its row or column that is closest to the map.
+// Only the outermost ring keeps its own stored ring, the clamps and the neighbour reads of the precomputations behave differently there.
+static int table_coordinate(int Pos, int Size, int TableSize) {
+  if (Pos == 0)
+    return 0;
+  if (Pos == Size - 1)
+    return TableSize - 1;
+  return iclamp(Pos - (MAP_EXPAND - MAP_EXPAND_STORED), 1, TableSize - 2);
+}
 
-  pCollision->m_pMoveRestrictions = _mm_malloc(MapSize * NUM_MR_DIRS * sizeof(char), 64);
-  memset(pCollision->m_pMoveRestrictions, 0, MapSize * NUM_MR_DIRS * sizeof(char));
+static bool init_lookups(SCollision *pCollision) {
+  const int Width = pCollision->m_MapData.width;
+  const int Height = pCollision->m_MapData.height;
+  pCollision->m_pWidthLookup = _mm_malloc(Height * sizeof(uint32_t), 64);
+  pCollision->m_pRowLookup = _mm_malloc(Height * sizeof(uint32_t), 64);
+  pCollision->m_pColumnLookup = _mm_malloc(Width * sizeof(uint32_t), 64);
+  pCollision->m_pColumnIndexLookup = _mm_malloc(Width * sizeof(uint32_t), 64);
+  if (!pCollision->m_pWidthLookup || !pCollision->m_pRowLookup || !pCollision->m_pColumnLookup || !pCollision->m_pColumnIndexLookup) {
+    printf("Error: could not allocate the map lookups\n");
+    return false;
+  }
 
-  pCollision->m_pPickups = _mm_malloc(MapSize * sizeof(SPickup), 64);
-  memset(pCollision->m_pPickups, 0, MapSize * sizeof(SPickup));
-  pCollision->m_pFrontPickups = _mm_malloc(MapSize * sizeof(SPickup), 64);
-  memset(pCollision->m_pFrontPickups, 0, MapSize * sizeof(SPickup));
+  for (int y = 0; y < Height; ++y) {
+    pCollision->m_pRowLookup[y] = table_coordinate(y, Height, pCollision->m_TableHeight);
+    pCollision->m_pWidthLookup[y] = pCollision->m_pRowLookup[y] * pCollision->m_TableWidth;
+  }
+  for (int x = 0; x < Width; ++x) {
+    pCollision->m_pColumnLookup[x] = table_coordinate(x, Width, pCollision->m_TableWidth);
+    pCollision->m_pColumnIndexLookup[x] = pCollision->m_pColumnLookup[x];
+  }
+  return true;
+}
 
-  pCollision->m_pBroadSolidBitField = _mm_malloc(MapSize * sizeof(uint64_t), 64);
-  memset(pCollision->m_pBroadSolidBitField, 0, MapSize * sizeof(uint64_t));
+#define TILE_BLOCK 8
+// spare bytes at the end of m_pTileInfos, move_box_x8 gathers 32 bits for every tile info
+#define TILE_INFOS_PADDING 3
+
+// Entries of every table indexed through map_index, the blocked layout pads the stored tiles to whole blocks.
+static size_t tile_table_size(const SCollision *pCollision) {
+  if (!pCollision->m_BlockedTiles)
+    return (size_t)pCollision->m_TableWidth * pCollision->m_TableHeight;
+  const size_t BlocksX = (pCollision->m_TableWidth + TILE_BLOCK - 1) / TILE_BLOCK;
+  const size_t BlocksY = (pCollision->m_TableHeight + TILE_BLOCK - 1) / TILE_BLOCK;
+  return BlocksX * BlocksY * TILE_BLOCK * TILE_BLOCK;
+}
 
-  pCollision->m_pBroadTeleInBitField = pCollision->m_MapData.tele_layer.type ? _mm_malloc(MapSize * sizeof(uint64_t), 64) : NULL;
-  if (pCollision->m_pBroadTeleInBitField)
-    memset(pCollision->m_pBroadTeleInBitField, 0, MapSize * sizeof(uint64_t));
+static int blocked_row_index(int BlocksX, int Row) { return (Row / TILE_BLOCK * BlocksX * TILE_BLOCK + Row % TILE_BLOCK) * TILE_BLOCK; }
+static int blocked_column_index(int Column) { return Column / TILE_BLOCK * TILE_BLOCK * TILE_BLOCK + Column % TILE_BLOCK; }
+
+// Copies a row-major table into the blocked order and frees it, returns NULL and keeps it if there is no memory. The part of a stored
+// row inside one block is contiguous in both.
+static void *block_tile_table(const SCollision *pCollision, void *pTable, size_t ElemSize, bool Layer) {
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+  const int BlocksX = (Width + TILE_BLOCK - 1) / TILE_BLOCK;
+  // every table gets the spare bytes of m_pTileInfos
+  const size_t Size = tile_table_size(pCollision) * ElemSize + TILE_INFOS_PADDING;
+  // layers are released by free_map_data
+  uint8_t *pBlocked = Layer ? malloc(Size) : alloc_table(pCollision->m_AllocPolicy, Size);
+  if (!pBlocked)
+    return NULL;
+  memset(pBlocked, 0, Size);
+  const uint8_t *pRows = pTable;
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < Height; ++y)
+    for (int x = 0; x < Width; x += TILE_BLOCK)
+      memcpy(pBlocked + (size_t)(blocked_row_index(BlocksX, y) + blocked_column_index(x)) * ElemSize, pRows + ((size_t)y * Width + x) * ElemSize,
+             imin(TILE_BLOCK, Width - x) * ElemSize);
+  if (Layer)
+    free(pTable);
+  else
+    _mm_free(pTable);
+  return pBlocked;
+}
 
-  pCollision->m_pBroadIndicesBitField = _mm_malloc(MapSize * sizeof(uint64_t), 64);
-  memset(pCollision->m_pBroadIndicesBitField, 0, MapSize * sizeof(uint64_t));
-  pCollision->m_MoveRestrictionsFound = false;
+// Switches the tables read through map_index to 8x8 tile blocks, the precomputations before all work on rows. The broad tables keep
+// their own layouts.
+static bool init_tile_blocks(SCollision *pCollision) {
+  const int BlocksX = (pCollision->m_TableWidth + TILE_BLOCK - 1) / TILE_BLOCK;
+  const int Height = pCollision->m_MapData.height;
+  const int Width = pCollision->m_MapData.width;
+  pCollision->m_BlockedTiles = true;
+  for (int y = 0; y < Height; ++y)
+    pCollision->m_pWidthLookup[y] = blocked_row_index(BlocksX, pCollision->m_pRowLookup[y]);
+  for (int x = 0; x < Width; ++x)
+    pCollision->m_pColumnIndexLookup[x] = blocked_column_index(pCollision->m_pColumnLookup[x]);
+
+  map_data_t *pMap = &pCollision->m_MapData;
+  unsigned char **appByteLayers[] = {&pMap->game_layer.data,      &pMap->game_layer.flags,       &pMap->front_layer.data,
+                                     &pMap->front_layer.flags,    &pMap->tele_layer.number,      &pMap->tele_layer.type,
+                                     &pMap->speedup_layer.force,  &pMap->speedup_layer.max_speed, &pMap->speedup_layer.type,
+                                     &pMap->switch_layer.number,  &pMap->switch_layer.type,      &pMap->switch_layer.flags,
+                                     &pMap->switch_layer.delay,   &pMap->door_layer.index,       &pMap->door_layer.flags,
+                                     &pMap->tune_layer.number,    &pMap->tune_layer.type};
+  bool Ok = true;
+#define BLOCK_TABLE(pTable, ElemSize, Layer)                                                                                                         \
+  do {                                                                                                                                               \
+    void *pBlocked = (pTable) ? block_tile_table(pCollision, (pTable), (ElemSize), (Layer)) : NULL;                                                  \
+    if (pBlocked)                                                                                                                                    \
+      (pTable) = pBlocked;                                                                                                                           \
+    else                                                                                                                                             \
+      Ok = Ok && !(pTable);                                                                                                                          \
+  } while (0)
+  for (size_t i = 0; i < sizeof(appByteLayers) / sizeof(appByteLayers[0]); ++i)
+    BLOCK_TABLE(*appByteLayers[i], 1, true);
+  BLOCK_TABLE(pMap->speedup_layer.angle, sizeof(short), true);
+  BLOCK_TABLE(pMap->door_layer.number, sizeof(int), true);
+  BLOCK_TABLE(pCollision->m_pTileInfos, 1, false);
+  BLOCK_TABLE(pCollision->m_pTileActions, sizeof(uint32_t), false);
+  BLOCK_TABLE(pCollision->m_pTileBroadCheck, 1, false);
+  BLOCK_TABLE(pCollision->m_pMoveRestrictions, sizeof(pCollision->m_pMoveRestrictions[0]), false);
+  BLOCK_TABLE(pCollision->m_pPickups, sizeof(SPickup), false);
+  BLOCK_TABLE(pCollision->m_pFrontPickups, sizeof(SPickup), false);
+  BLOCK_TABLE(pCollision->m_pSpeedups, sizeof(SSpeedup), false);
+  BLOCK_TABLE(pCollision->m_pSolidTeleDistanceField, 1, false);
+#undef BLOCK_TABLE
+  if (!Ok)
+    printf("Error: could not allocate the blocked tile tables\n");
+  return Ok;
+}
 
-  pCollision->m_pWidthLookup = _mm_malloc(Height * sizeof(unsigned int), 64);
+static double init_clock(void) {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
 
-  for (int i = 0; i < Height; ++i)
-    pCollision->m_pWidthLookup[i] = i * Width;
+static void init_pickup(SPickup *pPickup, const map_data_t *pMapData, int EntIdx, int Index) {
+  pPickup->m_Type = -1;
+  if (!((EntIdx >= ENTITY_ARMOR_SHOTGUN && EntIdx <= ENTITY_ARMOR_LASER) || (EntIdx >= ENTITY_ARMOR_1 && EntIdx <= ENTITY_WEAPON_LASER)))
+    return;
+  int Type = -1;
+  int SubType = 0;
+  if (EntIdx == ENTITY_ARMOR_1)
+    Type = POWERUP_ARMOR;
+  else if (EntIdx == ENTITY_ARMOR_SHOTGUN)
+    Type = POWERUP_ARMOR_SHOTGUN;
+  else if (EntIdx == ENTITY_ARMOR_GRENADE)
+    Type = POWERUP_ARMOR_GRENADE;
+  else if (EntIdx == ENTITY_ARMOR_NINJA)
+    Type = POWERUP_ARMOR_NINJA;
+  else if (EntIdx == ENTITY_ARMOR_LASER)
+    Type = POWERUP_ARMOR_LASER;
+  else if (EntIdx == ENTITY_HEALTH_1)
+    Type = POWERUP_HEALTH;
+  else if (EntIdx == ENTITY_WEAPON_SHOTGUN) {
+    Type = POWERUP_WEAPON;
+    SubType = WEAPON_SHOTGUN;
+  } else if (EntIdx == ENTITY_WEAPON_GRENADE) {
+    Type = POWERUP_WEAPON;
+    SubType = WEAPON_GRENADE;
+  } else if (EntIdx == ENTITY_WEAPON_LASER) {
+    Type = POWERUP_WEAPON;
+    SubType = WEAPON_LASER;
+  } else if (EntIdx == ENTITY_POWERUP_NINJA) {
+    Type = POWERUP_NINJA;
+    SubType = WEAPON_NINJA;
+  }
+  pPickup->m_Type = Type;
+  pPickup->m_Subtype = SubType;
+  if (pMapData->switch_layer.type) {
+    const int SwitchType = pMapData->switch_layer.type[Index];
+    if (SwitchType) {
+      pPickup->m_Type = SwitchType;
+      pPickup->m_Number = pMapData->switch_layer.number[Index];
+    }
+  }
+}
 
-  /*   if (pCollision->m_MapData.tele_layer.type) {
-      for (int y = 0; y < Height; ++y) {
-        for (int x = 0; x < Width; ++x) {
-          if (pCollision->m_MapData.tele_layer.type[y * Width + x])
-            printf("%d\n", pCollision->m_MapData.tele_layer.type[y * Width + x]);
-        }
-      }
-    } */
+// Not inlined so the loop of init_tiles can't be vectorized into other sine and cosine versions than the ones get_speedup called.
+__attribute__((noinline)) static mvec2 speedup_direction(short Angle) { return vdirection(Angle * (PI / 180.0f)); }
 
-  for (int i = 0; i < NUM_TUNE_ZONES; ++i)
-    init_tuning_params(&pCollision->m_aTuningList[i]);
-  // Figure out important things
-  // Make lists of spawn points, tele outs and tele checkpoints outs
-  // figure out highest switch number
-  pCollision->m_HighestSwitchNumber = 0;
-  if (pCollision->m_MapData.switch_layer.number)
-    for (int i = 0; i < MapSize; ++i)
-      pCollision->m_HighestSwitchNumber = imax(pCollision->m_HighestSwitchNumber, pCollision->m_MapData.switch_layer.number[i]);
+static void init_speedup(SSpeedup *pSpeedup, const map_data_t *pMapData, int Index) {
+  const mvec2 Direction = speedup_direction(pMapData->speedup_layer.angle[Index]);
+  pSpeedup->m_aDirection[0] = vgetx(Direction);
+  pSpeedup->m_aDirection[1] = vgety(Direction);
+  pSpeedup->m_Force = pMapData->speedup_layer.force[Index];
+  pSpeedup->m_MaxSpeed = pMapData->speedup_layer.max_speed[Index];
+  pSpeedup->m_Type = pMapData->speedup_layer.type[Index];
+}
 
-  for (int i = 0; i < MapSize; ++i) {
-    if (tile_exists(pCollision, i))
-      pCollision->m_pTileInfos[i] |= INFO_TILENEXT;
-    const int Tile = pCollision->m_MapData.game_layer.data[i];
-    const int FTile = pCollision->m_MapData.front_layer.data ? pCollision->m_MapData.front_layer.data[i] : 0;
-    if (Tile == TILE_SOLID || Tile == TILE_NOHOOK)
-      pCollision->m_pTileInfos[i] |= INFO_ISSOLID;
-
-    if ((Tile >= 192 && Tile <= 194) || (FTile >= 192 && FTile <= 194))
-      ++pCollision->m_NumSpawnPoints;
-    if (pMapData->tele_layer.type) {
-      if (pMapData->tele_layer.type[i] == TILE_TELEOUT)
-        ++pCollision->m_aNumTeleOuts[pMapData->tele_layer.number[i]];
-      if (pMapData->tele_layer.type[i] == TILE_TELECHECKOUT)
-        ++pCollision->m_aNumTeleCheckOuts[pMapData->tele_layer.number[i]];
-    }
+// Everything that only depends on the tile itself: tile infos, move restrictions, pickups, speedups and the tunings of no player
+// collision and no player hooking tiles.
+static void init_tiles(SCollision *pCollision) {
+  const map_data_t *pMapData = &pCollision->m_MapData;
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+  int HighestSwitchNumber = 0;
+  int MoveRestrictionsFound = 0;
+  int NoPlayerCollision = 0;
+  int NoPlayerHooking = 0;
+
+#pragma omp parallel for schedule(static) reduction(max : HighestSwitchNumber)                                                                   \
+    reduction(| : MoveRestrictionsFound, NoPlayerCollision, NoPlayerHooking)
+  for (int y = 0; y < Height; ++y) {
+    for (int i = y * Width; i < (y + 1) * Width; ++i) {
+      if (pMapData->switch_layer.number)
+        HighestSwitchNumber = imax(HighestSwitchNumber, pMapData->switch_layer.number[i]);
+      if (tile_exists(pCollision, i))
+        pCollision->m_pTileInfos[i] |= INFO_TILENEXT;
+      const int Tile = pMapData->game_layer.data[i];
+      if (Tile == TILE_SOLID || Tile == TILE_NOHOOK)
+        pCollision->m_pTileInfos[i] |= INFO_ISSOLID;
+      const int FrontTile = pMapData->front_layer.data ? pMapData->front_layer.data[i] : 0;
+      NoPlayerCollision |= Tile == TILE_NPC || FrontTile == TILE_NPC;
+      NoPlayerHooking |= Tile == TILE_NPH || FrontTile == TILE_NPH;
 
-    for (int d = 0; d < NUM_MR_DIRS; d++) {
-      int Tile;
-      int Flags;
-      if (pCollision->m_MapData.front_layer.data) {
-        Tile = get_front_tile_index(pCollision, i);
-        Flags = get_front_tile_flags(pCollision, i);
+      for (int d = 0; d < NUM_MR_DIRS; d++) {
+        int Tile;
+        int Flags;
+        if (pMapData->front_layer.data) {
+          Tile = get_front_tile_index(pCollision, i);
+          Flags = get_front_tile_flags(pCollision, i);
+          pCollision->m_pMoveRestrictions[i][d] |= move_restrictions(d, Tile, Flags);
+        }
+        Tile = get_tile_index(pCollision, i);
+        Flags = get_tile_flags(pCollision, i);
         pCollision->m_pMoveRestrictions[i][d] |= move_restrictions(d, Tile, Flags);
-      }
-      Tile = get_tile_index(pCollision, i);
-      Flags = get_tile_flags(pCollision, i);
-      pCollision->m_pMoveRestrictions[i][d] |= move_restrictions(d, Tile, Flags);
-
-      if (pCollision->m_pMoveRestrictions[i][d])
-        pCollision->m_MoveRestrictionsFound = true;
-    }
 
-    pCollision->m_pPickups[i].m_Type = -1;
-    int EntIdx = pMapData->game_layer.data[i] - ENTITY_OFFSET;
-    if ((EntIdx >= ENTITY_ARMOR_SHOTGUN && EntIdx <= ENTITY_ARMOR_LASER) || (EntIdx >= ENTITY_ARMOR_1 && EntIdx <= ENTITY_WEAPON_LASER)) {
-      int Type = -1;
-      int SubType = 0;
-      if (EntIdx == ENTITY_ARMOR_1)
-        Type = POWERUP_ARMOR;
-      else if (EntIdx == ENTITY_ARMOR_SHOTGUN)
-        Type = POWERUP_ARMOR_SHOTGUN;
-      else if (EntIdx == ENTITY_ARMOR_GRENADE)
-        Type = POWERUP_ARMOR_GRENADE;
-      else if (EntIdx == ENTITY_ARMOR_NINJA)
-        Type = POWERUP_ARMOR_NINJA;
-      else if (EntIdx == ENTITY_ARMOR_LASER)
-        Type = POWERUP_ARMOR_LASER;
-      else if (EntIdx == ENTITY_HEALTH_1)
-        Type = POWERUP_HEALTH;
-      else if (EntIdx == ENTITY_WEAPON_SHOTGUN) {
-        Type = POWERUP_WEAPON;
-        SubType = WEAPON_SHOTGUN;
-      } else if (EntIdx == ENTITY_WEAPON_GRENADE) {
-        Type = POWERUP_WEAPON;
-        SubType = WEAPON_GRENADE;
-      } else if (EntIdx == ENTITY_WEAPON_LASER) {
-        Type = POWERUP_WEAPON;
-        SubType = WEAPON_LASER;
-      } else if (EntIdx == ENTITY_POWERUP_NINJA) {
-        Type = POWERUP_NINJA;
-        SubType = WEAPON_NINJA;
-      }
-      pCollision->m_pPickups[i].m_Type = Type;
-      pCollision->m_pPickups[i].m_Subtype = SubType;
-      if (pCollision->m_MapData.switch_layer.type) {
-        const int SwitchType = pCollision->m_MapData.switch_layer.type[i];
-        if (SwitchType) {
-          pCollision->m_pPickups[i].m_Type = SwitchType;
-          pCollision->m_pPickups[i].m_Number = pCollision->m_MapData.switch_layer.number[i];
-        }
+        if (pCollision->m_pMoveRestrictions[i][d])
+          MoveRestrictionsFound = 1;
       }
-    }
 
-    pCollision->m_pFrontPickups[i].m_Type = -1;
-    if (pMapData->front_layer.data) {
-      EntIdx = pMapData->front_layer.data[i] - ENTITY_OFFSET;
-      if ((EntIdx >= ENTITY_ARMOR_SHOTGUN && EntIdx <= ENTITY_ARMOR_LASER) || (EntIdx >= ENTITY_ARMOR_1 && EntIdx <= ENTITY_WEAPON_LASER)) {
-        int Type = -1;
-        int SubType = 0;
-        if (EntIdx == ENTITY_ARMOR_1)
-          Type = POWERUP_ARMOR;
-        else if (EntIdx == ENTITY_ARMOR_SHOTGUN)
-          Type = POWERUP_ARMOR_SHOTGUN;
-        else if (EntIdx == ENTITY_ARMOR_GRENADE)
-          Type = POWERUP_ARMOR_GRENADE;
-        else if (EntIdx == ENTITY_ARMOR_NINJA)
-          Type = POWERUP_ARMOR_NINJA;
-        else if (EntIdx == ENTITY_ARMOR_LASER)
-          Type = POWERUP_ARMOR_LASER;
-        else if (EntIdx == ENTITY_HEALTH_1)
-          Type = POWERUP_HEALTH;
-        else if (EntIdx == ENTITY_WEAPON_SHOTGUN) {
-          Type = POWERUP_WEAPON;
-          SubType = WEAPON_SHOTGUN;
-        } else if (EntIdx == ENTITY_WEAPON_GRENADE) {
-          Type = POWERUP_WEAPON;
-          SubType = WEAPON_GRENADE;
-        } else if (EntIdx == ENTITY_WEAPON_LASER) {
-          Type = POWERUP_WEAPON;
-          SubType = WEAPON_LASER;
-        } else if (EntIdx == ENTITY_POWERUP_NINJA) {
-          Type = POWERUP_NINJA;
-          SubType = WEAPON_NINJA;
-        }
-        pCollision->m_pFrontPickups[i].m_Type = Type;
-        pCollision->m_pFrontPickups[i].m_Subtype = SubType;
-        if (pCollision->m_MapData.switch_layer.type) {
-          const int SwitchType = pCollision->m_MapData.switch_layer.type[i];
-          if (SwitchType) {
-            pCollision->m_pFrontPickups[i].m_Type = SwitchType;
-            pCollision->m_pFrontPickups[i].m_Number = pCollision->m_MapData.switch_layer.number[i];
-          }
-        }
-      }
+      init_pickup(&pCollision->m_pPickups[i], pMapData, pMapData->game_layer.data[i] - ENTITY_OFFSET, i);
+      pCollision->m_pFrontPickups[i].m_Type = -1;
+      if (pMapData->front_layer.data)
+        init_pickup(&pCollision->m_pFrontPickups[i], pMapData, pMapData->front_layer.data[i] - ENTITY_OFFSET, i);
+      if (pCollision->m_pSpeedups)
+        init_speedup(&pCollision->m_pSpeedups[i], pMapData, i);
     }
   }
 
+  pCollision->m_HighestSwitchNumber = HighestSwitchNumber;
+  pCollision->m_MoveRestrictionsFound = MoveRestrictionsFound;
+  if (NoPlayerCollision)
+    pCollision->m_aTuningList[0].m_PlayerCollision = 0;
+  if (NoPlayerHooking)
+    pCollision->m_aTuningList[0].m_PlayerHooking = 0;
+}
+
+// Everything that depends on the tiles around: pickups and death tiles next to a tile, ground below it, whether the broad checks have
+// to look at it and stoppers in reach. Only the layers and the tables of init_tiles are read, so the rows can run in any order.
+static void init_tile_neighbours(SCollision *pCollision) {
+  static const mvec2 DIRECTIONS[NUM_MR_DIRS] = {CTVEC2(0, 0), CTVEC2(18, 0), CTVEC2(0, 18), CTVEC2(-18, 0), CTVEC2(0, -18)};
+  const map_data_t *pMapData = &pCollision->m_MapData;
+  const unsigned char *pGame = pMapData->game_layer.data;
+  const unsigned char *pFront = pMapData->front_layer.data;
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+
+#pragma omp parallel for schedule(static)
   for (int y = 0; y < Height; ++y) {
     for (int x = 0; x < Width; ++x) {
-      const int Idx = pCollision->m_pWidthLookup[y] + x;
+      const int Idx = y * Width + x;
+      uint8_t Info = pCollision->m_pTileInfos[Idx];
       for (int dy = -1; dy <= 1; ++dy) {
         for (int dx = -1; dx <= 1; ++dx) {
-          const int dIdx = pCollision->m_pWidthLookup[iclamp(y + dy, 0, Height - 1)] + iclamp(x + dx, 0, Width - 1);
-          if (pCollision->m_pPickups[dIdx].m_Type > 0)
-            pCollision->m_pTileInfos[Idx] |= INFO_PICKUPNEXT;
-          if (pCollision->m_pFrontPickups[dIdx].m_Type > 0)
-            pCollision->m_pTileInfos[Idx] |= INFO_PICKUPNEXT;
-          if (pCollision->m_MapData.game_layer.data[dIdx] == TILE_DEATH ||
-              (pCollision->m_MapData.front_layer.data && pCollision->m_MapData.front_layer.data[dIdx] == TILE_DEATH))
-            pCollision->m_pTileInfos[Idx] |= INFO_CANHITKILL;
+          const int dIdx = iclamp(y + dy, 0, Height - 1) * Width + iclamp(x + dx, 0, Width - 1);
+          if (pCollision->m_pPickups[dIdx].m_Type > 0 || pCollision->m_pFrontPickups[dIdx].m_Type > 0)
+            Info |= INFO_PICKUPNEXT;
+          if (pGame[dIdx] == TILE_DEATH || (pFront && pFront[dIdx] == TILE_DEATH))
+            Info |= INFO_CANHITKILL;
         }
       }
 
+      // reads the game layer instead of INFO_ISSOLID, the row below belongs to another thread
       for (int i = -1; i <= 1; ++i) {
-        if (pCollision->m_pTileInfos[pCollision->m_pWidthLookup[iclamp(y + 1, 0, Height - 1)] + iclamp(x + i, 0, Width - 1)] & INFO_ISSOLID)
-          pCollision->m_pTileInfos[Idx] |= INFO_CANGROUND;
+        const int Below = pGame[iclamp(y + 1, 0, Height - 1) * Width + iclamp(x + i, 0, Width - 1)];
+        if (Below == TILE_SOLID || Below == TILE_NOHOOK)
+          Info |= INFO_CANGROUND;
       }
-    }
-  }
-
-  if (pCollision->m_NumSpawnPoints > 0)
-    pCollision->m_pSpawnPoints = malloc(pCollision->m_NumSpawnPoints * sizeof(mvec2));
-  if (pMapData->tele_layer.type) {
-    for (int i = 0; i < 256; ++i) {
-      if (pCollision->m_aNumTeleOuts[i] > 0)
-        pCollision->m_apTeleOuts[i] = malloc(pCollision->m_aNumTeleOuts[i] * sizeof(mvec2));
-      if (pCollision->m_aNumTeleCheckOuts[i] > 0)
-        pCollision->m_apTeleCheckOuts[i] = malloc(pCollision->m_aNumTeleCheckOuts[i] * sizeof(mvec2));
-    }
-  }
 
-  for (int i = 0; i < MapSize; ++i) {
-    if (pCollision->m_MapData.game_layer.data[i])
-      pCollision->m_pTileBroadCheck[i] = true;
-    else if (pCollision->m_MapData.front_layer.data && pCollision->m_MapData.front_layer.data[i])
-      pCollision->m_pTileBroadCheck[i] = true;
-    else if (pCollision->m_MapData.tele_layer.type && pCollision->m_MapData.tele_layer.type[i])
-      pCollision->m_pTileBroadCheck[i] = true;
-    else if (pCollision->m_MapData.switch_layer.type && pCollision->m_MapData.switch_layer.type[i])
-      pCollision->m_pTileBroadCheck[i] = true;
-    else if (pCollision->m_pTileInfos[i] & INFO_TILENEXT)
-      pCollision->m_pTileBroadCheck[i] = true;
-  }
+      pCollision->m_pTileBroadCheck[Idx] = pGame[Idx] || (pFront && pFront[Idx]) ||
+                                           (pMapData->tele_layer.type && pMapData->tele_layer.type[Idx]) ||
+                                           (pMapData->switch_layer.type && pMapData->switch_layer.type[Idx]) || (Info & INFO_TILENEXT);
 
-  for (int y = 0; y < Height; ++y) {
-    for (int x = 0; x < Width; ++x) {
-      static const mvec2 DIRECTIONS[NUM_MR_DIRS] = {CTVEC2(0, 0), CTVEC2(18, 0), CTVEC2(0, 18), CTVEC2(-18, 0), CTVEC2(0, -18)};
-      unsigned char Restrictions = 0;
 #pragma clang loop unroll(full)
       for (int d = 0; d < NUM_MR_DIRS; d++) {
         mvec2 NewPos = vvclamp(vvadd(vec2_init(x * 32 + 16, y * 32 + 16), DIRECTIONS[d]), vec2_init(0, 0),
-                               vec2_init((pCollision->m_MapData.width * 32) - 16, (pCollision->m_MapData.height * 32) - 16));
-        int ModMapIndex = get_pure_map_index(pCollision, NewPos);
-
-        Restrictions |= pCollision->m_pMoveRestrictions[ModMapIndex][d];
+                               vec2_init((Width * 32) - 16, (Height * 32) - 16));
+        int ModMapIndex = ((int)(vgety(NewPos) + 0.5f) >> 5) * Width + ((int)(vgetx(NewPos) + 0.5f) >> 5);
 
-        if (pCollision->m_MapData.door_layer.index && pCollision->m_MapData.door_layer.index[ModMapIndex]) {
-          Restrictions |=
-              move_restrictions(d, pCollision->m_MapData.door_layer.index[ModMapIndex], pCollision->m_MapData.door_layer.flags[ModMapIndex]);
-        }
+        unsigned char Restrictions = pCollision->m_pMoveRestrictions[ModMapIndex][d];
+        if (pMapData->door_layer.index && pMapData->door_layer.index[ModMapIndex])
+          Restrictions |= move_restrictions(d, pMapData->door_layer.index[ModMapIndex], pMapData->door_layer.flags[ModMapIndex]);
         if (Restrictions) {
-          pCollision->m_pTileInfos[y * Width + x] |= INFO_CANHITSTOPPER;
+          Info |= INFO_CANHITSTOPPER;
           break;
         }
       }
+      pCollision->m_pTileInfos[Idx] = Info;
     }
   }
+}
 
-  // init_distance_field(pCollision);
+static uint32_t tile_actions(int Tile) {
+  switch (Tile) {
+  case TILE_START: return 1u << ACTION_START;
+  case TILE_FINISH: return 1u << ACTION_FINISH;
+  case TILE_FREEZE: return 1u << ACTION_FREEZE;
+  case TILE_UNFREEZE: return 1u << ACTION_UNFREEZE;
+  case TILE_DFREEZE: return 1u << ACTION_DFREEZE;
+  case TILE_DUNFREEZE: return 1u << ACTION_DUNFREEZE;
+  case TILE_LFREEZE: return 1u << ACTION_LFREEZE;
+  case TILE_LUNFREEZE: return 1u << ACTION_LUNFREEZE;
+  case TILE_EHOOK_ENABLE: return 1u << ACTION_EHOOK_ENABLE;
+  case TILE_EHOOK_DISABLE: return 1u << ACTION_EHOOK_DISABLE;
+  case TILE_HIT_DISABLE: return 1u << ACTION_HIT_DISABLE;
+  case TILE_HIT_ENABLE: return 1u << ACTION_HIT_ENABLE;
+  case TILE_NPC_DISABLE: return 1u << ACTION_NPC_DISABLE;
+  case TILE_NPC_ENABLE: return 1u << ACTION_NPC_ENABLE;
+  case TILE_NPH_DISABLE: return 1u << ACTION_NPH_DISABLE;
+  case TILE_NPH_ENABLE: return 1u << ACTION_NPH_ENABLE;
+  case TILE_UNLIMITED_JUMPS_ENABLE: return 1u << ACTION_UNLIMITED_JUMPS_ENABLE;
+  case TILE_UNLIMITED_JUMPS_DISABLE: return 1u << ACTION_UNLIMITED_JUMPS_DISABLE;
+  case TILE_WALLJUMP: return 1u << ACTION_WALLJUMP;
+  case TILE_JETPACK_ENABLE: return 1u << ACTION_JETPACK_ENABLE;
+  case TILE_JETPACK_DISABLE: return 1u << ACTION_JETPACK_DISABLE;
+  case TILE_REFILL_JUMPS: return 1u << ACTION_REFILL_JUMPS;
+  case TILE_TELE_GUN_ENABLE: return 1u << ACTION_TELE_GUN_ENABLE;
+  case TILE_TELE_GUN_DISABLE: return 1u << ACTION_TELE_GUN_DISABLE;
+  case TILE_TELE_GRENADE_ENABLE: return 1u << ACTION_TELE_GRENADE_ENABLE;
+  case TILE_TELE_GRENADE_DISABLE: return 1u << ACTION_TELE_GRENADE_DISABLE;
+  case TILE_TELE_LASER_ENABLE: return 1u << ACTION_TELE_LASER_ENABLE;
+  case TILE_TELE_LASER_DISABLE: return 1u << ACTION_TELE_LASER_DISABLE;
+  default: return 0;
+  }
+}
 
-  for (int y = 0; y < Height; ++y) {
-    for (int x = 0; x < Width; ++x) {
-      const int Idx = pCollision->m_pWidthLookup[y] + x;
-      const int maxX = imin((Width - 1) - x, 7);
-      const int maxY = imin((Height - 1) - y, 7);
-
-      // Set bitfield for all sub-rectangles
-      for (int dy = 0; dy <= maxY; ++dy) {
-        for (int dx = 0; dx <= maxX; ++dx) {
-          const uint64_t BitIdx = (uint64_t)1 << (dy * 8 + dx);
-          for (int iy = y; iy <= y + dy; ++iy) {
-            const unsigned char *pRowBroad = pCollision->m_pTileBroadCheck + pCollision->m_pWidthLookup[iy];
-            const unsigned char *pRowInfos = pCollision->m_pTileInfos + pCollision->m_pWidthLookup[iy];
-            const unsigned char *pRowTele =
-                pCollision->m_MapData.tele_layer.type ? pCollision->m_MapData.tele_layer.type + pCollision->m_pWidthLookup[y] : NULL;
-            for (int ix = x; ix <= x + dx; ++ix) {
-              if (pRowBroad[ix])
-                pCollision->m_pBroadIndicesBitField[Idx] |= BitIdx;
-              if (pRowInfos[ix] & INFO_ISSOLID)
-                pCollision->m_pBroadSolidBitField[Idx] |= BitIdx;
-              if (pRowTele && (pRowTele[x] == TILE_TELEINHOOK || pRowTele[x] == TILE_TELEINWEAPON))
-                pCollision->m_pBroadTeleInBitField[Idx] |= BitIdx;
-            }
-          }
-        }
-      }
+// What cc_handle_tiles and cc_handle_skippable_tiles can do on every tile, read from the layers and the tile infos of
+// init_tile_neighbours.
+static bool init_tile_actions(SCollision *pCollision) {
+  // the second tile of these pairs only counts if the first one isn't there, whatever state the tee is in. The tele laser pair is
+  // missing, its enable tile only wins if the tee doesn't have the tele laser yet.
+  static const int s_aaPairs[][2] = {{ACTION_FREEZE, ACTION_UNFREEZE},
+                                     {ACTION_DFREEZE, ACTION_DUNFREEZE},
+                                     {ACTION_LFREEZE, ACTION_LUNFREEZE},
+                                     {ACTION_EHOOK_ENABLE, ACTION_EHOOK_DISABLE},
+                                     {ACTION_HIT_DISABLE, ACTION_HIT_ENABLE},
+                                     {ACTION_NPC_DISABLE, ACTION_NPC_ENABLE},
+                                     {ACTION_NPH_DISABLE, ACTION_NPH_ENABLE},
+                                     {ACTION_UNLIMITED_JUMPS_ENABLE, ACTION_UNLIMITED_JUMPS_DISABLE},
+                                     {ACTION_JETPACK_ENABLE, ACTION_JETPACK_DISABLE},
+                                     {ACTION_TELE_GUN_ENABLE, ACTION_TELE_GUN_DISABLE},
+                                     {ACTION_TELE_GRENADE_ENABLE, ACTION_TELE_GRENADE_DISABLE}};
+  const map_data_t *pMapData = &pCollision->m_MapData;
+  const unsigned char *pFront = pMapData->front_layer.data;
+  const unsigned char *pTele = pMapData->tele_layer.type;
+  const unsigned char *pSwitch = pMapData->switch_layer.type;
+  const unsigned char *pSpeedup = pMapData->speedup_layer.type ? pMapData->speedup_layer.force : NULL;
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+
+  pCollision->m_pTileActions = alloc_table(pCollision->m_AllocPolicy, (size_t)Width * Height * sizeof(uint32_t));
+  if (!pCollision->m_pTileActions) {
+    printf("Error: could not allocate %zu bytes for the tile actions\n", (size_t)Width * Height * sizeof(uint32_t));
+    return false;
+  }
 
-// This works, validation not necessary currently
-#if 0
-      for (int dy = 0; dy <= maxY; ++dy) {
-        for (int dx = 0; dx <= maxX; ++dx) {
-          bool Hit = false;
-          for (int ay = y; ay <= y + dy; ++ay) {
-            const unsigned char *rowStart = pCollision->m_pTileInfos + pCollision->m_pWidthLookup[ay];
-            for (int ax = x; ax <= x + dx; ++ax) {
-              if (rowStart[ax] & INFO_ISSOLID) {
-                Hit = true;
-                break;
-              }
-            }
-            if (Hit)
-              break;
-          }
-
-          // Check the corresponding bit in the bitfield
-          const uint64_t BitIdx = (uint64_t)1 << (dy * 8 + dx);
-          uint64_t Opt = pCollision->m_pBroadSolidBitField[Idx] & BitIdx;
-          if (Hit != (bool)Opt) {
-            printf("ERROR at (%d, %d) for size (%d, %d): Hit: %d, Opt: %lu\n", x, y, dx, dy, Hit, Opt);
-          }
-        }
-      }
-#endif
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < Height; ++y) {
+    for (int i = y * Width; i < (y + 1) * Width; ++i) {
+      uint32_t Actions = tile_actions(pMapData->game_layer.data[i]) | (pFront ? tile_actions(pFront[i]) : 0);
+      for (size_t p = 0; p < sizeof(s_aaPairs) / sizeof(s_aaPairs[0]); ++p)
+        if (Actions & 1u << s_aaPairs[p][0])
+          Actions &= ~(1u << s_aaPairs[p][1]);
+      if (pTele && pMapData->tele_layer.number[i] &&
+          (pTele[i] == TILE_TELEIN || pTele[i] == TILE_TELEINEVIL || pTele[i] == TILE_TELECHECKINEVIL || pTele[i] == TILE_TELECHECK ||
+           pTele[i] == TILE_TELECHECKIN))
+        Actions |= 1u << ACTION_TELE;
+      if (pSwitch && pSwitch[i])
+        Actions |= 1u << ACTION_SWITCH;
+      if (pCollision->m_pTileInfos[i] & INFO_CANHITKILL)
+        Actions |= 1u << ACTION_HITKILL;
+      if (pSpeedup && pSpeedup[i] > 0)
+        Actions |= 1u << ACTION_SPEEDUP;
+      pCollision->m_pTileActions[i] = Actions;
     }
   }
+  return true;
+}
 
-  // for (int i = 0; i < MapSize; ++i) {
-  //   if (i % Width == 0)
-  //     printf("\n");
-  //   printf(pCollision->m_pTileInfos[i] & INFO_ISSOLID ? "@" : "'");
-  // }
+// Bit dy * 8 + dx of a tile is set if the dx + 1 by dy + 1 rectangle starting there holds a tile of the layer. The first pass ORs the
+// tiles along the rows into one byte per tile with a bit for every width, the second one ORs up to 8 of those bytes below each other
+// for the heights. That are 16 steps per tile instead of one for every tile of every rectangle.
+static bool init_broad_bitfields(SCollision *pCollision) {
+  const int Width = pCollision->m_TableWidth;
+  const int Height = pCollision->m_TableHeight;
+  const size_t MapSize = (size_t)Width * Height;
+  const unsigned char *pTele = pCollision->m_MapData.tele_layer.type;
 
-  if (!pMapData->tele_layer.type && !pCollision->m_NumSpawnPoints)
-    return true;
+  pCollision->m_pBroadSolidBitField = alloc_table(pCollision->m_AllocPolicy, MapSize * sizeof(uint64_t));
+  pCollision->m_pBroadIndicesBitField = alloc_table(pCollision->m_AllocPolicy, MapSize * sizeof(uint64_t));
+  pCollision->m_pBroadTeleInBitField = pTele ? alloc_table(pCollision->m_AllocPolicy, MapSize * sizeof(uint64_t)) : NULL;
+  uint8_t *pRows = _mm_malloc(MapSize * NUM_BROAD_LAYERS, 64);
+  if (!pCollision->m_pBroadSolidBitField || !pCollision->m_pBroadIndicesBitField || (pTele && !pCollision->m_pBroadTeleInBitField) || !pRows) {
+    printf("Error: could not allocate %zu bytes for the broad bit fields\n", MapSize * (NUM_BROAD_LAYERS * sizeof(uint64_t) + NUM_BROAD_LAYERS));
+    if (pRows)
+      _mm_free(pRows);
+    return false;
+  }
+  uint64_t *apFields[NUM_BROAD_LAYERS] = {pCollision->m_pBroadSolidBitField, pCollision->m_pBroadIndicesBitField,
+                                          pCollision->m_pBroadTeleInBitField};
 
-  int aTeleIdx[256] = {0}, aTeleCheckIdx[256] = {0}, SpawnPointIdx = 0;
+#pragma omp parallel for schedule(static)
   for (int y = 0; y < Height; ++y) {
-    for (int x = 0; x < Width; ++x) {
-      const int Idx = pCollision->m_pWidthLookup[y] + x;
-      if (pCollision->m_NumSpawnPoints) {
-        if ((pMapData->game_layer.data[Idx] >= 192 && pMapData->game_layer.data[Idx] <= 194) ||
-            (pMapData->front_layer.data && pMapData->front_layer.data[Idx] >= 192 && pMapData->front_layer.data[Idx] <= 194))
-          pCollision->m_pSpawnPoints[SpawnPointIdx++] = vec2_init(x, y);
+    uint8_t aRow[NUM_BROAD_LAYERS] = {0};
+    for (int x = Width - 1; x >= 0; --x) {
+      const size_t Idx = (size_t)y * Width + x;
+      // widths that would leave the map stay unset
+      const uint8_t Keep = Width - 1 - x >= 7 ? 0xff : (1 << (Width - x)) - 1;
+      const bool aHit[NUM_BROAD_LAYERS] = {pCollision->m_pTileInfos[Idx] & INFO_ISSOLID, pCollision->m_pTileBroadCheck[Idx],
+                                           pTele && (pTele[Idx] == TILE_TELEINHOOK || pTele[Idx] == TILE_TELEINWEAPON)};
+      for (int l = 0; l < NUM_BROAD_LAYERS; ++l) {
+        aRow[l] = (aHit[l] ? 0xff : aRow[l] << 1) & Keep;
+        pRows[l * MapSize + Idx] = aRow[l];
       }
-      if (pMapData->tele_layer.type) {
-        if (pMapData->tele_layer.type[Idx] == TILE_TELEOUT)
-          pCollision->m_apTeleOuts[pMapData->tele_layer.number[Idx]][aTeleIdx[pMapData->tele_layer.number[Idx]]++] =
-              vec2_init((x * 32.f) + 16.f, (y * 32.f) + 16.f);
-        if (pMapData->tele_layer.type[Idx] == TILE_TELECHECKOUT)
-          pCollision->m_apTeleCheckOuts[pMapData->tele_layer.number[Idx]][aTeleCheckIdx[pMapData->tele_layer.number[Idx]]++] =
-              vec2_init((x * 32.f) + 16.f, (y * 32.f) + 16.f);
+    }
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < Height; ++y) {
+    const int MaxY = imin((Height - 1) - y, 7);
+    for (int l = 0; l < NUM_BROAD_LAYERS; ++l) {
+      if (!apFields[l])
+        continue;
+      const uint8_t *pLayerRows = pRows + l * MapSize;
+      for (int x = 0; x < Width; ++x) {
+        uint64_t Field = 0;
+        uint8_t Column = 0;
+        for (int dy = 0; dy <= MaxY; ++dy) {
+          Column |= pLayerRows[(size_t)(y + dy) * Width + x];
+          Field |= (uint64_t)Column << (dy * 8);
+        }
+        apFields[l][(size_t)y * Width + x] = Field;
       }
     }
   }
 
+  _mm_free(pRows);
+  return true;
+}
+
+// SCollision now OWNS the pMap data, DO NOT FREE IT. A failed init frees it along with the tables
+bool init_collision(SCollision *__restrict__ pCollision, map_data_t *__restrict__ pMap) {
+  return init_collision_backend(pCollision, pMap, BROAD_BACKEND_BITFIELDS, COLLISION_ALLOC_HUGE_PAGES);
+}
+
+bool init_collision_backend(SCollision *__restrict__ pCollision, map_data_t *__restrict__ pMap, int BroadBackend, int AllocPolicy) {
+  // the counters and the tables of the backend that isn't used start out empty
+  memset(pCollision, 0, sizeof(SCollision));
+  pCollision->m_MapData = *pMap;
+  pCollision->m_BroadBackend = BroadBackend;
+  pCollision->m_AllocPolicy = AllocPolicy;
+  double Time = init_clock();
+  // every failure below goes to fail, which frees whatever was allocated up to there along with the map
+  if (!expand_and_shift_map(&pCollision->m_MapData, MAP_EXPAND_STORED) || !pCollision->m_MapData.game_layer.data)
+    goto fail;
+
+  // all tables are built for the stored tiles, the rest of the border only exists in the lookups
+  map_data_t *pMapData = &pCollision->m_MapData;
+  const int Width = pMapData->width;
+  const int Height = pMapData->height;
+  const int MapSize = Width * Height;
+  pCollision->m_TableWidth = Width;
+  pCollision->m_TableHeight = Height;
+  pMapData->width += 2 * (MAP_EXPAND - MAP_EXPAND_STORED);
+  pMapData->height += 2 * (MAP_EXPAND - MAP_EXPAND_STORED);
+  if (!init_lookups(pCollision))
+    goto fail;
+
+  pCollision->m_pTileInfos = alloc_table(pCollision->m_AllocPolicy, MapSize * sizeof(char) + TILE_INFOS_PADDING);
+  pCollision->m_pTileBroadCheck = alloc_table(pCollision->m_AllocPolicy, MapSize * sizeof(char));
+  pCollision->m_pMoveRestrictions = alloc_table(pCollision->m_AllocPolicy, MapSize * NUM_MR_DIRS * sizeof(char));
+  pCollision->m_pPickups = alloc_table(pCollision->m_AllocPolicy, MapSize * sizeof(SPickup));
+  pCollision->m_pFrontPickups = alloc_table(pCollision->m_AllocPolicy, MapSize * sizeof(SPickup));
+  if (pMapData->speedup_layer.type)
+    pCollision->m_pSpeedups = alloc_table(pCollision->m_AllocPolicy, MapSize * sizeof(SSpeedup));
+  if (!pCollision->m_pTileInfos || !pCollision->m_pTileBroadCheck || !pCollision->m_pMoveRestrictions || !pCollision->m_pPickups ||
+      !pCollision->m_pFrontPickups || (pMapData->speedup_layer.type && !pCollision->m_pSpeedups)) {
+    printf("Error: could not allocate the tile tables\n");
+    goto fail;
+  }
+  memset(pCollision->m_pTileInfos, 0, MapSize * sizeof(char) + TILE_INFOS_PADDING);
+  memset(pCollision->m_pMoveRestrictions, 0, MapSize * NUM_MR_DIRS * sizeof(char));
+  memset(pCollision->m_pPickups, 0, MapSize * sizeof(SPickup));
+  memset(pCollision->m_pFrontPickups, 0, MapSize * sizeof(SPickup));
+  if (pCollision->m_pSpeedups)
+    memset(pCollision->m_pSpeedups, 0, MapSize * sizeof(SSpeedup));
+
+  for (int i = 0; i < NUM_TUNE_ZONES; ++i)
+    init_tuning_params(&pCollision->m_aTuningList[i]);
+
+  // every stage only reads what the stages before it wrote, the rows inside of a stage are split between threads
+  double Now = init_clock();
+  pCollision->m_aInitTimes[INIT_STAGE_EXPAND] = Now - Time;
+  Time = Now;
+
+  init_tiles(pCollision);
+  Now = init_clock();
+  pCollision->m_aInitTimes[INIT_STAGE_TILES] = Now - Time;
+  Time = Now;
+
+  init_tile_neighbours(pCollision);
+  Now = init_clock();
+  pCollision->m_aInitTimes[INIT_STAGE_NEIGHBOURS] = Now - Time;
+  Time = Now;
+
+  if (!init_distance_field(pCollision))
+    goto fail;
+  Now = init_clock();
+  pCollision->m_aInitTimes[INIT_STAGE_DISTANCE_FIELD] = Now - Time;
+  Time = Now;
+
+  if (!(BroadBackend == BROAD_BACKEND_COMPACT ? init_broad_bits(pCollision) : init_broad_bitfields(pCollision)))
+    goto fail;
+  Now = init_clock();
+  pCollision->m_aInitTimes[INIT_STAGE_BROAD] = Now - Time;
+  Time = Now;
+
+  if (!init_broad_pyramids(pCollision))
+    goto fail;
+  if (BroadBackend == BROAD_BACKEND_COMPACT) {
+    // only needed to build the bit planes and pyramids
+    _mm_free(pCollision->m_pTileBroadCheck);
+    pCollision->m_pTileBroadCheck = NULL;
+  }
+  Now = init_clock();
+  pCollision->m_aInitTimes[INIT_STAGE_PYRAMIDS] = Now - Time;
+  Time = Now;
+
+  if (!init_spawns_and_tele_outs(pCollision))
+    goto fail;
+  Now = init_clock();
+  pCollision->m_aInitTimes[INIT_STAGE_SPAWNS] = Now - Time;
+  Time = Now;
+
+  if (!init_tile_actions(pCollision))
+    goto fail;
+  Now = init_clock();
+  pCollision->m_aInitTimes[INIT_STAGE_TILE_ACTIONS] = Now - Time;
+  Time = Now;
+
+  if ((AllocPolicy & COLLISION_ALLOC_BLOCKED_TILES) && !init_tile_blocks(pCollision))
+    goto fail;
+  pCollision->m_aInitTimes[INIT_STAGE_TILE_BLOCKS] = init_clock() - Time;
   return true;
+
+fail:
+  free_collision(pCollision);
+  return false;
 }
 
+static void unmap_cache_file(void *pData, size_t Size);
+
 void free_collision(SCollision *pCollision) {
   if (!pCollision)
     return;
+  if (pCollision->m_pCache) {
+    // all tables live in the mapped cache file
+    unmap_cache_file(pCollision->m_pCache, pCollision->m_CacheSize);
+    memset(pCollision, 0, sizeof(SCollision));
+    return;
+  }
 
   free_map_data(&pCollision->m_MapData);
   if (pCollision->m_pPickups)
     _mm_free(pCollision->m_pPickups);
   if (pCollision->m_pFrontPickups)
     _mm_free(pCollision->m_pFrontPickups);
+  if (pCollision->m_pSpeedups)
+    _mm_free(pCollision->m_pSpeedups);
   if (pCollision->m_pMoveRestrictions)
     _mm_free(pCollision->m_pMoveRestrictions);
   if (pCollision->m_pSolidTeleDistanceField)
@@ -863,6 +1364,12 @@ void free_collision(SCollision *pCollision) {
     _mm_free(pCollision->m_pTileBroadCheck);
   if (pCollision->m_pWidthLookup)
     _mm_free(pCollision->m_pWidthLookup);
+  if (pCollision->m_pRowLookup)
+    _mm_free(pCollision->m_pRowLookup);
+  if (pCollision->m_pColumnLookup)
+    _mm_free(pCollision->m_pColumnLookup);
+  if (pCollision->m_pColumnIndexLookup)
+    _mm_free(pCollision->m_pColumnIndexLookup);
   if (pCollision->m_pBroadSolidBitField)
     _mm_free(pCollision->m_pBroadSolidBitField);
   if (pCollision->m_pBroadTeleInBitField)
@@ -871,6 +1378,13 @@ void free_collision(SCollision *pCollision) {
     _mm_free(pCollision->m_pBroadIndicesBitField);
   if (pCollision->m_pTileInfos)
     _mm_free(pCollision->m_pTileInfos);
+  if (pCollision->m_pTileActions)
+    _mm_free(pCollision->m_pTileActions);
+  for (int i = 0; i < NUM_BROAD_LAYERS; ++i) {
+    free_broad_pyramid(&pCollision->m_aBroadPyramids[i]);
+    if (pCollision->m_apBroadBits[i])
+      _mm_free(pCollision->m_apBroadBits[i]);
+  }
 
   // Free spawn points
   if (pCollision->m_NumSpawnPoints)
@@ -886,10 +1400,395 @@ void free_collision(SCollision *pCollision) {
   memset(pCollision, 0, sizeof(SCollision));
 }
 
+static size_t broad_pyramid_memory(const SBroadPyramid *pPyramid) {
+  size_t Size = 0;
+  for (int i = 0; i < pPyramid->m_NumLevels; ++i)
+    if (pPyramid->m_apLevels[i])
+      Size += (size_t)pPyramid->m_aWidth[i] * pPyramid->m_aHeight[i];
+  return Size;
+}
+
+void collision_memory(const SCollision *pCollision, SCollisionMemory *pOut) {
+  const map_data_t *pMap = &pCollision->m_MapData;
+  const size_t MapSize = (size_t)pCollision->m_TableWidth * pCollision->m_TableHeight;
+  // with blocked tiles the tables read through map_index hold whole blocks
+  const size_t TileSize = tile_table_size(pCollision);
+  memset(pOut, 0, sizeof(*pOut));
+
+  // every present layer array has one element per tile
+  const void *apByteLayers[] = {pMap->game_layer.data,     pMap->game_layer.flags,   pMap->front_layer.data,   pMap->front_layer.flags,
+                                pMap->tele_layer.number,   pMap->tele_layer.type,    pMap->speedup_layer.force, pMap->speedup_layer.max_speed,
+                                pMap->speedup_layer.type,  pMap->switch_layer.number, pMap->switch_layer.type, pMap->switch_layer.flags,
+                                pMap->switch_layer.delay,  pMap->door_layer.index,   pMap->door_layer.flags,   pMap->tune_layer.number,
+                                pMap->tune_layer.type};
+  for (size_t i = 0; i < sizeof(apByteLayers) / sizeof(apByteLayers[0]); ++i)
+    if (apByteLayers[i])
+      pOut->m_MapLayers += TileSize;
+  if (pMap->speedup_layer.angle)
+    pOut->m_MapLayers += TileSize * sizeof(short);
+  if (pMap->door_layer.number)
+    pOut->m_MapLayers += TileSize * sizeof(int);
+
+  pOut->m_WidthLookup = pCollision->m_pWidthLookup ? 2 * ((size_t)pMap->height + pMap->width) * sizeof(uint32_t) : 0;
+  pOut->m_TileInfos = pCollision->m_pTileInfos ? TileSize : 0;
+  pOut->m_TileActions = pCollision->m_pTileActions ? TileSize * sizeof(uint32_t) : 0;
+  pOut->m_TileBroadCheck = pCollision->m_pTileBroadCheck ? TileSize : 0;
+  pOut->m_MoveRestrictions = pCollision->m_pMoveRestrictions ? TileSize * sizeof(pCollision->m_pMoveRestrictions[0]) : 0;
+  pOut->m_Pickups = ((pCollision->m_pPickups ? 1 : 0) + (pCollision->m_pFrontPickups ? 1 : 0)) * TileSize * sizeof(SPickup);
+  pOut->m_Speedups = pCollision->m_pSpeedups ? TileSize * sizeof(SSpeedup) : 0;
+  pOut->m_DistanceField = pCollision->m_pSolidTeleDistanceField ? TileSize : 0;
+  pOut->m_BroadBitFields = ((pCollision->m_pBroadSolidBitField ? 1 : 0) + (pCollision->m_pBroadIndicesBitField ? 1 : 0) +
+                            (pCollision->m_pBroadTeleInBitField ? 1 : 0)) *
+                           MapSize * sizeof(uint64_t);
+  for (int i = 0; i < NUM_BROAD_LAYERS; ++i) {
+    if (pCollision->m_apBroadBits[i])
+      pOut->m_BroadBits += (size_t)pCollision->m_BroadBitsStride * pCollision->m_TableHeight * sizeof(uint64_t);
+    pOut->m_BroadPyramids += broad_pyramid_memory(&pCollision->m_aBroadPyramids[i]);
+  }
+
+  pOut->m_Total = pOut->m_MapLayers + pOut->m_WidthLookup + pOut->m_TileInfos + pOut->m_TileActions + pOut->m_TileBroadCheck +
+                  pOut->m_MoveRestrictions + pOut->m_Pickups + pOut->m_Speedups + pOut->m_DistanceField + pOut->m_BroadBitFields +
+                  pOut->m_BroadBits + pOut->m_BroadPyramids;
+}
+
+enum {
+  CACHE_VERSION = 5,
+  CACHE_ALIGNMENT = 64,
+  CACHE_BYTE_ORDER = 0x01020304,
+  // map layers, lookups, tables, pyramid levels, spawn points and the tele out lists
+  CACHE_MAX_TABLES = 19 + 4 + 15 + NUM_BROAD_LAYERS * BROAD_MAX_LEVELS + 1 + 2 * 256,
+};
+
+static const char CACHE_MAGIC[8] = "DDPCOLL";
+
+typedef struct CacheHeader {
+  char m_aMagic[8];
+  uint32_t m_Version;
+  // a cache can only be read by a build with the same struct layout and byte order
+  uint32_t m_CollisionSize;
+  uint32_t m_ByteOrder;
+  uint32_t m_NumTables;
+  uint64_t m_FileSize;
+} SCacheHeader;
+
+// Where a table lives in the file, a size of 0 is a table that doesn't exist.
+typedef struct CacheEntry {
+  uint64_t m_Offset;
+  uint64_t m_Size;
+} SCacheEntry;
+
+typedef struct CacheTable {
+  void **m_ppData;
+  size_t m_Size;
+} SCacheTable;
+
+static void add_cache_table(SCacheTable *pTables, int *pNum, void *ppData, size_t Size) {
+  pTables[*pNum].m_ppData = ppData;
+  pTables[*pNum].m_Size = Size;
+  ++*pNum;
+}
+
+// Every table of the collision in a fixed order with the size it has if it exists. The sizes only depend on the scalars of the
+// collision, so a loaded header gives the same list as the collision it was saved from.
+static int collision_cache_tables(SCollision *pCollision, SCacheTable *pTables) {
+  map_data_t *pMap = &pCollision->m_MapData;
+  const size_t MapSize = (size_t)pCollision->m_TableWidth * pCollision->m_TableHeight;
+  const size_t TileSize = tile_table_size(pCollision);
+  int Num = 0;
+
+  void *apByteLayers[] = {&pMap->game_layer.data,     &pMap->game_layer.flags,   &pMap->front_layer.data,   &pMap->front_layer.flags,
+                          &pMap->tele_layer.number,   &pMap->tele_layer.type,    &pMap->speedup_layer.force, &pMap->speedup_layer.max_speed,
+                          &pMap->speedup_layer.type,  &pMap->switch_layer.number, &pMap->switch_layer.type, &pMap->switch_layer.flags,
+                          &pMap->switch_layer.delay,  &pMap->door_layer.index,   &pMap->door_layer.flags,   &pMap->tune_layer.number,
+                          &pMap->tune_layer.type};
+  for (size_t i = 0; i < sizeof(apByteLayers) / sizeof(apByteLayers[0]); ++i)
+    add_cache_table(pTables, &Num, apByteLayers[i], TileSize);
+  add_cache_table(pTables, &Num, &pMap->speedup_layer.angle, TileSize * sizeof(short));
+  add_cache_table(pTables, &Num, &pMap->door_layer.number, TileSize * sizeof(int));
+
+  add_cache_table(pTables, &Num, &pCollision->m_pWidthLookup, pMap->height * sizeof(uint32_t));
+  add_cache_table(pTables, &Num, &pCollision->m_pRowLookup, pMap->height * sizeof(uint32_t));
+  add_cache_table(pTables, &Num, &pCollision->m_pColumnLookup, pMap->width * sizeof(uint32_t));
+  add_cache_table(pTables, &Num, &pCollision->m_pColumnIndexLookup, pMap->width * sizeof(uint32_t));
+
+  add_cache_table(pTables, &Num, &pCollision->m_pBroadSolidBitField, MapSize * sizeof(uint64_t));
+  add_cache_table(pTables, &Num, &pCollision->m_pBroadIndicesBitField, MapSize * sizeof(uint64_t));
+  add_cache_table(pTables, &Num, &pCollision->m_pBroadTeleInBitField, MapSize * sizeof(uint64_t));
+  add_cache_table(pTables, &Num, &pCollision->m_pTileInfos, TileSize + TILE_INFOS_PADDING);
+  add_cache_table(pTables, &Num, &pCollision->m_pTileActions, TileSize * sizeof(uint32_t));
+  add_cache_table(pTables, &Num, &pCollision->m_pPickups, TileSize * sizeof(SPickup));
+  add_cache_table(pTables, &Num, &pCollision->m_pFrontPickups, TileSize * sizeof(SPickup));
+  add_cache_table(pTables, &Num, &pCollision->m_pSpeedups, TileSize * sizeof(SSpeedup));
+  add_cache_table(pTables, &Num, &pCollision->m_pMoveRestrictions, TileSize * sizeof(pCollision->m_pMoveRestrictions[0]));
+  add_cache_table(pTables, &Num, &pCollision->m_pTileBroadCheck, TileSize);
+  add_cache_table(pTables, &Num, &pCollision->m_pSolidTeleDistanceField, TileSize);
+  for (int l = 0; l < NUM_BROAD_LAYERS; ++l)
+    add_cache_table(pTables, &Num, &pCollision->m_apBroadBits[l],
+                    (size_t)pCollision->m_BroadBitsStride * pCollision->m_TableHeight * sizeof(uint64_t));
+
+  for (int l = 0; l < NUM_BROAD_LAYERS; ++l) {
+    SBroadPyramid *pPyramid = &pCollision->m_aBroadPyramids[l];
+    for (int i = 0; i < BROAD_MAX_LEVELS; ++i) {
+      const size_t LevelSize = i < pPyramid->m_NumLevels ? (size_t)pPyramid->m_aWidth[i] * pPyramid->m_aHeight[i] : 0;
+      add_cache_table(pTables, &Num, &pPyramid->m_apLevels[i], LevelSize);
+    }
+  }
+
+  add_cache_table(pTables, &Num, &pCollision->m_pSpawnPoints, pCollision->m_NumSpawnPoints * sizeof(mvec2));
+  for (int i = 0; i < 256; ++i) {
+    add_cache_table(pTables, &Num, &pCollision->m_apTeleOuts[i], pCollision->m_aNumTeleOuts[i] * sizeof(mvec2));
+    add_cache_table(pTables, &Num, &pCollision->m_apTeleCheckOuts[i], pCollision->m_aNumTeleCheckOuts[i] * sizeof(mvec2));
+  }
+  return Num;
+}
+
+static size_t cache_align(size_t Offset) { return (Offset + CACHE_ALIGNMENT - 1) & ~(size_t)(CACHE_ALIGNMENT - 1); }
+
+static bool write_cache_file(const char *pPath, const SCacheHeader *pHeader, const SCollision *pScalars, const SCacheEntry *pEntries,
+                             const void **ppTables) {
+  FILE *pFile = fopen(pPath, "wb");
+  if (!pFile)
+    return false;
+  static const uint8_t s_aZeros[CACHE_ALIGNMENT] = {0};
+  size_t Written = 0;
+  bool Ok = true;
+  // pads with zeros up to the offset of the next part
+#define WRITE_AT(Offset, pData, Size)                                                                                                                \
+  do {                                                                                                                                               \
+    Ok = Ok && fwrite(s_aZeros, 1, (Offset) - Written, pFile) == (Offset) - Written && fwrite((pData), 1, (Size), pFile) == (Size);               \
+    Written = (Offset) + (Size);                                                                                                                     \
+  } while (0)
+  WRITE_AT(0, pHeader, sizeof(SCacheHeader));
+  WRITE_AT(cache_align(sizeof(SCacheHeader)), pScalars, sizeof(SCollision));
+  WRITE_AT(cache_align(cache_align(sizeof(SCacheHeader)) + sizeof(SCollision)), pEntries, pHeader->m_NumTables * sizeof(SCacheEntry));
+  for (uint32_t i = 0; i < pHeader->m_NumTables; ++i)
+    if (pEntries[i].m_Size)
+      WRITE_AT(pEntries[i].m_Offset, ppTables[i], pEntries[i].m_Size);
+  WRITE_AT(pHeader->m_FileSize, s_aZeros, 0);
+#undef WRITE_AT
+  return fclose(pFile) == 0 && Ok;
+}
+
+bool save_collision_cache(const SCollision *pCollision, const char *pPath) {
+  // the scalars are stored as a copy of the collision with all pointers cleared
+  SCollision *pScalars = malloc(sizeof(SCollision));
+  SCacheTable *pTables = malloc(CACHE_MAX_TABLES * sizeof(SCacheTable));
+  SCacheEntry *pEntries = malloc(CACHE_MAX_TABLES * sizeof(SCacheEntry));
+  const void **ppTables = malloc(CACHE_MAX_TABLES * sizeof(void *));
+  char *pTempPath = malloc(strlen(pPath) + 5);
+  if (!pScalars || !pTables || !pEntries || !ppTables || !pTempPath) {
+    printf("Error: could not allocate the collision cache directory\n");
+    free(pScalars);
+    free(pTables);
+    free(pEntries);
+    free(ppTables);
+    free(pTempPath);
+    return false;
+  }
+
+  memcpy(pScalars, pCollision, sizeof(SCollision));
+  const int NumTables = collision_cache_tables(pScalars, pTables);
+  size_t Offset = cache_align(cache_align(cache_align(sizeof(SCacheHeader)) + sizeof(SCollision)) + NumTables * sizeof(SCacheEntry));
+  for (int i = 0; i < NumTables; ++i) {
+    ppTables[i] = *pTables[i].m_ppData;
+    *pTables[i].m_ppData = NULL;
+    pEntries[i].m_Size = ppTables[i] ? pTables[i].m_Size : 0;
+    pEntries[i].m_Offset = pEntries[i].m_Size ? Offset : 0;
+    Offset = cache_align(Offset + pEntries[i].m_Size);
+  }
+  const int Width = pScalars->m_MapData.width;
+  const int Height = pScalars->m_MapData.height;
+  memset(&pScalars->m_MapData, 0, sizeof(map_data_t));
+  pScalars->m_MapData.width = Width;
+  pScalars->m_MapData.height = Height;
+  pScalars->m_pCache = NULL;
+  pScalars->m_CacheSize = 0;
+
+  SCacheHeader Header;
+  memset(&Header, 0, sizeof(Header));
+  memcpy(Header.m_aMagic, CACHE_MAGIC, sizeof(Header.m_aMagic));
+  Header.m_Version = CACHE_VERSION;
+  Header.m_CollisionSize = sizeof(SCollision);
+  Header.m_ByteOrder = CACHE_BYTE_ORDER;
+  Header.m_NumTables = NumTables;
+  Header.m_FileSize = Offset;
+
+  // written next to the cache and renamed over it, processes that still map the old file keep reading the old one
+  sprintf(pTempPath, "%s.tmp", pPath);
+  bool Result = write_cache_file(pTempPath, &Header, pScalars, pEntries, ppTables);
+#ifdef _WIN32
+  if (Result)
+    remove(pPath);
+#endif
+  Result = Result && rename(pTempPath, pPath) == 0;
+  if (!Result) {
+    printf("Error: could not write the collision cache %s\n", pPath);
+    remove(pTempPath);
+  }
+
+  free(pScalars);
+  free(pTables);
+  free(pEntries);
+  free(ppTables);
+  free(pTempPath);
+  return Result;
+}
+
+static void *map_cache_file(const char *pPath, size_t *pSize) {
+#ifdef _WIN32
+  FILE *pFile = fopen(pPath, "rb");
+  if (!pFile)
+    return NULL;
+  void *pData = NULL;
+  if (fseek(pFile, 0, SEEK_END) == 0) {
+    const long Size = ftell(pFile);
+    if (Size > 0 && fseek(pFile, 0, SEEK_SET) == 0) {
+      pData = _mm_malloc(Size, CACHE_ALIGNMENT);
+      if (pData && fread(pData, 1, Size, pFile) != (size_t)Size) {
+        _mm_free(pData);
+        pData = NULL;
+      }
+      *pSize = Size;
+    }
+  }
+  fclose(pFile);
+  return pData;
+#else
+  const int Fd = open(pPath, O_RDONLY);
+  if (Fd < 0)
+    return NULL;
+  struct stat Stat;
+  void *pData = NULL;
+  if (fstat(Fd, &Stat) == 0 && Stat.st_size > 0) {
+    pData = mmap(NULL, Stat.st_size, PROT_READ, MAP_SHARED, Fd, 0);
+    if (pData == MAP_FAILED)
+      pData = NULL;
+    *pSize = Stat.st_size;
+  }
+  close(Fd);
+  return pData;
+#endif
+}
+
+static void unmap_cache_file(void *pData, size_t Size) {
+#ifdef _WIN32
+  (void)Size;
+  _mm_free(pData);
+#else
+  munmap(pData, Size);
+#endif
+}
+
+// Writable memory aligned to a huge page that unmap_cache_file releases. Size has to be a multiple of HUGE_PAGE_SIZE.
+static void *alloc_cache_block(size_t Size) {
+#ifdef _WIN32
+  return _mm_malloc(Size, HUGE_PAGE_SIZE);
+#else
+  // mmap only aligns to pages, so map one huge page more and cut off what is left around the aligned block
+  uint8_t *pMapping = mmap(NULL, Size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pMapping == MAP_FAILED)
+    return NULL;
+  uint8_t *pData = (uint8_t *)(((uintptr_t)pMapping + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+  if (pData > pMapping)
+    munmap(pMapping, pData - pMapping);
+  munmap(pData + Size, pMapping + HUGE_PAGE_SIZE - pData);
+  return pData;
+#endif
+}
+
+bool load_collision_cache(SCollision *pCollision, const char *pPath) {
+  memset(pCollision, 0, sizeof(SCollision));
+  size_t Size = 0;
+  uint8_t *pData = map_cache_file(pPath, &Size);
+  if (!pData) {
+    printf("Error: could not map the collision cache %s\n", pPath);
+    return false;
+  }
+
+  const SCacheHeader *pHeader = (const SCacheHeader *)pData;
+  const size_t CollisionOffset = cache_align(sizeof(SCacheHeader));
+  const size_t EntriesOffset = cache_align(CollisionOffset + sizeof(SCollision));
+  if (Size < EntriesOffset || memcmp(pHeader->m_aMagic, CACHE_MAGIC, sizeof(pHeader->m_aMagic)) != 0 || pHeader->m_Version != CACHE_VERSION ||
+      pHeader->m_CollisionSize != sizeof(SCollision) || pHeader->m_ByteOrder != CACHE_BYTE_ORDER || pHeader->m_FileSize != Size ||
+      pHeader->m_NumTables > CACHE_MAX_TABLES || Size < EntriesOffset + pHeader->m_NumTables * sizeof(SCacheEntry)) {
+    printf("Error: %s is not a collision cache of this build\n", pPath);
+    unmap_cache_file(pData, Size);
+    return false;
+  }
+
+  SCacheTable *pTables = malloc(CACHE_MAX_TABLES * sizeof(SCacheTable));
+  if (!pTables) {
+    printf("Error: could not allocate the collision cache directory\n");
+    unmap_cache_file(pData, Size);
+    return false;
+  }
+  memcpy(pCollision, pData + CollisionOffset, sizeof(SCollision));
+  const SCacheEntry *pEntries = (const SCacheEntry *)(pData + EntriesOffset);
+  const int NumTables = collision_cache_tables(pCollision, pTables);
+  bool Valid = (uint32_t)NumTables == pHeader->m_NumTables;
+  for (int i = 0; Valid && i < NumTables; ++i) {
+    const SCacheEntry Entry = pEntries[i];
+    if (Entry.m_Size && (Entry.m_Size != pTables[i].m_Size || Entry.m_Offset % CACHE_ALIGNMENT || Entry.m_Offset > Size ||
+                         Entry.m_Size > Size - Entry.m_Offset))
+      Valid = false;
+    // nothing writes to the tables after init_collision, so they can point right into the read-only mapping
+    *pTables[i].m_ppData = Entry.m_Size ? pData + Entry.m_Offset : NULL;
+  }
+  free(pTables);
+  if (!Valid) {
+    printf("Error: the collision cache %s is damaged\n", pPath);
+    unmap_cache_file(pData, Size);
+    memset(pCollision, 0, sizeof(SCollision));
+    return false;
+  }
+
+  pCollision->m_pCache = pData;
+  pCollision->m_CacheSize = Size;
+  return true;
+}
+
+bool replicate_collision(SCollision *pReplica, const SCollision *pCollision) {
+  SCacheTable *pTables = malloc(CACHE_MAX_TABLES * sizeof(SCacheTable));
+  if (!pTables) {
+    printf("Error: could not allocate the table list of a collision replica\n");
+    return false;
+  }
+  memcpy(pReplica, pCollision, sizeof(SCollision));
+  const int NumTables = collision_cache_tables(pReplica, pTables);
+  size_t Size = 0;
+  for (int i = 0; i < NumTables; ++i)
+    Size = cache_align(Size) + (*pTables[i].m_ppData ? pTables[i].m_Size : 0);
+  Size = (Size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  uint8_t *pData = alloc_cache_block(Size);
+  if (!pData) {
+    printf("Error: could not allocate %zu bytes for a collision replica\n", Size);
+    free(pTables);
+    memset(pReplica, 0, sizeof(SCollision));
+    return false;
+  }
+  advise_huge_pages(pCollision->m_AllocPolicy, pData, Size);
+
+  // the copy is the first write to the block, which places its pages on the node of this thread
+  size_t Offset = 0;
+  for (int i = 0; i < NumTables; ++i) {
+    const void *pTable = *pTables[i].m_ppData;
+    Offset = cache_align(Offset);
+    *pTables[i].m_ppData = pTable ? memcpy(pData + Offset, pTable, pTables[i].m_Size) : NULL;
+    Offset += pTable ? pTables[i].m_Size : 0;
+  }
+  free(pTables);
+#ifndef _WIN32
+  mprotect(pData, Size, PROT_READ);
+#endif
+  pReplica->m_pCache = pData;
+  pReplica->m_CacheSize = Size;
+  return true;
+}
+
 int get_pure_map_index(SCollision *pCollision, mvec2 Pos) {
   const int nx = (int)(vgetx(Pos) + 0.5f) >> 5;
   const int ny = (int)(vgety(Pos) + 0.5f) >> 5;
-  return pCollision->m_pWidthLookup[ny] + nx;
+  return map_index(pCollision, nx, ny);
 }
 
 static unsigned char get_move_restrictions_raw(unsigned char Tile, unsigned char Flags) {
@@ -961,7 +1860,7 @@ unsigned char is_tele_checkpoint(SCollision *pCollision, int Index) {
 unsigned char get_collision_at(SCollision *pCollision, mvec2 Pos) {
   const int Nx = (int)vgetx(Pos) >> 5;
   const int Ny = (int)vgety(Pos) >> 5;
-  const unsigned char Idx = pCollision->m_MapData.game_layer.data[pCollision->m_pWidthLookup[Ny] + Nx];
+  const unsigned char Idx = pCollision->m_MapData.game_layer.data[map_index(pCollision, Nx, Ny)];
   return Idx * (Idx - 1 <= TILE_NOLASER - 1);
 }
 __attribute__((unused)) static unsigned char get_collision_at_idx(SCollision *pCollision, int Idx) {
@@ -972,7 +1871,7 @@ __attribute__((unused)) static unsigned char get_collision_at_idx(SCollision *pC
 unsigned char get_front_collision_at(SCollision *pCollision, mvec2 Pos) {
   const int Nx = (int)vgetx(Pos) >> 5;
   const int Ny = (int)vgety(Pos) >> 5;
-  const int pos = pCollision->m_pWidthLookup[Ny] + Nx;
+  const int pos = map_index(pCollision, Nx, Ny);
   const unsigned char Idx = pCollision->m_MapData.front_layer.data[pos];
   return Idx * (Idx - 1 <= TILE_NOLASER - 1);
 }
@@ -1007,7 +1906,7 @@ unsigned char get_move_restrictions(SCollision *__restrict__ pCollision, void *_
 int get_map_index(SCollision *pCollision, mvec2 Pos) {
   const int Nx = (int)vgetx(Pos) >> 5;
   const int Ny = (int)vgety(Pos) >> 5;
-  const int Index = pCollision->m_pWidthLookup[Ny] + Nx;
+  const int Index = map_index(pCollision, Nx, Ny);
   if (pCollision->m_pTileInfos[Index] & INFO_TILENEXT)
     return Index;
   return -1;
@@ -1016,7 +1915,7 @@ int get_map_index(SCollision *pCollision, mvec2 Pos) {
 bool check_point(SCollision *pCollision, mvec2 Pos) {
   const int Nx = (int)(vgetx(Pos) + 0.5f) >> 5;
   const int Ny = (int)(vgety(Pos) + 0.5f) >> 5;
-  return pCollision->m_pTileInfos[pCollision->m_pWidthLookup[Ny] + Nx] & INFO_ISSOLID;
+  return pCollision->m_pTileInfos[map_index(pCollision, Nx, Ny)] & INFO_ISSOLID;
 }
 
 static bool check_point_idx(SCollision *pCollision, int Idx) { return pCollision->m_pTileInfos[Idx] & INFO_ISSOLID; }
@@ -1105,12 +2004,9 @@ static bool broad_check(const SCollision *__restrict__ pCollision, mvec2 Start,
   const int MinY = (int)vgety(MinVec) >> 5;
   const int MaxX = (int)vgetx(MaxVec) >> 5;
   const int MaxY = (int)vgety(MaxVec) >> 5;
-  const int DiffY = (MaxY - MinY);
-  const int DiffX = (MaxX - MinX);
   if (MinY < 0 || MaxY >= pCollision->m_MapData.height || MinX < 0 || MaxX >= pCollision->m_MapData.width)
     return 0;
-
-  return (bool)(pCollision->m_pBroadSolidBitField[(MinY * pCollision->m_MapData.width) + MinX] & (uint64_t)1 << ((DiffY << 3) + DiffX));
+  return broad_rect_check(pCollision, BROAD_SOLID, MinX, MinY, MaxX, MaxY);
 }
 
 static bool broad_check_tele(const SCollision *__restrict__ pCollision, mvec2 Start, mvec2 End) {
@@ -1120,12 +2016,9 @@ static bool broad_check_tele(const SCollision *__restrict__ pCollision, mvec2 St
   const int MinY = (int)vgety(MinVec) >> 5;
   const int MaxX = (int)vgetx(MaxVec) >> 5;
   const int MaxY = (int)vgety(MaxVec) >> 5;
-  const int DiffY = (MaxY - MinY);
-  const int DiffX = (MaxX - MinX);
   if (MinY < 0 || MaxY >= pCollision->m_MapData.height || MinX < 0 || MaxX >= pCollision->m_MapData.width)
     return 0;
-
-  return (bool)(pCollision->m_pBroadTeleInBitField[pCollision->m_pWidthLookup[MinY] + MinX] & (uint64_t)1 << ((DiffY << 3) + DiffX));
+  return broad_rect_check(pCollision, BROAD_TELE_IN, MinX, MinY, MaxX, MaxY);
 }
 
 #define TILE_SHIFT 5
@@ -1141,7 +2034,6 @@ unsigned char intersect_line_tele_hook(SCollision *__restrict__ pCollision, mvec
     return 0;
   }
 
-  const int Width = pCollision->m_MapData.width;
   const unsigned char *game = pCollision->m_MapData.game_layer.data; /* tile array */
 
   const float x0 = vgetx(Pos0);
@@ -1155,7 +2047,7 @@ unsigned char intersect_line_tele_hook(SCollision *__restrict__ pCollision, mvec
   if (dx == 0.0f && dy == 0.0f) {
     int ix = ((int)(x0 + 0.5f)) >> TILE_SHIFT;
     int iy = ((int)(y0 + 0.5f)) >> TILE_SHIFT;
-    int idx = iy * Width + ix;
+    int idx = map_index(pCollision, ix, iy);
 
     if (pTeleNr) {
       unsigned char tele = is_teleport_hook(pCollision, idx);
@@ -1216,30 +2108,40 @@ unsigned char intersect_line_tele_hook(SCollision *__restrict__ pCollision, mvec
   through_offset(Pos0, Pos1, &off_dx, &off_dy);
 
   float u = 0.0f;
-  int idx = mapY * Width + mapX;
+  int idx = 0;
 
+  // tiles left that the distance field proved empty
+  int Free = 0;
   for (;;) {
-    if (pTeleNr) {
-      unsigned char tele = is_teleport_hook(pCollision, idx);
-      if (tele) {
-        *pTeleNr = tele;
-        *pOutCollision = vvfmix(Pos0, Pos1, u);
-        return TILE_TELEINHOOK;
-      }
+    if (!Free) {
+      idx = map_index(pCollision, mapX, mapY);
+      Free = pCollision->m_pSolidTeleDistanceField[idx];
     }
+    if (Free) {
+      --Free;
+    } else {
+      if (pTeleNr) {
+        unsigned char tele = is_teleport_hook(pCollision, idx);
+        if (tele) {
+          *pTeleNr = tele;
+          *pOutCollision = vvfmix(Pos0, Pos1, u);
+          return TILE_TELEINHOOK;
+        }
+      }
 
-    if (check_point_idx(pCollision, idx)) {
+      if (check_point_idx(pCollision, idx)) {
 
-      int tx = (int)(x0 + u * dx + 0.5f);
-      int ty = (int)(y0 + u * dy + 0.5f);
+        int tx = (int)(x0 + u * dx + 0.5f);
+        int ty = (int)(y0 + u * dy + 0.5f);
 
-      if (!is_through(pCollision, tx, ty, off_dx, off_dy, Pos0, Pos1)) {
+        if (!is_through(pCollision, tx, ty, off_dx, off_dy, Pos0, Pos1)) {
+          *pOutCollision = vvfmix(Pos0, Pos1, u);
+          return game[idx];
+        }
+      } else if (is_hook_blocker(pCollision, idx, Pos0, Pos1)) {
         *pOutCollision = vvfmix(Pos0, Pos1, u);
-        return game[idx];
+        return TILE_NOHOOK;
       }
-    } else if (is_hook_blocker(pCollision, idx, Pos0, Pos1)) {
-      *pOutCollision = vvfmix(Pos0, Pos1, u);
-      return TILE_NOHOOK;
     }
 
     if (mapX == endX && mapY == endY)
@@ -1247,12 +2149,10 @@ unsigned char intersect_line_tele_hook(SCollision *__restrict__ pCollision, mvec
 
     if (tMaxX < tMaxY) {
       mapX += stepX;
-      idx += stepX;
       u = tMaxX;
       tMaxX += tDeltaX;
     } else {
       mapY += stepY;
-      idx += stepY * Width;
       u = tMaxY;
       tMaxY += tDeltaY;
     }
@@ -1261,7 +2161,6 @@ unsigned char intersect_line_tele_hook(SCollision *__restrict__ pCollision, mvec
       u = 1.0f;
       mapX = endX;
       mapY = endY;
-      idx = endY * Width + endX;
       break;
     }
   }
@@ -1278,7 +2177,6 @@ unsigned char intersect_line_tele_weapon(SCollision *__restrict__ pCollision, mv
   if (vgety(Pos0) < vgety(Pos1))                                                                                                                     \
     *pOutCollision = vsety(*pOutCollision, vgety(*pOutCollision) - 1);
 
-  const int Width = pCollision->m_MapData.width;
   const unsigned char *game = pCollision->m_MapData.game_layer.data;
 
   const float x0 = vgetx(Pos0);
@@ -1292,7 +2190,7 @@ unsigned char intersect_line_tele_weapon(SCollision *__restrict__ pCollision, mv
   if (dx == 0.0f && dy == 0.0f) {
     int ix = ((int)(x0 + 0.5f)) >> TILE_SHIFT;
     int iy = ((int)(y0 + 0.5f)) >> TILE_SHIFT;
-    int idx = iy * Width + ix;
+    int idx = map_index(pCollision, ix, iy);
 
     if (pTeleNr) {
       unsigned char tele = is_teleport_hook(pCollision, idx);
@@ -1345,36 +2243,44 @@ unsigned char intersect_line_tele_weapon(SCollision *__restrict__ pCollision, mv
   }
 
   float u = 0.0f;
-  int idx = mapY * Width + mapX;
+  int idx = 0;
 
+  // tiles left that the distance field proved empty
+  int Free = 0;
   for (;;) {
-    if (pTeleNr) {
-      unsigned char tele = is_teleport_weapon(pCollision, idx);
-      if (tele) {
-        *pTeleNr = tele;
+    if (!Free) {
+      idx = map_index(pCollision, mapX, mapY);
+      Free = pCollision->m_pSolidTeleDistanceField[idx];
+    }
+    if (Free) {
+      --Free;
+    } else {
+      if (pTeleNr) {
+        unsigned char tele = is_teleport_weapon(pCollision, idx);
+        if (tele) {
+          *pTeleNr = tele;
+          *pOutCollision = vvfmix(Pos0, Pos1, u);
+          NORMALIZE()
+          return TILE_TELEINWEAPON;
+        }
+      }
+
+      if (check_point_idx(pCollision, idx)) {
         *pOutCollision = vvfmix(Pos0, Pos1, u);
         NORMALIZE()
-        return TILE_TELEINWEAPON;
+        return game[idx];
       }
     }
 
-    if (check_point_idx(pCollision, idx)) {
-      *pOutCollision = vvfmix(Pos0, Pos1, u);
-      NORMALIZE()
-      return game[idx];
-    }
-
     if (mapX == endX && mapY == endY)
       break;
 
     if (tMaxX < tMaxY) {
       mapX += stepX;
-      idx += stepX;
       u = tMaxX;
       tMaxX += tDeltaX;
     } else {
       mapY += stepY;
-      idx += stepY * Width;
       u = tMaxY;
       tMaxY += tDeltaY;
     }
@@ -1383,7 +2289,6 @@ unsigned char intersect_line_tele_weapon(SCollision *__restrict__ pCollision, mv
       u = 1.0f;
       mapX = endX;
       mapY = endY;
-      idx = endY * Width + endX;
       break;
     }
   }
@@ -1425,15 +2330,29 @@ bool is_speedup(SCollision *pCollision, int Index) {
 
 void get_speedup(SCollision *__restrict__ pCollision, int Index, mvec2 *__restrict__ pDir, int *__restrict__ pForce, int *__restrict__ pMaxSpeed,
                  int *__restrict__ pType) {
-  float Angle = pCollision->m_MapData.speedup_layer.angle[Index] * (PI / 180.0f);
-  *pForce = pCollision->m_MapData.speedup_layer.force[Index];
-  *pType = pCollision->m_MapData.speedup_layer.type[Index];
-  *pDir = vdirection(Angle);
+  const SSpeedup *pSpeedup = &pCollision->m_pSpeedups[Index];
+  *pForce = pSpeedup->m_Force;
+  *pType = pSpeedup->m_Type;
+  *pDir = vec2_init(pSpeedup->m_aDirection[0], pSpeedup->m_aDirection[1]);
   if (pMaxSpeed)
-    *pMaxSpeed = pCollision->m_MapData.speedup_layer.max_speed[Index];
+    *pMaxSpeed = pSpeedup->m_MaxSpeed;
+}
+
+// Map index of the I-th of End + 1 evenly spaced samples between Pos0 and Pos1, the sample itself is stored in pPos.
+static inline int line_sample_idx(const SCollision *__restrict__ pCollision, mvec2 Pos0, mvec2 Pos1, int I, int End, mvec2 *__restrict__ pPos) {
+  float a = I / (float)End;
+  mvec2 Pos = vvfmix(Pos0, Pos1, a);
+  if (pPos)
+    *pPos = Pos;
+  int Nx = (int)(vgetx(Pos) + 0.5f) >> 5;
+  int Ny = (int)(vgety(Pos) + 0.5f) >> 5;
+  return map_index(pCollision, Nx, Ny);
 }
 
-// TODO: do the same optimization as in intersect_line_tele_hook
+// Same result as testing every sample one unit apart like DDNet does. The sample coordinates only ever grow or only ever shrink along
+// the line, so the samples of one tile form a single run. Only the first sample of each run is looked at: the end of a run is
+// estimated from the distance to the next tile border and then corrected on the real samples. Once the tile box between the current
+// run and the last sample holds no solid tile the rest of the line is skipped through the broad bit field.
 bool intersect_line(SCollision *__restrict__ pCollision, mvec2 Pos0, mvec2 Pos1, mvec2 *__restrict__ pOutCollision,
                     mvec2 *__restrict__ pOutBeforeCollision) {
   if (!broad_check(pCollision, Pos0, Pos1)) {
@@ -1442,26 +2361,58 @@ bool intersect_line(SCollision *__restrict__ pCollision, mvec2 Pos0, mvec2 Pos1,
     return 0;
   }
 
+  const int Width = pCollision->m_MapData.width;
+  const int Height = pCollision->m_MapData.height;
+  const float x0 = vgetx(Pos0);
+  const float y0 = vgety(Pos0);
+  const float dx = vgetx(Pos1) - x0;
+  const float dy = vgety(Pos1) - y0;
+
   float Distance = vdistance(Pos0, Pos1);
   int End = Distance + 1;
+  mvec2 EndPos;
+  line_sample_idx(pCollision, Pos0, Pos1, End, End, &EndPos);
+  const int EndX = (int)(vgetx(EndPos) + 0.5f) >> 5;
+  const int EndY = (int)(vgety(EndPos) + 0.5f) >> 5;
+
   mvec2 Last = Pos0;
-  int LastIdx = -1;
-  for (int i = 0; i <= End; i++) {
-    float a = i / (float)End;
-    mvec2 Pos = vvfmix(Pos0, Pos1, a);
-    int Nx = (int)(vgetx(Pos) + 0.5f) >> 5;
-    int Ny = (int)(vgety(Pos) + 0.5f) >> 5;
-    int Idx = pCollision->m_pWidthLookup[Ny] + Nx;
-    if (LastIdx == Idx)
-      continue;
-    LastIdx = Idx;
+  int i = 0;
+  while (i <= End) {
+    mvec2 Pos;
+    int Idx = line_sample_idx(pCollision, Pos0, Pos1, i, End, &Pos);
     if (check_point_idx(pCollision, Idx)) {
       *pOutCollision = Pos;
       *pOutBeforeCollision = Last;
       return true;
     }
-
     Last = Pos;
+
+    const int Nx = (int)(vgetx(Pos) + 0.5f) >> 5;
+    const int Ny = (int)(vgety(Pos) + 0.5f) >> 5;
+    const int MinX = imin(Nx, EndX);
+    const int MinY = imin(Ny, EndY);
+    const int MaxX = imax(Nx, EndX);
+    const int MaxY = imax(Ny, EndY);
+    if (MinX >= 0 && MinY >= 0 && MaxX < Width && MaxY < Height && MaxX - MinX < 8 && MaxY - MinY < 8 &&
+        !broad_rect_check(pCollision, BROAD_SOLID, MinX, MinY, MaxX, MaxY))
+      break;
+
+    // first sample past the next tile border
+    float Next = End + 1;
+    if (dx != 0.0f) {
+      float Border = ((dx > 0.0f ? Nx + 1 : Nx) << 5) - 0.5f;
+      Next = fminf(Next, (Border - x0) / dx * End);
+    }
+    if (dy != 0.0f) {
+      float Border = ((dy > 0.0f ? Ny + 1 : Ny) << 5) - 0.5f;
+      Next = fminf(Next, (Border - y0) / dy * End);
+    }
+    int NextRun = Next > i + 1 ? (int)Next : i + 1;
+    while (NextRun > i + 1 && line_sample_idx(pCollision, Pos0, Pos1, NextRun - 1, End, NULL) != Idx)
+      --NextRun;
+    while (NextRun <= End && line_sample_idx(pCollision, Pos0, Pos1, NextRun, End, NULL) == Idx)
+      ++NextRun;
+    i = NextRun;
   }
   *pOutCollision = Pos1;
   *pOutBeforeCollision = Pos1;
@@ -1469,7 +2420,7 @@ bool intersect_line(SCollision *__restrict__ pCollision, mvec2 Pos0, mvec2 Pos1,
 }
 
 static bool check_point_int(const SCollision *__restrict__ pCollision, int x, int y) {
-  return pCollision->m_pTileInfos[(y >> 5) * pCollision->m_MapData.width + (x >> 5)] & INFO_ISSOLID;
+  return pCollision->m_pTileInfos[map_index(pCollision, x >> 5, y >> 5)] & INFO_ISSOLID;
 }
 
 static bool test_box_character(const SCollision *__restrict__ pCollision, int x, int y) {
@@ -1509,18 +2460,17 @@ void move_box(const SCollision *__restrict__ pCollision, mvec2 Pos, mvec2 Vel, m
   const int MinY = (int)vgety(minAdj) >> 5;
   const int MaxX = (int)vgetx(maxAdj) >> 5;
   const int MaxY = (int)vgety(maxAdj) >> 5;
-  // bitshift by the index in the 8x8 block (max 63)
-  const uint64_t Mask = (uint64_t)1 << (((MaxY - MinY) << 3) + (MaxX - MinX));
-  const uint64_t IsSolid = pCollision->m_pBroadSolidBitField[(MinY * pCollision->m_MapData.width) + MinX] & Mask;
-  if (!IsSolid) {
+  if (!broad_rect_check(pCollision, BROAD_SOLID, MinX, MinY, MaxX, MaxY)) {
     *pOutPos = vvadd(Pos, Vel);
     return;
   }
-  const unsigned short Max = s_aMaxTable[(int)Distance];
+  // the tables cover moves shorter than 384 units
+  const int Max = Distance < 384 * 384 ? s_aMaxTable[(int)Distance] : (int)sqrtf(Distance);
+  const float Fraction = Max < 384 ? s_aFractionTable[Max] : 1.0f / (float)(Max + 1);
   uivec2 IPos = (uivec2){(int)(vgetx(Pos) + 0.5f), (int)(vgety(Pos) + 0.5f)};
   uivec2 INewPos;
   for (int i = 0; i <= Max; i++) {
-    NewPos = vvadd(Pos, vfmul(Vel, s_aFractionTable[Max]));
+    NewPos = vvadd(Pos, vfmul(Vel, Fraction));
     INewPos = (uivec2){(int)(vgetx(NewPos) + 0.5f), (int)(vgety(NewPos) + 0.5f)};
     if (test_box_character(pCollision, INewPos.x, INewPos.y)) {
       bool Hit = false;
@@ -1550,6 +2500,229 @@ void move_box(const SCollision *__restrict__ pCollision, mvec2 Pos, mvec2 Vel, m
   *pOutVel = Vel;
 }
 
+static inline __m256i x8_lane_mask(int LaneMask) {
+  const __m256i Bits = _mm256_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7);
+  return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(LaneMask), Bits), Bits);
+}
+
+// broad_rect_check of BROAD_SOLID for the rectangles of the lanes in LaneMask, returns the lanes without a solid tile. The 8x8 bit
+// fields are gathered, the compact backend and bigger rectangles ask broad_table_rect_check lane by lane.
+static int x8_broad_solid_free(const SCollision *pCollision, __m256i MinX, __m256i MinY, __m256i MaxX, __m256i MaxY, int LaneMask) {
+  const __m256i Zero = _mm256_setzero_si256();
+  const __m256i Mask = x8_lane_mask(LaneMask);
+  MinX = _mm256_mask_i32gather_epi32(Zero, (const int *)pCollision->m_pColumnLookup, MinX, Mask, 4);
+  MaxX = _mm256_mask_i32gather_epi32(Zero, (const int *)pCollision->m_pColumnLookup, MaxX, Mask, 4);
+  MinY = _mm256_mask_i32gather_epi32(Zero, (const int *)pCollision->m_pRowLookup, MinY, Mask, 4);
+  MaxY = _mm256_mask_i32gather_epi32(Zero, (const int *)pCollision->m_pRowLookup, MaxY, Mask, 4);
+
+  int Free = 0;
+  int Slow = LaneMask;
+  if (pCollision->m_BroadBackend != BROAD_BACKEND_COMPACT) {
+    const __m256i DiffX = _mm256_sub_epi32(MaxX, MinX);
+    const __m256i DiffY = _mm256_sub_epi32(MaxY, MinY);
+    const __m256i Seven = _mm256_set1_epi32(7);
+    const __m256i Small = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(DiffX, Seven), _mm256_cmpgt_epi32(DiffY, Seven)), Mask);
+    const __m256i Word = _mm256_add_epi32(_mm256_mullo_epi32(MinY, _mm256_set1_epi32(pCollision->m_TableWidth)), MinX);
+    const __m256i Bit = _mm256_add_epi32(_mm256_slli_epi32(DiffY, 3), DiffX);
+    const long long *pBitField = (const long long *)pCollision->m_pBroadSolidBitField;
+    const __m256i One = _mm256_set1_epi64x(1);
+    int Hit = 0;
+    // four 64 bit words per gather
+    for (int Half = 0; Half < 2; ++Half) {
+      const __m128i HalfWord = Half ? _mm256_extracti128_si256(Word, 1) : _mm256_castsi256_si128(Word);
+      const __m128i HalfSmall = Half ? _mm256_extracti128_si256(Small, 1) : _mm256_castsi256_si128(Small);
+      const __m128i HalfBit = Half ? _mm256_extracti128_si256(Bit, 1) : _mm256_castsi256_si128(Bit);
+      const __m256i Words = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), pBitField, HalfWord, _mm256_cvtepi32_epi64(HalfSmall), 8);
+      const __m256i Bits = _mm256_and_si256(_mm256_srlv_epi64(Words, _mm256_cvtepu32_epi64(HalfBit)), One);
+      Hit |= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(Bits, One))) << (Half * 4);
+    }
+    const int SmallMask = _mm256_movemask_ps(_mm256_castsi256_ps(Small));
+    Free = SmallMask & ~Hit;
+    Slow = LaneMask & ~SmallMask;
+  }
+  if (Slow) {
+    int aMinX[MOVE_BOX_LANES], aMinY[MOVE_BOX_LANES], aMaxX[MOVE_BOX_LANES], aMaxY[MOVE_BOX_LANES];
+    _mm256_storeu_si256((__m256i *)aMinX, MinX);
+    _mm256_storeu_si256((__m256i *)aMinY, MinY);
+    _mm256_storeu_si256((__m256i *)aMaxX, MaxX);
+    _mm256_storeu_si256((__m256i *)aMaxY, MaxY);
+    for (int i = 0; i < MOVE_BOX_LANES; ++i)
+      if (Slow & 1 << i && !broad_table_rect_check(pCollision, BROAD_SOLID, aMinX[i], aMinY[i], aMaxX[i], aMaxY[i]))
+        Free |= 1 << i;
+  }
+  return Free;
+}
+
+// INFO_ISSOLID of the tiles holding the points, the tile infos are gathered as 32 bits
+static inline __m256i x8_check_point_int(const SCollision *pCollision, __m256i X, __m256i Y, __m256i Mask) {
+  const __m256i Zero = _mm256_setzero_si256();
+  const __m256i Row = _mm256_mask_i32gather_epi32(Zero, (const int *)pCollision->m_pWidthLookup, _mm256_srai_epi32(Y, 5), Mask, 4);
+  const __m256i Column = _mm256_mask_i32gather_epi32(Zero, (const int *)pCollision->m_pColumnIndexLookup, _mm256_srai_epi32(X, 5), Mask, 4);
+  const __m256i Infos = _mm256_mask_i32gather_epi32(Zero, (const int *)pCollision->m_pTileInfos, _mm256_add_epi32(Row, Column), Mask, 1);
+  return _mm256_and_si256(Infos, _mm256_set1_epi32(INFO_ISSOLID));
+}
+
+// test_box_character for the lanes in Mask, returns all bits set for the lanes that hit
+static inline __m256i x8_test_box_character(const SCollision *pCollision, __m256i X, __m256i Y, __m256i Mask) {
+  const __m256i One = _mm256_set1_epi32(1);
+  const __m256i Frac = _mm256_set1_epi32(31);
+  const __m256i Check = _mm256_or_si256(_mm256_sllv_epi32(One, _mm256_and_si256(X, Frac)), _mm256_sllv_epi32(One, _mm256_and_si256(Y, Frac)));
+  const __m256i Near = _mm256_and_si256(Check, _mm256_set1_epi32((1 << 13) | (1 << 18)));
+  Mask = _mm256_andnot_si256(_mm256_cmpeq_epi32(Near, _mm256_setzero_si256()), Mask);
+  if (_mm256_testz_si256(Mask, Mask))
+    return Mask;
+
+  const __m256i Half = _mm256_set1_epi32(HALFPHYSICALSIZE);
+  const __m256i Left = _mm256_sub_epi32(X, Half);
+  const __m256i Right = _mm256_add_epi32(X, Half);
+  const __m256i Top = _mm256_sub_epi32(Y, Half);
+  const __m256i Bottom = _mm256_add_epi32(Y, Half);
+  const __m256i Solid = _mm256_or_si256(
+      _mm256_or_si256(x8_check_point_int(pCollision, Left, Bottom, Mask), x8_check_point_int(pCollision, Right, Bottom, Mask)),
+      _mm256_or_si256(x8_check_point_int(pCollision, Left, Top, Mask), x8_check_point_int(pCollision, Right, Top, Mask)));
+  return _mm256_andnot_si256(_mm256_cmpeq_epi32(Solid, _mm256_setzero_si256()), Mask);
+}
+
+void move_box_x8(const SCollision *__restrict__ pCollision, SMoveBoxLanes *__restrict__ pLanes, int LaneMask) {
+  // the lengths and step counts stay scalar so they round exactly like in move_box
+  int aMax[MOVE_BOX_LANES];
+  float aFraction[MOVE_BOX_LANES];
+  int NumSteps = -1;
+  for (int i = 0; i < MOVE_BOX_LANES; ++i) {
+    aMax[i] = -1;
+    aFraction[i] = 0.0f;
+    if (!(LaneMask & 1 << i))
+      continue;
+    const float Distance = vsqlength(vec2_init(pLanes->m_aVelX[i], pLanes->m_aVelY[i]));
+    if (Distance <= 0.00001f * 0.00001f) {
+      LaneMask &= ~(1 << i);
+      continue;
+    }
+    aMax[i] = Distance < 384 * 384 ? s_aMaxTable[(int)Distance] : (int)sqrtf(Distance);
+    aFraction[i] = aMax[i] < 384 ? s_aFractionTable[aMax[i]] : 1.0f / (float)(aMax[i] + 1);
+  }
+  if (!LaneMask)
+    return;
+
+  __m256 PosX = _mm256_loadu_ps(pLanes->m_aPosX);
+  __m256 PosY = _mm256_loadu_ps(pLanes->m_aPosY);
+  __m256 VelX = _mm256_loadu_ps(pLanes->m_aVelX);
+  __m256 VelY = _mm256_loadu_ps(pLanes->m_aVelY);
+
+  // lanes without a solid tile around their whole move take it in one step
+  const __m256 Offset = _mm256_set1_ps(HALFPHYSICALSIZE + 1.0f);
+  const __m256 EndX = _mm256_add_ps(PosX, VelX);
+  const __m256 EndY = _mm256_add_ps(PosY, VelY);
+  const __m256i MinX = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_sub_ps(_mm256_min_ps(PosX, EndX), Offset)), 5);
+  const __m256i MinY = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_sub_ps(_mm256_min_ps(PosY, EndY), Offset)), 5);
+  const __m256i MaxX = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_max_ps(PosX, EndX), Offset)), 5);
+  const __m256i MaxY = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_max_ps(PosY, EndY), Offset)), 5);
+  const int Free = x8_broad_solid_free(pCollision, MinX, MinY, MaxX, MaxY, LaneMask);
+  const __m256 FreeMask = _mm256_castsi256_ps(x8_lane_mask(Free));
+  PosX = _mm256_blendv_ps(PosX, EndX, FreeMask);
+  PosY = _mm256_blendv_ps(PosY, EndY, FreeMask);
+  LaneMask &= ~Free;
+
+  __m256i Grounded = _mm256_setzero_si256();
+  if (LaneMask) {
+    for (int i = 0; i < MOVE_BOX_LANES; ++i)
+      if (LaneMask & 1 << i)
+        NumSteps = imax(NumSteps, aMax[i]);
+    const __m256 Fraction = _mm256_loadu_ps(aFraction);
+    const __m256 ElasticityX = _mm256_loadu_ps(pLanes->m_aElasticityX);
+    const __m256 ElasticityY = _mm256_loadu_ps(pLanes->m_aElasticityY);
+    const __m256i Steps = _mm256_loadu_si256((const __m256i *)aMax);
+    const __m256i Active = x8_lane_mask(LaneMask);
+    const __m256 Round = _mm256_set1_ps(0.5f);
+    const __m256 Zero = _mm256_setzero_ps();
+    __m256i IPosX = _mm256_cvttps_epi32(_mm256_add_ps(PosX, Round));
+    __m256i IPosY = _mm256_cvttps_epi32(_mm256_add_ps(PosY, Round));
+    for (int i = 0; i <= NumSteps; ++i) {
+      // lanes that still have steps left
+      const __m256i Run = _mm256_and_si256(Active, _mm256_cmpgt_epi32(Steps, _mm256_set1_epi32(i - 1)));
+      __m256 NewPosX = _mm256_add_ps(PosX, _mm256_mul_ps(VelX, Fraction));
+      __m256 NewPosY = _mm256_add_ps(PosY, _mm256_mul_ps(VelY, Fraction));
+      const __m256i INewPosX = _mm256_cvttps_epi32(_mm256_add_ps(NewPosX, Round));
+      const __m256i INewPosY = _mm256_cvttps_epi32(_mm256_add_ps(NewPosY, Round));
+      const __m256i Hit = x8_test_box_character(pCollision, INewPosX, INewPosY, Run);
+      if (!_mm256_testz_si256(Hit, Hit)) {
+        const __m256 HitY = _mm256_castsi256_ps(x8_test_box_character(pCollision, IPosX, INewPosY, Hit));
+        const __m256 HitX = _mm256_castsi256_ps(x8_test_box_character(pCollision, INewPosX, IPosY, Hit));
+        Grounded = _mm256_or_si256(Grounded, _mm256_castps_si256(_mm256_and_ps(HitY, _mm256_cmp_ps(VelY, Zero, _CMP_GT_OQ))));
+        NewPosY = _mm256_blendv_ps(NewPosY, PosY, HitY);
+        VelY = _mm256_blendv_ps(VelY, Zero, HitY);
+        NewPosX = _mm256_blendv_ps(NewPosX, PosX, HitX);
+        VelX = _mm256_blendv_ps(VelX, Zero, HitX);
+        // neither axis alone hits, bounce back
+        const __m256 Bounce = _mm256_andnot_ps(_mm256_or_ps(HitX, HitY), _mm256_castsi256_ps(Hit));
+        const __m256 Sign = _mm256_set1_ps(-0.0f);
+        NewPosX = _mm256_blendv_ps(NewPosX, PosX, Bounce);
+        NewPosY = _mm256_blendv_ps(NewPosY, PosY, Bounce);
+        VelX = _mm256_blendv_ps(VelX, _mm256_mul_ps(_mm256_xor_ps(VelX, Sign), ElasticityX), Bounce);
+        VelY = _mm256_blendv_ps(VelY, _mm256_mul_ps(_mm256_xor_ps(VelY, Sign), ElasticityY), Bounce);
+      }
+      const __m256 RunMask = _mm256_castsi256_ps(Run);
+      IPosX = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(IPosX), _mm256_castsi256_ps(INewPosX), RunMask));
+      IPosY = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(IPosY), _mm256_castsi256_ps(INewPosY), RunMask));
+      PosX = _mm256_blendv_ps(PosX, NewPosX, RunMask);
+      PosY = _mm256_blendv_ps(PosY, NewPosY, RunMask);
+    }
+  }
+
+  _mm256_storeu_ps(pLanes->m_aPosX, PosX);
+  _mm256_storeu_ps(pLanes->m_aPosY, PosY);
+  _mm256_storeu_ps(pLanes->m_aVelX, VelX);
+  _mm256_storeu_ps(pLanes->m_aVelY, VelY);
+  const int GroundedMask = _mm256_movemask_ps(_mm256_castsi256_ps(Grounded));
+  for (int i = 0; i < MOVE_BOX_LANES; ++i)
+    if (GroundedMask & 1 << i)
+      pLanes->m_aGrounded[i] = true;
+}
+
+void intersect_line_tele_hook_x8(SCollision *__restrict__ pCollision, SHookRayLanes *__restrict__ pRays, int LaneMask) {
+  const __m256 FromX = _mm256_loadu_ps(pRays->m_aFromX);
+  const __m256 FromY = _mm256_loadu_ps(pRays->m_aFromY);
+  const __m256 ToX = _mm256_loadu_ps(pRays->m_aToX);
+  const __m256 ToY = _mm256_loadu_ps(pRays->m_aToY);
+  const __m256i MinX = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_min_ps(FromX, ToX)), 5);
+  const __m256i MinY = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_min_ps(FromY, ToY)), 5);
+  const __m256i MaxX = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_max_ps(FromX, ToX)), 5);
+  const __m256i MaxY = _mm256_srai_epi32(_mm256_cvttps_epi32(_mm256_max_ps(FromY, ToY)), 5);
+
+  // like broad_check, rays that leave the map count as free
+  const __m256i Zero = _mm256_setzero_si256();
+  const __m256i Outside = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpgt_epi32(Zero, MinX), _mm256_cmpgt_epi32(Zero, MinY)),
+      _mm256_or_si256(_mm256_cmpgt_epi32(MaxX, _mm256_set1_epi32(pCollision->m_MapData.width - 1)),
+                      _mm256_cmpgt_epi32(MaxY, _mm256_set1_epi32(pCollision->m_MapData.height - 1))));
+  const int Inside = LaneMask & ~_mm256_movemask_ps(_mm256_castsi256_ps(Outside));
+  int aMinX[HOOK_RAY_LANES], aMinY[HOOK_RAY_LANES], aMaxX[HOOK_RAY_LANES], aMaxY[HOOK_RAY_LANES];
+  _mm256_storeu_si256((__m256i *)aMinX, MinX);
+  _mm256_storeu_si256((__m256i *)aMinY, MinY);
+  _mm256_storeu_si256((__m256i *)aMaxX, MaxX);
+  _mm256_storeu_si256((__m256i *)aMaxY, MaxY);
+
+  const bool Tele = pCollision->m_MapData.tele_layer.type;
+  for (int i = 0; i < HOOK_RAY_LANES; ++i) {
+    if (!(LaneMask & 1 << i))
+      continue;
+    pRays->m_aTeleNr[i] = 0;
+    // gathering the bit fields was slower than these two loads per lane
+    if (!(Inside & 1 << i) || (!broad_rect_check(pCollision, BROAD_SOLID, aMinX[i], aMinY[i], aMaxX[i], aMaxY[i]) &&
+                               !(Tele && broad_rect_check(pCollision, BROAD_TELE_IN, aMinX[i], aMinY[i], aMaxX[i], aMaxY[i])))) {
+      pRays->m_aOutX[i] = pRays->m_aToX[i];
+      pRays->m_aOutY[i] = pRays->m_aToY[i];
+      pRays->m_aHit[i] = 0;
+      continue;
+    }
+    mvec2 Out;
+    pRays->m_aHit[i] = intersect_line_tele_hook(pCollision, vec2_init(pRays->m_aFromX[i], pRays->m_aFromY[i]),
+                                                vec2_init(pRays->m_aToX[i], pRays->m_aToY[i]), &Out, Tele ? &pRays->m_aTeleNr[i] : NULL);
+    pRays->m_aOutX[i] = vgetx(Out);
+    pRays->m_aOutY[i] = vgety(Out);
+  }
+}
+
 bool get_nearest_air_pos_player(SCollision *__restrict__ pCollision, mvec2 PlayerPos, mvec2 *__restrict__ pOutPos) {
   for (int dist = 5; dist >= -1; dist--) {
     *pOutPos = vec2_init(vgetx(PlayerPos), vgety(PlayerPos) - dist);
@@ -1585,7 +2758,7 @@ int get_index(SCollision *pCollision, mvec2 PrevPos, mvec2 Pos) {
   if (!Distance) {
     int Nx = (int)vgetx(Pos) >> 5;
     int Ny = (int)vgety(Pos) >> 5;
-    return pCollision->m_pWidthLookup[Ny] + Nx;
+    return map_index(pCollision, Nx, Ny);
   }
 
   for (int i = 0, id = ceil(Distance); i < id; i++) {
@@ -1593,7 +2766,7 @@ int get_index(SCollision *pCollision, mvec2 PrevPos, mvec2 Pos) {
     mvec2 Tmp = vvfmix(PrevPos, Pos, a);
     int Nx = (int)vgetx(Tmp) >> 5;
     int Ny = (int)vgety(Tmp) >> 5;
-    return pCollision->m_pWidthLookup[Ny] + Nx;
+    return map_index(pCollision, Nx, Ny);
   }
 
   return -1;
@@ -1603,7 +2776,7 @@ int entity(SCollision *pCollision, int x, int y, int Layer) {
   if ((unsigned char)x >= pCollision->m_MapData.width || (unsigned char)y >= pCollision->m_MapData.height)
     return 0;
 
-  const int Index = pCollision->m_pWidthLookup[y] + x;
+  const int Index = map_index(pCollision, x, y);
   switch (Layer) {
   case LAYER_GAME:
     return pCollision->m_MapData.game_layer.data[Index] - ENTITY_OFFSET;
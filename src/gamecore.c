@@ -5,6 +5,7 @@
 #include <ddnet_physics/vmath.h>
 #include <float.h>
 #include <limits.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,6 +15,22 @@
 #define NINJA_MOVETIME 200
 #define NINJA_VELOCITY 50
 
+// ticks a tee waits after dying before it can kill itself again
+#define RESPAWN_DELAY 25
+
+// per axis guard that keeps broken velocities (old speedups can produce nan) finite. DDNet has no such clamp, its sanity clamp limits the
+// length of the velocity to 6000 instead, so diagonal velocities here can reach about 8485 (listed in docs/unsupported.txt)
+#define MAX_VELOCITY 6000.f
+
+// below this many tees scanning all of them is cheaper than walking the tee accelerator
+#define TEE_QUERY_MIN_CHARACTERS 8
+
+// up to this many tees the hook rays are compared with all of them before any ray walks the tee grid
+#define HOOK_RAY_TEE_SCAN_MAX 64
+
+// how many ticks of a projectile flight are checked against the map ahead of time
+#define PRJ_IMPACT_WINDOW GAME_TICK_SPEED
+
 #define CLIP(p, q)                                                                                                                                   \
   do {                                                                                                                                               \
     if ((p) == 0.0f) {                                                                                                                               \
@@ -90,6 +107,301 @@ mvec2 calc_pos(mvec2 Pos, mvec2 Velocity, float Curvature, float Speed, float Ti
 
 // }}}
 
+// Entity pool {{{
+
+static void ep_destroy(SEntityPool *pPool) {
+  SEntityChunk *pChunk = pPool->m_pFirstChunk;
+  for (int i = 0; pChunk; ++i) {
+    SEntityChunk *pNext = pChunk->m_pNext;
+    if (i >= pPool->m_NumFixedChunks)
+      free(pChunk);
+    pChunk = pNext;
+  }
+  memset(pPool, 0, sizeof(SEntityPool));
+}
+
+// gives every slot back at once, the chunks stay allocated for reuse
+static void ep_reset(SEntityPool *pPool) {
+  pPool->m_pChunk = pPool->m_pFirstChunk;
+  pPool->m_ChunkIdx = 0;
+  pPool->m_NumBumped = 0;
+  pPool->m_pFree = NULL;
+}
+
+// whether entities were handed out from chunks outside of the flat block since the last reset
+static inline bool ep_spilled(const SEntityPool *pPool) { return pPool->m_pChunk && pPool->m_ChunkIdx >= pPool->m_NumFixedChunks; }
+
+// null if a new chunk can't be allocated
+static SEntity *ep_alloc(SEntityPool *pPool) {
+  if (pPool->m_pFree) {
+    SEntitySlot *pSlot = pPool->m_pFree;
+    pPool->m_pFree = pSlot->m_pNextFree;
+    return &pSlot->m_Base;
+  }
+  if (!pPool->m_pChunk || pPool->m_NumBumped == ENTITY_CHUNK_SIZE) {
+    SEntityChunk *pNext = pPool->m_pChunk ? pPool->m_pChunk->m_pNext : pPool->m_pFirstChunk;
+    if (!pNext) {
+      pNext = malloc(sizeof(SEntityChunk));
+      if (!pNext)
+        return NULL;
+      pNext->m_pNext = NULL;
+      if (pPool->m_pChunk)
+        pPool->m_pChunk->m_pNext = pNext;
+      else
+        pPool->m_pFirstChunk = pNext;
+    }
+    pPool->m_ChunkIdx = pPool->m_pChunk ? pPool->m_ChunkIdx + 1 : 0;
+    pPool->m_pChunk = pNext;
+    pPool->m_NumBumped = 0;
+  }
+  return &pPool->m_pChunk->m_aSlots[pPool->m_NumBumped++].m_Base;
+}
+
+// whether pEnt is a slot that ep_alloc handed out of this pool
+static bool ep_owns(const SEntityPool *pPool, const SEntity *pEnt) {
+  const uintptr_t Ptr = (uintptr_t)pEnt;
+  for (const SEntityChunk *pChunk = pPool->m_pFirstChunk; pChunk; pChunk = pChunk->m_pNext) {
+    const uintptr_t First = (uintptr_t)pChunk->m_aSlots;
+    if (Ptr >= First && Ptr < First + sizeof(pChunk->m_aSlots))
+      return (Ptr - First) % sizeof(SEntitySlot) == 0;
+    if (pChunk == pPool->m_pChunk)
+      break;
+  }
+  return false;
+}
+
+static void ep_free(SEntityPool *pPool, SEntity *pEnt) {
+  SEntitySlot *pSlot = (SEntitySlot *)pEnt;
+  pSlot->m_pNextFree = pPool->m_pFree;
+  pPool->m_pFree = pSlot;
+}
+
+// wc_insert_entity without the ownership check, for entities the library took from the pool itself
+static inline void wc_link_entity(SWorldCore *pWorld, SEntity *pEnt) {
+  pEnt->m_pWorld = pWorld;
+  pEnt->m_pCollision = pWorld->m_pCollision;
+  if (pWorld->m_apFirstEntityTypes[pEnt->m_ObjType])
+    pWorld->m_apFirstEntityTypes[pEnt->m_ObjType]->m_pPrevTypeEntity = pEnt;
+  pEnt->m_pNextTypeEntity = pWorld->m_apFirstEntityTypes[pEnt->m_ObjType];
+  pEnt->m_pPrevTypeEntity = NULL;
+  pWorld->m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+}
+
+// }}}
+
+// Tee accelerator {{{
+
+// linear probing hash from tile index to the first tee of that tile. it only holds occupied tiles so it stays tiny
+// no matter how big the map is. it is kept at most half full so every probe ends on an empty cell
+
+static inline uint32_t th_slot(const STeeHash *pHash, int Tile) { return ((uint32_t)Tile * 0x9E3779B1u >> 12) & pHash->m_CellMask; }
+
+static inline int th_head(const STeeHash *pHash, int Tile) {
+  if (!pHash->m_pCells)
+    return -1;
+  for (uint32_t i = th_slot(pHash, Tile);; i = (i + 1) & pHash->m_CellMask) {
+    if (pHash->m_pCells[i].m_Tile == Tile)
+      return pHash->m_pCells[i].m_Head;
+    if (pHash->m_pCells[i].m_Tile < 0)
+      return -1;
+  }
+}
+
+// grows the table to fit at least NumTiles occupied tiles, keeping the current entries
+static void th_reserve(STeeHash *pHash, int NumTiles) {
+  uint32_t NumCells = 16;
+  while (NumCells < (uint32_t)NumTiles * 2 + 2)
+    NumCells <<= 1;
+  if (pHash->m_pCells && NumCells <= pHash->m_CellMask + 1)
+    return;
+
+  STeeCell *pOld = pHash->m_pCells;
+  const uint32_t NumOld = pOld ? pHash->m_CellMask + 1 : 0;
+  pHash->m_pCells = malloc(NumCells * sizeof(STeeCell));
+  memset(pHash->m_pCells, -1, NumCells * sizeof(STeeCell));
+  pHash->m_CellMask = NumCells - 1;
+  for (uint32_t j = 0; j < NumOld; ++j) {
+    if (pOld[j].m_Tile < 0)
+      continue;
+    uint32_t i = th_slot(pHash, pOld[j].m_Tile);
+    while (pHash->m_pCells[i].m_Tile >= 0)
+      i = (i + 1) & pHash->m_CellMask;
+    pHash->m_pCells[i] = pOld[j];
+  }
+  free(pOld);
+}
+
+// empties the table and makes room for NumTiles occupied tiles
+static void th_clear(STeeHash *pHash, int NumTiles) {
+  th_reserve(pHash, NumTiles);
+  memset(pHash->m_pCells, -1, (pHash->m_CellMask + 1) * sizeof(STeeCell));
+  pHash->m_NumUsed = 0;
+}
+
+// Head < 0 removes the tile
+static void th_set_head(STeeHash *pHash, int Tile, int Head) {
+  if (Head >= 0)
+    th_reserve(pHash, pHash->m_NumUsed + 1);
+  else if (!pHash->m_pCells)
+    return;
+  uint32_t i = th_slot(pHash, Tile);
+  while (pHash->m_pCells[i].m_Tile >= 0 && pHash->m_pCells[i].m_Tile != Tile)
+    i = (i + 1) & pHash->m_CellMask;
+
+  if (Head >= 0) {
+    if (pHash->m_pCells[i].m_Tile < 0)
+      ++pHash->m_NumUsed;
+    pHash->m_pCells[i].m_Tile = Tile;
+    pHash->m_pCells[i].m_Head = Head;
+    return;
+  }
+  if (pHash->m_pCells[i].m_Tile < 0)
+    return;
+
+  // backward shift deletion. pull every following cell of the cluster whose home slot is not between the hole and itself into the hole
+  --pHash->m_NumUsed;
+  for (uint32_t j = (i + 1) & pHash->m_CellMask; pHash->m_pCells[j].m_Tile >= 0; j = (j + 1) & pHash->m_CellMask) {
+    uint32_t Home = th_slot(pHash, pHash->m_pCells[j].m_Tile);
+    if (((j - Home) & pHash->m_CellMask) >= ((j - i) & pHash->m_CellMask)) {
+      pHash->m_pCells[i] = pHash->m_pCells[j];
+      i = j;
+    }
+  }
+  pHash->m_pCells[i].m_Tile = -1;
+}
+
+static void th_copy(STeeHash *pTo, const STeeHash *pFrom) {
+  if (!pFrom->m_pCells) {
+    free(pTo->m_pCells);
+    memset(pTo, 0, sizeof(STeeHash));
+    return;
+  }
+  if (!pTo->m_pCells || pTo->m_CellMask != pFrom->m_CellMask) {
+    free(pTo->m_pCells);
+    pTo->m_pCells = malloc((pFrom->m_CellMask + 1) * sizeof(STeeCell));
+    pTo->m_CellMask = pFrom->m_CellMask;
+  }
+  memcpy(pTo->m_pCells, pFrom->m_pCells, (pFrom->m_CellMask + 1) * sizeof(STeeCell));
+  pTo->m_NumUsed = pFrom->m_NumUsed;
+}
+
+static void ta_free(STeeAccelerator *pAcc) {
+  free(pAcc->m_Heads.m_pCells);
+  free(pAcc->m_Query.m_pCells);
+  free(pAcc->m_pQueryNext);
+}
+
+// }}}
+
+// Tee queries {{{
+
+// The tee links above only change in the accelerator tick and their order decides the outcome of tee collisions, so they lag behind the
+// positions for most of the tick. Hit queries only care about which tees are close, so they get their own index that is built from the
+// current positions the first time it is needed and thrown away as soon as all tees move.
+
+static void ta_build_query(SWorldCore *pWorld) {
+  STeeAccelerator *pAcc = &pWorld->m_Accelerator;
+  const int Width = pWorld->m_pCollision->m_MapData.width;
+  const int Height = pWorld->m_pCollision->m_MapData.height;
+  if (pAcc->m_QueryCapacity < pWorld->m_NumCharacters) {
+    free(pAcc->m_pQueryNext);
+    pAcc->m_pQueryNext = malloc(pWorld->m_NumCharacters * sizeof(int32_t));
+    pAcc->m_QueryCapacity = pWorld->m_NumCharacters;
+  }
+  th_clear(&pAcc->m_Query, pWorld->m_NumCharacters);
+  // back to front so every tile lists its tees in index order
+  for (int i = pWorld->m_NumCharacters - 1; i >= 0; --i) {
+    const mvec2 Pos = pWorld->m_pCharacters[i].m_Pos;
+    // tees outside of the map can't be reached by queries, those have to stay inside of it
+    if (!(vgetx(Pos) >= 0.0f && vgety(Pos) >= 0.0f && vgetx(Pos) < Width * 32.0f && vgety(Pos) < Height * 32.0f))
+      continue;
+    const int Tile = ((int)vgety(Pos) >> 5) * Width + ((int)vgetx(Pos) >> 5);
+    pAcc->m_pQueryNext[i] = th_head(&pAcc->m_Query, Tile);
+    th_set_head(&pAcc->m_Query, Tile, i);
+  }
+  pAcc->m_QueryValid = true;
+  pAcc->m_NumMoved = 0;
+}
+
+// whether queries inside of the box can use the index, builds it if needed
+static inline bool ta_query_ready(SWorldCore *pWorld, float MinX, float MinY, float MaxX, float MaxY) {
+  if (pWorld->m_NumCharacters < TEE_QUERY_MIN_CHARACTERS ||
+      !(MinX >= 0.0f && MinY >= 0.0f && MaxX < pWorld->m_pCollision->m_MapData.width * 32.0f &&
+        MaxY < pWorld->m_pCollision->m_MapData.height * 32.0f))
+    return false;
+  if (!pWorld->m_Accelerator.m_QueryValid)
+    ta_build_query(pWorld);
+  return true;
+}
+
+static inline bool ta_moved(const STeeAccelerator *pAcc, int Id) {
+  for (int i = 0; i < pAcc->m_NumMoved; ++i)
+    if (pAcc->m_aMoved[i] == Id)
+      return true;
+  return false;
+}
+
+// remembers a tee that moved after the index was built so queries still find it. drops the index if too many move
+static void ta_mark_moved(STeeAccelerator *pAcc, int Id) {
+  if (!pAcc->m_QueryValid || ta_moved(pAcc, Id))
+    return;
+  if (pAcc->m_NumMoved == TEE_ACCELERATOR_MAX_MOVED) {
+    pAcc->m_QueryValid = false;
+    return;
+  }
+  pAcc->m_aMoved[pAcc->m_NumMoved++] = Id;
+}
+
+// visits every tee whose tile overlaps a box, then the tees that moved since the index was built. the callers still have to check the
+// actual distance
+typedef struct {
+  const STeeAccelerator *m_pAcc;
+  int m_Width;
+  int m_X, m_Y;
+  int m_StartX, m_EndX, m_EndY;
+  int m_Id;
+  int m_MovedIdx;
+} STeeQuery;
+
+static bool tq_init(STeeQuery *pQuery, SWorldCore *pWorld, float MinX, float MinY, float MaxX, float MaxY) {
+  if (!ta_query_ready(pWorld, MinX, MinY, MaxX, MaxY))
+    return false;
+  pQuery->m_pAcc = &pWorld->m_Accelerator;
+  pQuery->m_Width = pWorld->m_pCollision->m_MapData.width;
+  pQuery->m_StartX = pQuery->m_X = (int)MinX >> 5;
+  pQuery->m_Y = (int)MinY >> 5;
+  pQuery->m_EndX = (int)MaxX >> 5;
+  pQuery->m_EndY = (int)MaxY >> 5;
+  pQuery->m_Id = -1;
+  pQuery->m_MovedIdx = 0;
+  return true;
+}
+
+// returns -1 once all tees were visited
+static int tq_next(STeeQuery *pQuery) {
+  const STeeAccelerator *pAcc = pQuery->m_pAcc;
+  for (;;) {
+    while (pQuery->m_Id >= 0) {
+      int Id = pQuery->m_Id;
+      pQuery->m_Id = pAcc->m_pQueryNext[Id];
+      if (!ta_moved(pAcc, Id))
+        return Id;
+    }
+    if (pQuery->m_Y > pQuery->m_EndY)
+      break;
+    pQuery->m_Id = th_head(&pAcc->m_Query, pQuery->m_Y * pQuery->m_Width + pQuery->m_X);
+    if (++pQuery->m_X > pQuery->m_EndX) {
+      pQuery->m_X = pQuery->m_StartX;
+      ++pQuery->m_Y;
+    }
+  }
+  if (pQuery->m_MovedIdx < pAcc->m_NumMoved)
+    return pAcc->m_aMoved[pQuery->m_MovedIdx++];
+  return -1;
+}
+
+// }}}
+
 // Entities {{{
 
 void ent_init(SEntity *pEnt, SWorldCore *pGameWorld, int ObjType, mvec2 Pos) {
@@ -315,6 +627,8 @@ void lsr_tick(SLaser *pLaser) {
   pLaser->m_Base.m_Spawned = false;
 }
 
+static void prj_update_impact(SProjectile *pProj);
+
 void prj_init(SProjectile *pProj, SWorldCore *pGameWorld, int Type, int Owner, mvec2 Pos, mvec2 Dir, int Span, bool Freeze, bool Explosive, int Layer,
               int Number) {
   memset(pProj, 0, sizeof(SProjectile));
@@ -331,6 +645,7 @@ void prj_init(SProjectile *pProj, SWorldCore *pGameWorld, int Type, int Owner, m
   pProj->m_pTuning = &pGameWorld->m_pTunings[is_tune(pGameWorld->m_pCollision, get_map_index(pGameWorld->m_pCollision, Pos))];
   if (Owner > 0)
     pProj->m_IsSolo = pGameWorld->m_pCharacters[Owner].m_Solo;
+  prj_update_impact(pProj);
 }
 
 mvec2 prj_get_pos(SProjectile *pProj, float Time) {
@@ -357,6 +672,34 @@ mvec2 prj_get_pos(SProjectile *pProj, float Time) {
   return calc_pos(pProj->m_Base.m_Pos, pProj->m_Direction, Curvature, Speed, Time);
 }
 
+static bool prj_outside(SProjectile *pProj, mvec2 Pos) {
+  return vgetx(Pos) < 0 || vgety(Pos) < 0 || (int)(vgetx(Pos) + 0.5) >> 5 >= pProj->m_Base.m_pCollision->m_MapData.width ||
+         (int)(vgety(Pos) + 0.5) >> 5 >= pProj->m_Base.m_pCollision->m_MapData.height;
+}
+
+// The flight path only depends on the start tick, position, direction and tuning, so the segments of the upcoming ticks are tested against
+// the map once and prj_tick skips intersect_line until the first one that hits. The segments are built exactly like prj_tick builds
+// them so the result stays bit exact.
+static void prj_update_impact(SProjectile *pProj) {
+  int First = pProj->m_Base.m_pWorld->m_GameTick - pProj->m_StartTick + 1;
+  int Num = PRJ_IMPACT_WINDOW;
+  if (pProj->m_LifeSpan >= 0 && pProj->m_LifeSpan + 1 < Num)
+    Num = pProj->m_LifeSpan + 1;
+
+  mvec2 PrevPos = prj_get_pos(pProj, (First - 1) / (float)GAME_TICK_SPEED);
+  for (int k = First; k < First + Num; ++k) {
+    mvec2 CurPos = prj_get_pos(pProj, k / (float)GAME_TICK_SPEED);
+    mvec2 ColPos;
+    mvec2 NewPos;
+    if (prj_outside(pProj, CurPos) || intersect_line(pProj->m_Base.m_pCollision, PrevPos, CurPos, &ColPos, &NewPos)) {
+      pProj->m_ImpactTick = pProj->m_StartTick + k;
+      return;
+    }
+    PrevPos = CurPos;
+  }
+  pProj->m_ImpactTick = pProj->m_StartTick + First + Num;
+}
+
 bool cc_freeze(SCharacterCore *pCore, int Seconds);
 
 void wc_create_explosion(SWorldCore *pWorld, mvec2 Pos, int Owner);
@@ -367,14 +710,15 @@ void prj_tick(SProjectile *pProj) {
   float Ct = (pProj->m_Base.m_pWorld->m_GameTick - pProj->m_StartTick) / (float)GAME_TICK_SPEED;
   mvec2 PrevPos = prj_get_pos(pProj, Pt);
   mvec2 CurPos = prj_get_pos(pProj, Ct);
-  mvec2 ColPos;
-  mvec2 NewPos;
-  if (vgetx(CurPos) < 0 || vgety(CurPos) < 0 || (int)(vgetx(CurPos) + 0.5) >> 5 >= pProj->m_Base.m_pCollision->m_MapData.width ||
-      (int)(vgety(CurPos) + 0.5) >> 5 >= pProj->m_Base.m_pCollision->m_MapData.height) {
+  mvec2 ColPos = CurPos;
+  mvec2 NewPos = CurPos;
+  if (prj_outside(pProj, CurPos)) {
     pProj->m_Base.m_MarkedForDestroy = true;
     return;
   }
-  bool Collide = intersect_line(pProj->m_Base.m_pCollision, PrevPos, CurPos, &ColPos, &NewPos);
+  // segments before the impact tick are known to miss the map
+  bool Checked = pProj->m_Base.m_pWorld->m_GameTick <= pProj->m_StartTick || pProj->m_Base.m_pWorld->m_GameTick >= pProj->m_ImpactTick;
+  bool Collide = Checked && intersect_line(pProj->m_Base.m_pCollision, PrevPos, CurPos, &ColPos, &NewPos);
   SCharacterCore *pOwnerChar = NULL;
 
   if (pProj->m_Owner >= 0)
@@ -472,15 +816,20 @@ void prj_tick(SProjectile *pProj) {
     return;
   }
 
-  if (!pProj->m_Base.m_pCollision->m_MapData.tele_layer.type)
-    return;
-  int x = get_index(pProj->m_Base.m_pCollision, PrevPos, CurPos);
-  int z = is_teleport_weapon(pProj->m_Base.m_pCollision, x);
-  int Num = pProj->m_Base.m_pCollision->m_aNumTeleOuts[z];
-  if (z && Num > 0) {
-    pProj->m_Base.m_Pos = pProj->m_Base.m_pCollision->m_apTeleOuts[z][pProj->m_Base.m_pWorld->m_GameTick % Num];
-    pProj->m_StartTick = pProj->m_Base.m_pWorld->m_GameTick;
+  if (pProj->m_Base.m_pCollision->m_MapData.tele_layer.type) {
+    int x = get_index(pProj->m_Base.m_pCollision, PrevPos, CurPos);
+    int z = is_teleport_weapon(pProj->m_Base.m_pCollision, x);
+    int Num = pProj->m_Base.m_pCollision->m_aNumTeleOuts[z];
+    if (z && Num > 0) {
+      pProj->m_Base.m_Pos = pProj->m_Base.m_pCollision->m_apTeleOuts[z][pProj->m_Base.m_pWorld->m_GameTick % Num];
+      pProj->m_StartTick = pProj->m_Base.m_pWorld->m_GameTick;
+      Checked = true;
+    }
   }
+
+  // look ahead again once the known free ticks are used up or the path restarted from a bounce or teleport
+  if (Checked)
+    prj_update_impact(pProj);
 }
 
 void cc_calc_indices(SCharacterCore *pCore) {
@@ -488,7 +837,7 @@ void cc_calc_indices(SCharacterCore *pCore) {
   const int y = ((int)vgety(pCore->m_Pos) >> 5);
   pCore->m_BlockPos.x = x;
   pCore->m_BlockPos.y = y;
-  pCore->m_BlockIdx = y * pCore->m_pCollision->m_MapData.width + x;
+  pCore->m_BlockIdx = map_index(pCore->m_pCollision, x, y);
 }
 
 void cc_do_pickup(SCharacterCore *pCore) {
@@ -504,10 +853,10 @@ void cc_do_pickup(SCharacterCore *pCore) {
   for (int dy = -1; dy <= 1; ++dy) {
     const int Idx = pCore->m_pCollision->m_pWidthLookup[iclamp(iy + dy, 0, Height - 1)];
     for (int dx = -1; dx <= 1; ++dx) {
+      const int TileIdx = Idx + pCore->m_pCollision->m_pColumnIndexLookup[iclamp(ix + dx, 0, Width - 1)];
       for (int i = 0; i < 2; ++i) {
         // NOTE: doing a copy here should be faster since it is only 3 bytes
-        const SPickup Pickup = !i ? pCore->m_pCollision->m_pPickups[Idx + iclamp(ix + dx, 0, Width - 1)]
-                                  : pCore->m_pCollision->m_pFrontPickups[Idx + iclamp(ix + dx, 0, Width - 1)];
+        const SPickup Pickup = !i ? pCore->m_pCollision->m_pPickups[TileIdx] : pCore->m_pCollision->m_pFrontPickups[TileIdx];
         if (Pickup.m_Type < 0)
           continue;
         if (vdistance(pCore->m_Pos, vec2_init(((ix + dx) * 32) + 16, ((iy + dy) * 32) + 16)) >= 48)
@@ -670,8 +1019,9 @@ void cc_die(SCharacterCore *pCore) {
     cc_calc_indices(pCore);
   }
 
-  pCore->m_RespawnDelay = 25;
+  pCore->m_RespawnDelay = RESPAWN_DELAY;
   pCore->m_Id = Id;
+  ta_mark_moved(&pCore->m_pWorld->m_Accelerator, Id);
 }
 
 static inline float fast_expf(float x) {
@@ -683,38 +1033,17 @@ static inline float fast_expf(float x) {
   return v.f;
 }
 
-void cc_move(SCharacterCore *pCore) {
-  pCore->m_VelMag = vlength(pCore->m_Vel);
-  const float VelMag = pCore->m_VelMag * 50;
-  float OldVel = vgetx(pCore->m_Vel);
-
+static inline float cc_vel_ramp(const STuningParams *pTuning, float VelMag) {
   float RampValue = 1.f;
-  if (VelMag >= pCore->m_pTuning->m_VelrampStart) {
-    float t = VelMag - pCore->m_pTuning->m_VelrampStart;
-    RampValue = fast_expf(-t * pCore->m_pTuning->m_VelrampValue);
-  }
-  pCore->m_VelRamp = RampValue;
-
-  OldVel = OldVel * RampValue;
-  pCore->m_Vel = vsetx(pCore->m_Vel, OldVel);
-
-  mvec2 NewPos = pCore->m_Pos;
-  bool Grounded = false;
-  mvec2 MaxNewPos = vvadd(NewPos, pCore->m_Vel);
-
-  // OOB of the map
-  if (vgetx(MaxNewPos) < HALFPHYSICALSIZE + 2 || vgety(MaxNewPos) < HALFPHYSICALSIZE + 2 ||
-      vgetx(MaxNewPos) >= (float)pCore->m_pCollision->m_MapData.width * 32.f - (HALFPHYSICALSIZE + 2) ||
-      vgety(MaxNewPos) >= (float)pCore->m_pCollision->m_MapData.height * 32.f - (HALFPHYSICALSIZE + 2)) {
-    cc_die(pCore);
-    return;
+  if (VelMag >= pTuning->m_VelrampStart) {
+    float t = VelMag - pTuning->m_VelrampStart;
+    RampValue = fast_expf(-t * pTuning->m_VelrampValue);
   }
+  return RampValue;
+}
 
-  pCore->m_Vel = vvclamp(pCore->m_Vel, vec2_init(-4 * 32, -4 * 32), vec2_init(4 * 32, 4 * 32));
-
-  move_box(pCore->m_pCollision, NewPos, pCore->m_Vel, &NewPos, &pCore->m_Vel,
-           vec2_init(pCore->m_pTuning->m_GroundElasticityX, pCore->m_pTuning->m_GroundElasticityY), &Grounded);
-
+// everything of cc_move after move_box, m_Vel is the velocity move_box returned
+static void cc_move_finish(SCharacterCore *pCore, mvec2 NewPos, bool Grounded, float OldVel, float RampValue) {
   if (Grounded) {
     pCore->m_Jumped &= ~2;
     pCore->m_JumpedTotal = 0;
@@ -739,11 +1068,92 @@ void cc_move(SCharacterCore *pCore) {
   pCore->m_MoveRestrictions = get_move_restrictions(pCore->m_pCollision, pCore, pCore->m_Pos, pCore->m_BlockIdx);
 }
 
+// second half of cc_move. m_Vel is already ramped and clamped here
+static void cc_move_collide(SCharacterCore *pCore, float OldVel, float RampValue) {
+  mvec2 NewPos = pCore->m_Pos;
+  bool Grounded = false;
+  move_box(pCore->m_pCollision, NewPos, pCore->m_Vel, &NewPos, &pCore->m_Vel,
+           vec2_init(pCore->m_pTuning->m_GroundElasticityX, pCore->m_pTuning->m_GroundElasticityY), &Grounded);
+  cc_move_finish(pCore, NewPos, Grounded, OldVel, RampValue);
+}
+
+// applies the velocity ramp, returns where the unclamped velocity would take the character
+static inline mvec2 cc_move_ramp(SCharacterCore *pCore, float *pOldVel, float *pRampValue) {
+  pCore->m_VelMag = vlength(pCore->m_Vel);
+  const float RampValue = cc_vel_ramp(pCore->m_pTuning, pCore->m_VelMag * 50);
+  pCore->m_VelRamp = RampValue;
+
+  const float OldVel = vgetx(pCore->m_Vel) * RampValue;
+  pCore->m_Vel = vsetx(pCore->m_Vel, OldVel);
+  *pOldVel = OldVel;
+  *pRampValue = RampValue;
+  return vvadd(pCore->m_Pos, pCore->m_Vel);
+}
+
+static inline bool cc_outside_map(const SCharacterCore *pCore, mvec2 Pos) {
+  return vgetx(Pos) < HALFPHYSICALSIZE + 2 || vgety(Pos) < HALFPHYSICALSIZE + 2 ||
+         vgetx(Pos) >= (float)pCore->m_pCollision->m_MapData.width * 32.f - (HALFPHYSICALSIZE + 2) ||
+         vgety(Pos) >= (float)pCore->m_pCollision->m_MapData.height * 32.f - (HALFPHYSICALSIZE + 2);
+}
+
+// first half of cc_move, returns false if the character left the map and died
+static bool cc_move_prepare(SCharacterCore *pCore, float *pOldVel, float *pRampValue) {
+  const mvec2 MaxNewPos = cc_move_ramp(pCore, pOldVel, pRampValue);
+
+  // OOB of the map
+  if (cc_outside_map(pCore, MaxNewPos)) {
+    cc_die(pCore);
+    return false;
+  }
+
+  pCore->m_Vel = vvclamp(pCore->m_Vel, vec2_init(-MAX_VELOCITY, -MAX_VELOCITY), vec2_init(MAX_VELOCITY, MAX_VELOCITY));
+  return true;
+}
+
+void cc_move(SCharacterCore *pCore) {
+  float OldVel, RampValue;
+  if (cc_move_prepare(pCore, &OldVel, &RampValue))
+    cc_move_collide(pCore, OldVel, RampValue);
+}
+
 void cc_world_tick_deferred(SCharacterCore *pCore) {
   cc_move(pCore);
   cc_quantize(pCore);
 }
 
+// cc_world_tick_deferred for every character. A character only moves itself here, so the move_box calls of MOVE_BOX_LANES characters
+// run together in move_box_x8.
+static void wc_move_characters(SWorldCore *pCore) {
+  for (int Start = 0; Start < pCore->m_NumCharacters; Start += MOVE_BOX_LANES) {
+    const int Num = imin(MOVE_BOX_LANES, pCore->m_NumCharacters - Start);
+    SMoveBoxLanes Lanes;
+    float aOldVel[MOVE_BOX_LANES], aRampValue[MOVE_BOX_LANES];
+    int LaneMask = 0;
+    for (int i = 0; i < Num; ++i) {
+      SCharacterCore *pChar = &pCore->m_pCharacters[Start + i];
+      if (!cc_move_prepare(pChar, &aOldVel[i], &aRampValue[i]))
+        continue;
+      LaneMask |= 1 << i;
+      Lanes.m_aPosX[i] = vgetx(pChar->m_Pos);
+      Lanes.m_aPosY[i] = vgety(pChar->m_Pos);
+      Lanes.m_aVelX[i] = vgetx(pChar->m_Vel);
+      Lanes.m_aVelY[i] = vgety(pChar->m_Vel);
+      Lanes.m_aElasticityX[i] = pChar->m_pTuning->m_GroundElasticityX;
+      Lanes.m_aElasticityY[i] = pChar->m_pTuning->m_GroundElasticityY;
+      Lanes.m_aGrounded[i] = false;
+    }
+    move_box_x8(pCore->m_pCollision, &Lanes, LaneMask);
+    for (int i = 0; i < Num; ++i) {
+      SCharacterCore *pChar = &pCore->m_pCharacters[Start + i];
+      if (LaneMask & 1 << i) {
+        pChar->m_Vel = vec2_init(Lanes.m_aVelX[i], Lanes.m_aVelY[i]);
+        cc_move_finish(pChar, vec2_init(Lanes.m_aPosX[i], Lanes.m_aPosY[i]), Lanes.m_aGrounded[i], aOldVel[i], aRampValue[i]);
+      }
+      cc_quantize(pChar);
+    }
+  }
+}
+
 static inline float fast_rand(unsigned int *state) {
   unsigned int x = *state;
   x ^= x << 13;
@@ -790,6 +1200,29 @@ void cc_tee_interact_deferred(SCharacterCore *pCore, int Id, int *pCollisions) {
   }
 }
 
+// The bookkeeping of cc_tick that doesn't look at other tees or tiles, wc_tick_ballistic runs the same steps without the rest of the tick.
+static inline void cc_tick_respawn_delay(SCharacterCore *pCore) {
+  if (pCore->m_RespawnDelay)
+    --pCore->m_RespawnDelay;
+}
+
+static inline void cc_tick_new_hook(SCharacterCore *pCore) {
+  if (pCore->m_HookState != HOOK_FLYING)
+    pCore->m_NewHook = false;
+}
+
+static inline void cc_tick_postcore_reset(SCharacterCore *pCore) {
+  if (pCore->m_EndlessHook)
+    pCore->m_HookTick = 0;
+  pCore->m_FrozenLastTick = false;
+}
+
+static inline void cc_tick_end(SCharacterCore *pCore) {
+  pCore->m_PrevPos = pCore->m_Pos;
+  if (pCore->m_HitNum > 0)
+    --pCore->m_HitNum;
+}
+
 void cc_tick_deferred(SCharacterCore *pCore) {
   if (pCore->m_pWorld->m_NumCharacters > 1) {
     int Num = 0;
@@ -798,7 +1231,7 @@ void cc_tick_deferred(SCharacterCore *pCore) {
         // TODO: use the block idx +- 1 +- map_width
         int Idx = (((int)vgety(pCore->m_Pos) >> 5) + dx) * pCore->m_pCollision->m_MapData.width + (((int)vgetx(pCore->m_Pos) >> 5) + dy);
         Idx = iclamp(Idx, 0, pCore->m_pCollision->m_MapData.width * pCore->m_pCollision->m_MapData.height - 1);
-        int Id = pCore->m_pWorld->m_Accelerator.m_pGrid->m_pTeeGrid[Idx];
+        int Id = th_head(&pCore->m_pWorld->m_Accelerator.m_Heads, Idx);
         while (Id >= 0) {
           if (pCore->m_Id == Id) {
             Id = pCore->m_pWorld->m_Accelerator.m_pTeeList[Id].m_Child;
@@ -837,9 +1270,7 @@ EndCollisions:
       }
     }
   }
-  if (pCore->m_HookState != HOOK_FLYING) {
-    pCore->m_NewHook = false;
-  }
+  cc_tick_new_hook(pCore);
 }
 
 void cc_ddracetick(SCharacterCore *pCore) {
@@ -864,7 +1295,8 @@ void cc_handle_skippable_tiles(SCharacterCore *pCore, int Index) {
   static const mvec2 DeathOffset2 = {DEATH, DEATH, 0.f, 0.f};
   static const mvec2 DeathOffset3 = {-DEATH, -DEATH, 0.f, 0.f};
   static const mvec2 DeathOffset4 = {-DEATH, DEATH, 0.f, 0.f};
-  if (pCore->m_pCollision->m_pTileInfos[Index] & INFO_CANHITKILL &&
+  const uint32_t Actions = pCore->m_pCollision->m_pTileActions[Index];
+  if (Actions & 1u << ACTION_HITKILL &&
       (get_collision_at(pCore->m_pCollision, vvadd(pCore->m_Pos, DeathOffset1)) == TILE_DEATH ||
        get_collision_at(pCore->m_pCollision, vvadd(pCore->m_Pos, DeathOffset2)) == TILE_DEATH ||
        get_collision_at(pCore->m_pCollision, vvadd(pCore->m_Pos, DeathOffset3)) == TILE_DEATH ||
@@ -881,10 +1313,13 @@ void cc_handle_skippable_tiles(SCharacterCore *pCore, int Index) {
   if (Index < 0)
     return;
 
-  if (is_speedup(pCore->m_pCollision, Index)) {
-    mvec2 Direction, TempVel = pCore->m_Vel;
-    int Force, Type, MaxSpeed = 0;
-    get_speedup(pCore->m_pCollision, Index, &Direction, &Force, &MaxSpeed, &Type);
+  if (Actions & 1u << ACTION_SPEEDUP) {
+    const SSpeedup *pSpeedup = &pCore->m_pCollision->m_pSpeedups[Index];
+    const mvec2 Direction = vec2_init(pSpeedup->m_aDirection[0], pSpeedup->m_aDirection[1]);
+    const int Force = pSpeedup->m_Force;
+    const int Type = pSpeedup->m_Type;
+    int MaxSpeed = pSpeedup->m_MaxSpeed;
+    mvec2 TempVel = pCore->m_Vel;
 
     if (Type == TILE_SPEED_BOOST_OLD) {
       float TeeAngle, SpeederAngle, DiffAngle, SpeedLeft, TeeSpeed;
@@ -985,141 +1420,12 @@ void cc_reset_pickups(SCharacterCore *pCore) {
 
 void wc_release_hooked(SWorldCore *pCore, int Id);
 
-void cc_handle_tiles(SCharacterCore *pCore, int Index) {
-  int MapIndex = Index;
-
-  if (Index < 0) {
-    pCore->m_LastRefillJumps = false;
-    pCore->m_LastPenalty = false;
-    pCore->m_LastBonus = false;
-    return;
-  }
-  int TileIndex = get_tile_index(pCore->m_pCollision, MapIndex);
-  int TileFIndex = pCore->m_pCollision->m_MapData.front_layer.data ? get_front_tile_index(pCore->m_pCollision, MapIndex) : 0;
-  if (pCore->m_pCollision->m_MapData.tele_layer.type) {
-    int TeleCheckpoint = is_tele_checkpoint(pCore->m_pCollision, MapIndex);
-    if (TeleCheckpoint)
-      pCore->m_TeleCheckpoint = TeleCheckpoint;
-  }
-
-  // Handle start and finish
-  if ((TileIndex == TILE_START || TileFIndex == TILE_START))
-    if (pCore->m_StartTick == -1 || !pCore->m_pWorld->m_pConfig->m_SvSoloServer) {
-      pCore->m_StartTick = pCore->m_pWorld->m_GameTick;
-      pCore->m_FinishTick = -1;
-    }
-  if ((TileIndex == TILE_FINISH || TileFIndex == TILE_FINISH) && pCore->m_StartTick != -1 && pCore->m_FinishTick == -1) {
-    pCore->m_FinishTick = pCore->m_pWorld->m_GameTick;
-  }
-
-  if ((TileIndex == TILE_FREEZE || TileFIndex == TILE_FREEZE) && !pCore->m_DeepFrozen) {
-    cc_freeze(pCore, pCore->m_pWorld->m_pConfig->m_SvFreezeDelay);
-  } else if ((TileIndex == TILE_UNFREEZE || TileFIndex == TILE_UNFREEZE) && !pCore->m_DeepFrozen)
-    cc_unfreeze(pCore);
-
-  if (TileIndex == TILE_DFREEZE || TileFIndex == TILE_DFREEZE)
-    pCore->m_DeepFrozen = true;
-  else if (TileIndex == TILE_DUNFREEZE || TileFIndex == TILE_DUNFREEZE)
-    pCore->m_DeepFrozen = false;
-
-  if (TileIndex == TILE_LFREEZE || TileFIndex == TILE_LFREEZE) {
-    pCore->m_LiveFrozen = true;
-  } else if (TileIndex == TILE_LUNFREEZE || TileFIndex == TILE_LUNFREEZE) {
-    pCore->m_LiveFrozen = false;
-  }
-
-  if (TileIndex == TILE_EHOOK_ENABLE || TileFIndex == TILE_EHOOK_ENABLE) {
-    pCore->m_EndlessHook = true;
-  } else if (TileIndex == TILE_EHOOK_DISABLE || TileFIndex == TILE_EHOOK_DISABLE) {
-    pCore->m_EndlessHook = false;
-  }
-
-  if (TileIndex == TILE_HIT_DISABLE || TileFIndex == TILE_HIT_DISABLE) {
-    pCore->m_HammerHitDisabled = true;
-    pCore->m_ShotgunHitDisabled = true;
-    pCore->m_GrenadeHitDisabled = true;
-    pCore->m_LaserHitDisabled = true;
-  } else if (TileIndex == TILE_HIT_ENABLE || TileFIndex == TILE_HIT_ENABLE) {
-    pCore->m_ShotgunHitDisabled = false;
-    pCore->m_GrenadeHitDisabled = false;
-    pCore->m_HammerHitDisabled = false;
-    pCore->m_LaserHitDisabled = false;
-  }
-
-  if (TileIndex == TILE_NPC_DISABLE || TileFIndex == TILE_NPC_DISABLE) {
-    pCore->m_CollisionDisabled = true;
-  } else if (TileIndex == TILE_NPC_ENABLE || TileFIndex == TILE_NPC_ENABLE) {
-    pCore->m_CollisionDisabled = false;
-  }
-
-  if ((TileIndex == TILE_NPH_DISABLE) || (TileFIndex == TILE_NPH_DISABLE)) {
-    pCore->m_HookHitDisabled = true;
-  } else if (TileIndex == TILE_NPH_ENABLE || TileFIndex == TILE_NPH_ENABLE) {
-    pCore->m_HookHitDisabled = false;
-  }
-
-  if (TileIndex == TILE_UNLIMITED_JUMPS_ENABLE || TileFIndex == TILE_UNLIMITED_JUMPS_ENABLE) {
-    pCore->m_EndlessJump = true;
-  } else if (TileIndex == TILE_UNLIMITED_JUMPS_DISABLE || TileFIndex == TILE_UNLIMITED_JUMPS_DISABLE) {
-    pCore->m_EndlessJump = false;
-  }
-
-  if (TileIndex == TILE_WALLJUMP || TileFIndex == TILE_WALLJUMP) {
-    if (vgety(pCore->m_Vel) > 0 && pCore->m_Colliding && pCore->m_LeftWall) {
-      pCore->m_LeftWall = false;
-      pCore->m_JumpedTotal = pCore->m_Jumps >= 2 ? pCore->m_Jumps - 2 : 0;
-      pCore->m_Jumped = 1;
-    }
-  }
-
-  if (TileIndex == TILE_JETPACK_ENABLE || TileFIndex == TILE_JETPACK_ENABLE) {
-    pCore->m_Jetpack = true;
-  } else if (TileIndex == TILE_JETPACK_DISABLE || TileFIndex == TILE_JETPACK_DISABLE) {
-    pCore->m_Jetpack = false;
-  }
-
-  if ((TileIndex == TILE_REFILL_JUMPS || TileFIndex == TILE_REFILL_JUMPS) && !pCore->m_LastRefillJumps) {
-    pCore->m_JumpedTotal = 0;
-    pCore->m_Jumped = 0;
-    pCore->m_LastRefillJumps = true;
-  }
-  if (TileIndex != TILE_REFILL_JUMPS && TileFIndex != TILE_REFILL_JUMPS) {
-    pCore->m_LastRefillJumps = false;
-  }
-
-  if (TileIndex == TILE_TELE_GUN_ENABLE || TileFIndex == TILE_TELE_GUN_ENABLE) {
-    pCore->m_HasTelegunGun = true;
-  } else if (TileIndex == TILE_TELE_GUN_DISABLE || TileFIndex == TILE_TELE_GUN_DISABLE) {
-    pCore->m_HasTelegunGun = false;
-  }
-
-  if (TileIndex == TILE_TELE_GRENADE_ENABLE || TileFIndex == TILE_TELE_GRENADE_ENABLE) {
-    pCore->m_HasTelegunGrenade = true;
-  } else if (TileIndex == TILE_TELE_GRENADE_DISABLE || TileFIndex == TILE_TELE_GRENADE_DISABLE) {
-    pCore->m_HasTelegunGrenade = false;
-  }
-
-  if (((TileIndex == TILE_TELE_LASER_ENABLE) || (TileFIndex == TILE_TELE_LASER_ENABLE)) && !pCore->m_HasTelegunLaser) {
-    pCore->m_HasTelegunLaser = true;
-  } else if (TileIndex == TILE_TELE_LASER_DISABLE || TileFIndex == TILE_TELE_LASER_DISABLE) {
-    pCore->m_HasTelegunLaser = false;
-  }
-
-  if (vgety(pCore->m_Vel) > 0 && (pCore->m_MoveRestrictions & CANTMOVE_DOWN)) {
-    pCore->m_Jumped = 0;
-    pCore->m_JumpedTotal = 0;
-  }
-  pCore->m_Vel = clamp_vel(pCore->m_MoveRestrictions, pCore->m_Vel);
-
+// The switch layer tile at MapIndex, only called where its type isn't 0.
+static void cc_handle_switch_tile(SCharacterCore *pCore, int MapIndex) {
   SSwitch *pSwitches = pCore->m_pWorld->m_pSwitches;
-  unsigned char Number = 0;
-  unsigned char Type = 0;
-  unsigned char Delay = 0;
-  if (pCore->m_pCollision->m_MapData.switch_layer.type) {
-    Number = get_switch_number(pCore->m_pCollision, MapIndex);
-    Type = get_switch_type(pCore->m_pCollision, MapIndex);
-    Delay = get_switch_delay(pCore->m_pCollision, MapIndex);
-  }
+  const unsigned char Number = get_switch_number(pCore->m_pCollision, MapIndex);
+  const unsigned char Type = get_switch_type(pCore->m_pCollision, MapIndex);
+  const unsigned char Delay = get_switch_delay(pCore->m_pCollision, MapIndex);
   int Tick = pCore->m_pWorld->m_GameTick;
 
   SSwitch *pSwitch = pSwitches;
@@ -1206,15 +1512,161 @@ void cc_handle_tiles(SCharacterCore *pCore, int Index) {
   if (Type != TILE_SUBTRACT_TIME) {
     pCore->m_LastBonus = false;
   }
+}
+
+void cc_handle_tiles(SCharacterCore *pCore, int Index) {
+  int MapIndex = Index;
 
-  if (!pCore->m_pCollision->m_MapData.tele_layer.type)
+  if (Index < 0) {
+    pCore->m_LastRefillJumps = false;
+    pCore->m_LastPenalty = false;
+    pCore->m_LastBonus = false;
     return;
+  }
+  const uint32_t Actions = pCore->m_pCollision->m_pTileActions[MapIndex];
+  if (Actions & 1u << ACTION_TELE) {
+    int TeleCheckpoint = is_tele_checkpoint(pCore->m_pCollision, MapIndex);
+    if (TeleCheckpoint)
+      pCore->m_TeleCheckpoint = TeleCheckpoint;
+  }
 
-  SConfig *pConfig = pCore->m_pWorld->m_pConfig;
-  int z = is_teleport(pCore->m_pCollision, MapIndex);
-  int Num = pCore->m_pCollision->m_aNumTeleOuts[z];
-  if (z && Num > 0) {
-    pCore->m_Pos = pCore->m_pCollision->m_apTeleOuts[z][pCore->m_Input.m_TeleOut % Num];
+  // only the tiles that are there, lowest bit first
+  for (uint32_t Todo = Actions & ~((1u << ACTION_START) - 1); Todo; Todo &= Todo - 1) {
+    switch (__builtin_ctz(Todo)) {
+    case ACTION_START:
+      if (pCore->m_StartTick == -1 || !pCore->m_pWorld->m_pConfig->m_SvSoloServer) {
+        pCore->m_StartTick = pCore->m_pWorld->m_GameTick;
+        pCore->m_FinishTick = -1;
+      }
+      break;
+    case ACTION_FINISH:
+      if (pCore->m_StartTick != -1 && pCore->m_FinishTick == -1)
+        pCore->m_FinishTick = pCore->m_pWorld->m_GameTick;
+      break;
+    case ACTION_FREEZE:
+      if (!pCore->m_DeepFrozen)
+        cc_freeze(pCore, pCore->m_pWorld->m_pConfig->m_SvFreezeDelay);
+      break;
+    case ACTION_UNFREEZE:
+      if (!pCore->m_DeepFrozen)
+        cc_unfreeze(pCore);
+      break;
+    case ACTION_DFREEZE:
+      pCore->m_DeepFrozen = true;
+      break;
+    case ACTION_DUNFREEZE:
+      pCore->m_DeepFrozen = false;
+      break;
+    case ACTION_LFREEZE:
+      pCore->m_LiveFrozen = true;
+      break;
+    case ACTION_LUNFREEZE:
+      pCore->m_LiveFrozen = false;
+      break;
+    case ACTION_EHOOK_ENABLE:
+      pCore->m_EndlessHook = true;
+      break;
+    case ACTION_EHOOK_DISABLE:
+      pCore->m_EndlessHook = false;
+      break;
+    case ACTION_HIT_DISABLE:
+      pCore->m_HammerHitDisabled = true;
+      pCore->m_ShotgunHitDisabled = true;
+      pCore->m_GrenadeHitDisabled = true;
+      pCore->m_LaserHitDisabled = true;
+      break;
+    case ACTION_HIT_ENABLE:
+      pCore->m_ShotgunHitDisabled = false;
+      pCore->m_GrenadeHitDisabled = false;
+      pCore->m_HammerHitDisabled = false;
+      pCore->m_LaserHitDisabled = false;
+      break;
+    case ACTION_NPC_DISABLE:
+      pCore->m_CollisionDisabled = true;
+      break;
+    case ACTION_NPC_ENABLE:
+      pCore->m_CollisionDisabled = false;
+      break;
+    case ACTION_NPH_DISABLE:
+      pCore->m_HookHitDisabled = true;
+      break;
+    case ACTION_NPH_ENABLE:
+      pCore->m_HookHitDisabled = false;
+      break;
+    case ACTION_UNLIMITED_JUMPS_ENABLE:
+      pCore->m_EndlessJump = true;
+      break;
+    case ACTION_UNLIMITED_JUMPS_DISABLE:
+      pCore->m_EndlessJump = false;
+      break;
+    case ACTION_WALLJUMP:
+      if (vgety(pCore->m_Vel) > 0 && pCore->m_Colliding && pCore->m_LeftWall) {
+        pCore->m_LeftWall = false;
+        pCore->m_JumpedTotal = pCore->m_Jumps >= 2 ? pCore->m_Jumps - 2 : 0;
+        pCore->m_Jumped = 1;
+      }
+      break;
+    case ACTION_JETPACK_ENABLE:
+      pCore->m_Jetpack = true;
+      break;
+    case ACTION_JETPACK_DISABLE:
+      pCore->m_Jetpack = false;
+      break;
+    case ACTION_REFILL_JUMPS:
+      if (!pCore->m_LastRefillJumps) {
+        pCore->m_JumpedTotal = 0;
+        pCore->m_Jumped = 0;
+        pCore->m_LastRefillJumps = true;
+      }
+      break;
+    case ACTION_TELE_GUN_ENABLE:
+      pCore->m_HasTelegunGun = true;
+      break;
+    case ACTION_TELE_GUN_DISABLE:
+      pCore->m_HasTelegunGun = false;
+      break;
+    case ACTION_TELE_GRENADE_ENABLE:
+      pCore->m_HasTelegunGrenade = true;
+      break;
+    case ACTION_TELE_GRENADE_DISABLE:
+      pCore->m_HasTelegunGrenade = false;
+      break;
+    case ACTION_TELE_LASER_ENABLE:
+      // the disable tile only counts if this one didn't
+      if (!pCore->m_HasTelegunLaser) {
+        pCore->m_HasTelegunLaser = true;
+        Todo &= ~(1u << ACTION_TELE_LASER_DISABLE);
+      }
+      break;
+    case ACTION_TELE_LASER_DISABLE:
+      pCore->m_HasTelegunLaser = false;
+      break;
+    }
+  }
+  if (!(Actions & 1u << ACTION_REFILL_JUMPS))
+    pCore->m_LastRefillJumps = false;
+
+  if (vgety(pCore->m_Vel) > 0 && (pCore->m_MoveRestrictions & CANTMOVE_DOWN)) {
+    pCore->m_Jumped = 0;
+    pCore->m_JumpedTotal = 0;
+  }
+  pCore->m_Vel = clamp_vel(pCore->m_MoveRestrictions, pCore->m_Vel);
+
+  if (Actions & 1u << ACTION_SWITCH) {
+    cc_handle_switch_tile(pCore, MapIndex);
+  } else {
+    pCore->m_LastPenalty = false;
+    pCore->m_LastBonus = false;
+  }
+
+  if (!(Actions & 1u << ACTION_TELE))
+    return;
+
+  SConfig *pConfig = pCore->m_pWorld->m_pConfig;
+  int z = is_teleport(pCore->m_pCollision, MapIndex);
+  int Num = pCore->m_pCollision->m_aNumTeleOuts[z];
+  if (z && Num > 0) {
+    pCore->m_Pos = pCore->m_pCollision->m_apTeleOuts[z][pCore->m_Input.m_TeleOut % Num];
     cc_calc_indices(pCore);
     if (!pConfig->m_SvTeleportHoldHook) {
       cc_reset_hook(pCore);
@@ -1300,21 +1752,11 @@ static inline bool broad_indices_check(const SCollision *__restrict__ pCollision
   const int MinY = (int)vgety(MinVec) >> 5;
   const int MaxX = ((int)vgetx(MaxVec) + 1) >> 5;
   const int MaxY = ((int)vgety(MaxVec) + 1) >> 5;
-  const int DiffY = (MaxY - MinY);
-  const int DiffX = (MaxX - MinX);
-
-  return (bool)(pCollision->m_pBroadIndicesBitField[(MinY * pCollision->m_MapData.width) + MinX] & (uint64_t)1 << ((DiffY << 3) + DiffX));
+  // fast tees and teleports take the pyramid inside
+  return broad_rect_check(pCollision, BROAD_INDICES, MinX, MinY, MaxX, MaxY);
 }
 
-void cc_ddrace_postcore_tick(SCharacterCore *pCore) {
-  if (pCore->m_EndlessHook)
-    pCore->m_HookTick = 0;
-
-  pCore->m_FrozenLastTick = false;
-
-  if (pCore->m_DeepFrozen)
-    cc_freeze(pCore, pCore->m_pWorld->m_pConfig->m_SvFreezeDelay);
-
+static void cc_jump_rules(SCharacterCore *pCore) {
   // following jump rules can be overridden by tiles, like Refill Jumps,
   // Stopper and Wall Jump
   if (pCore->m_Jumps == -1) {
@@ -1335,13 +1777,22 @@ void cc_ddrace_postcore_tick(SCharacterCore *pCore) {
     // Super players and players with infinite jumps always have light feet
     pCore->m_Jumped = 1;
   }
+}
+
+void cc_ddrace_postcore_tick(SCharacterCore *pCore) {
+  cc_tick_postcore_reset(pCore);
+
+  if (pCore->m_DeepFrozen)
+    cc_freeze(pCore, pCore->m_pWorld->m_pConfig->m_SvFreezeDelay);
+
+  cc_jump_rules(pCore);
 
   cc_handle_skippable_tiles(pCore, pCore->m_BlockIdx);
 
   const mvec2 PrevPos = pCore->m_PrevPos;
   const mvec2 Pos = pCore->m_Pos;
-  const int Width = pCore->m_pCollision->m_MapData.width;
-  if (broad_indices_check(pCore->m_pCollision, PrevPos, Pos)) {
+  SCollision *pCollision = pCore->m_pCollision;
+  if (broad_indices_check(pCollision, PrevPos, Pos)) {
     int sx = (int)vgetx(PrevPos) >> 5;
     int sy = (int)vgety(PrevPos) >> 5;
     int ex = (int)vgetx(Pos) >> 5;
@@ -1362,21 +1813,21 @@ void cc_ddrace_postcore_tick(SCharacterCore *pCore) {
       if (yFirst) {
         int stepY = (ey > sy) ? 1 : -1;
         for (int y = sy; y != ey; y += stepY)
-          cc_handle_tiles(pCore, y * Width + sx);
+          cc_handle_tiles(pCore, map_index(pCollision, sx, y));
         int stepX = (ex > sx) ? 1 : -1;
         for (int x = sx; x != ex; x += stepX)
-          cc_handle_tiles(pCore, ey * Width + x);
+          cc_handle_tiles(pCore, map_index(pCollision, x, ey));
 
       } else {
         int stepX = (ex > sx) ? 1 : -1;
         for (int x = sx; x != ex; x += stepX)
-          cc_handle_tiles(pCore, sy * Width + x);
+          cc_handle_tiles(pCore, map_index(pCollision, x, sy));
         int stepY = (ey > sy) ? 1 : -1;
         for (int y = sy; y != ey; y += stepY)
-          cc_handle_tiles(pCore, y * Width + ex);
+          cc_handle_tiles(pCore, map_index(pCollision, ex, y));
       }
     }
-    cc_handle_tiles(pCore, ey * Width + ex);
+    cc_handle_tiles(pCore, map_index(pCollision, ex, ey));
   }
   // teleport gun
   if (pCore->m_TeleGunTeleport) {
@@ -1397,7 +1848,10 @@ static inline int compare_sign_bits(float f, int32_t i) {
   return !((bits.u ^ (uint32_t)i) >> 31);
 }
 
-void cc_pre_tick(SCharacterCore *pCore) {
+enum { JUMP_NONE = 0, JUMP_GROUND, JUMP_AIR };
+
+// everything in the pre tick that only depends on input and tiles. returns the jump that the control step has to apply
+static int cc_pre_tick_input(SCharacterCore *pCore) {
   cc_ddracetick(pCore);
 
   // getting move restrictions is always done after moving the character so don't do it here
@@ -1407,12 +1861,12 @@ void cc_pre_tick(SCharacterCore *pCore) {
       (check_point(pCore->m_pCollision, vec2_init(vgetx(pCore->m_Pos) + HALFPHYSICALSIZE, vgety(pCore->m_Pos) + HALFPHYSICALSIZE + 5)) ||
        check_point(pCore->m_pCollision, vec2_init(vgetx(pCore->m_Pos) - HALFPHYSICALSIZE, vgety(pCore->m_Pos) + HALFPHYSICALSIZE + 5)));
 
-  pCore->m_Vel = vadd_y(pCore->m_Vel, pCore->m_pTuning->m_Gravity);
   pCore->m_Grounded = Grounded;
+  int Jump = JUMP_NONE;
   if (pCore->m_Input.m_Jump) {
     if (!(pCore->m_Jumped & 1)) {
       if (Grounded && (!(pCore->m_Jumped & 2) || pCore->m_Jumps != 0)) {
-        pCore->m_Vel = vsety(pCore->m_Vel, -pCore->m_pTuning->m_GroundJumpImpulse);
+        Jump = JUMP_GROUND;
         if (pCore->m_Jumps > 1) {
           pCore->m_Jumped |= 1;
         } else {
@@ -1420,7 +1874,7 @@ void cc_pre_tick(SCharacterCore *pCore) {
         }
         pCore->m_JumpedTotal = 0;
       } else if (!(pCore->m_Jumped & 2)) {
-        pCore->m_Vel = vsety(pCore->m_Vel, -pCore->m_pTuning->m_AirJumpImpulse);
+        Jump = JUMP_AIR;
         pCore->m_Jumped |= 3;
         pCore->m_JumpedTotal++;
       }
@@ -1445,15 +1899,28 @@ void cc_pre_tick(SCharacterCore *pCore) {
     pCore->m_HookPos = pCore->m_Pos;
   }
 
+  if (Grounded) {
+    pCore->m_Jumped &= ~2;
+    pCore->m_JumpedTotal = 0;
+  }
+  return Jump;
+}
+
+// gravity, jump impulse and horizontal control. wc_tick_batch has a vectorized copy of this, keep them in sync
+static void cc_pre_tick_control(SCharacterCore *pCore, int Jump) {
+  pCore->m_Vel = vadd_y(pCore->m_Vel, pCore->m_pTuning->m_Gravity);
+  if (Jump == JUMP_GROUND)
+    pCore->m_Vel = vsety(pCore->m_Vel, -pCore->m_pTuning->m_GroundJumpImpulse);
+  else if (Jump == JUMP_AIR)
+    pCore->m_Vel = vsety(pCore->m_Vel, -pCore->m_pTuning->m_AirJumpImpulse);
+
   float MaxSpeed = pCore->m_pTuning->m_AirControlSpeed;
   float Accel = pCore->m_pTuning->m_AirControlAccel;
   float Friction = pCore->m_pTuning->m_AirFriction;
-  if (Grounded) {
+  if (pCore->m_Grounded) {
     MaxSpeed = pCore->m_pTuning->m_GroundControlSpeed;
     Accel = pCore->m_pTuning->m_GroundControlAccel;
     Friction = pCore->m_pTuning->m_GroundFriction;
-    pCore->m_Jumped &= ~2;
-    pCore->m_JumpedTotal = 0;
   }
 
   if (pCore->m_Input.m_Direction < 0)
@@ -1462,232 +1929,320 @@ void cc_pre_tick(SCharacterCore *pCore) {
     pCore->m_Vel = vsetx(pCore->m_Vel, saturate_add(-MaxSpeed, MaxSpeed, vgetx(pCore->m_Vel), Accel));
   else
     pCore->m_Vel = vsetx(pCore->m_Vel, vgetx(pCore->m_Vel) * Friction);
+}
 
-  if (pCore->m_HookState == HOOK_IDLE) {
-    pCore->m_HookedPlayer = -1;
-    pCore->m_HookPos = pCore->m_Pos;
-  } else if (pCore->m_HookState >= HOOK_RETRACT_START && pCore->m_HookState < HOOK_RETRACT_END) {
-    pCore->m_HookState++;
-  } else if (pCore->m_HookState == HOOK_RETRACT_END) {
-    pCore->m_HookState = HOOK_RETRACTED;
-  } else if (pCore->m_HookState == HOOK_FLYING) {
-    mvec2 HookBase = pCore->m_Pos;
-    if (pCore->m_NewHook) {
-      HookBase = pCore->m_HookTeleBase;
-    }
-    mvec2 NewPos = vvadd(pCore->m_HookPos, vfmul(pCore->m_HookDir, pCore->m_pTuning->m_HookFireSpeed));
-
-    if (vsqdistance(HookBase, NewPos) > pCore->m_pTuning->m_HookLength * pCore->m_pTuning->m_HookLength) {
-      pCore->m_HookState = HOOK_RETRACT_START;
-      NewPos = vvadd(HookBase, vfmul(vnormalize_nomask(vvsub(NewPos, HookBase)), pCore->m_pTuning->m_HookLength));
-    }
-    // NOTE: this only really matters at the edge of the map but since we offset maps by 200 block idk if it actually matters. might remove this if it
-    // ends up being a hot path. same for this logic in laser bounce
-    {
-      float x0 = vgetx(pCore->m_HookPos), y0 = vgety(pCore->m_HookPos);
-      float x1 = vgetx(NewPos), y1 = vgety(NewPos);
+// where a flying hook gets this tick before tiles and tees are checked, starts the retraction at the end of the hook length
+static mvec2 cc_hook_target(SCharacterCore *pCore) {
+  mvec2 HookBase = pCore->m_Pos;
+  if (pCore->m_NewHook) {
+    HookBase = pCore->m_HookTeleBase;
+  }
+  mvec2 NewPos = vvadd(pCore->m_HookPos, vfmul(pCore->m_HookDir, pCore->m_pTuning->m_HookFireSpeed));
 
-      float dx = x1 - x0;
-      float dy = y1 - y0;
+  if (vsqdistance(HookBase, NewPos) > pCore->m_pTuning->m_HookLength * pCore->m_pTuning->m_HookLength) {
+    pCore->m_HookState = HOOK_RETRACT_START;
+    NewPos = vvadd(HookBase, vfmul(vnormalize_nomask(vvsub(NewPos, HookBase)), pCore->m_pTuning->m_HookLength));
+  }
+  // NOTE: this only really matters at the edge of the map but since we offset maps by 200 block idk if it actually matters. might remove this if it
+  // ends up being a hot path. same for this logic in laser bounce
+  {
+    float x0 = vgetx(pCore->m_HookPos), y0 = vgety(pCore->m_HookPos);
+    float x1 = vgetx(NewPos), y1 = vgety(NewPos);
 
-      float W = (float)pCore->m_pCollision->m_MapData.width * 32.0f;
-      float H = (float)pCore->m_pCollision->m_MapData.height * 32.0f;
+    float dx = x1 - x0;
+    float dy = y1 - y0;
 
-      float xmin = 0.0f, ymin = 0.0f;
-      float xmax = W - 1.0f, ymax = H - 1.0f;
+    float W = (float)pCore->m_pCollision->m_MapData.width * 32.0f;
+    float H = (float)pCore->m_pCollision->m_MapData.height * 32.0f;
 
-      float t0 = 0.0f, t1 = 1.0f;
+    float xmin = 0.0f, ymin = 0.0f;
+    float xmax = W - 1.0f, ymax = H - 1.0f;
 
-      CLIP(-dx, x0 - xmin); // left
-      CLIP(dx, xmax - x0);  // right
-      CLIP(-dy, y0 - ymin); // top
-      CLIP(dy, ymax - y0);  // bottom
+    float t0 = 0.0f, t1 = 1.0f;
 
-      // printf("Before: From:%.f,%.f, To:%.f,%.f\n", x0, y0, vgetx(NewPos), vgety(NewPos));
-      NewPos = vec2_init(x0 + dx * t1, y0 + dy * t1);
-      // printf("After: From:%.f,%.f, To:%.f,%.f\n", x0, y0, vgetx(NewPos), vgety(NewPos)); }
-    }
+    CLIP(-dx, x0 - xmin); // left
+    CLIP(dx, xmax - x0);  // right
+    CLIP(-dy, y0 - ymin); // top
+    CLIP(dy, ymax - y0);  // bottom
 
-    bool GoingToHitGround = false;
-    bool GoingToRetract = false;
-    bool GoingThroughTele = false;
-    unsigned char teleNr = 0;
-    unsigned char Hit = intersect_line_tele_hook(pCore->m_pCollision, pCore->m_HookPos, NewPos, &NewPos,
-                                                 pCore->m_pCollision->m_MapData.tele_layer.type ? &teleNr : NULL);
-
-    if (Hit) {
-      if (Hit == TILE_NOHOOK)
-        GoingToRetract = true;
-      else if (Hit == TILE_TELEINHOOK)
-        GoingThroughTele = true;
-      else
-        GoingToHitGround = true;
-    }
+    // printf("Before: From:%.f,%.f, To:%.f,%.f\n", x0, y0, vgetx(NewPos), vgety(NewPos));
+    NewPos = vec2_init(x0 + dx * t1, y0 + dy * t1);
+    // printf("After: From:%.f,%.f, To:%.f,%.f\n", x0, y0, vgetx(NewPos), vgety(NewPos)); }
+  }
+  return NewPos;
+}
 
-    if (pCore->m_pWorld->m_NumCharacters > 1 && !pCore->m_HookHitDisabled && pCore->m_pTuning->m_PlayerHooking &&
-        (pCore->m_HookState == HOOK_FLYING || !pCore->m_NewHook)) {
+// the tee the hook grabs on its way from StartPos to EndPos
+static void cc_hook_players(SCharacterCore *pCore, mvec2 StartPos, mvec2 EndPos) {
+  if (pCore->m_pWorld->m_NumCharacters <= 1 || pCore->m_HookHitDisabled || !pCore->m_pTuning->m_PlayerHooking ||
+      (pCore->m_HookState != HOOK_FLYING && pCore->m_NewHook))
+    return;
 
-      SWorldCore *pWorld = pCore->m_pWorld;
-      float ClosestDist = FLT_MAX;
+  SWorldCore *pWorld = pCore->m_pWorld;
+  float ClosestDist = FLT_MAX;
 
-      mvec2 StartPos = pCore->m_HookPos;
-      mvec2 EndPos = NewPos;
+  int MapWidth = pWorld->m_pCollision->m_MapData.width;
+  int MapHeight = pWorld->m_pCollision->m_MapData.height;
 
-      int MapWidth = pWorld->m_pCollision->m_MapData.width;
-      int MapHeight = pWorld->m_pCollision->m_MapData.height;
+  int StartX = (int)vgetx(StartPos) >> 5;
+  int StartY = (int)vgety(StartPos) >> 5;
+  int EndX = (int)vgetx(EndPos) >> 5;
+  int EndY = (int)vgety(EndPos) >> 5;
 
-      int StartX = (int)vgetx(StartPos) >> 5;
-      int StartY = (int)vgety(StartPos) >> 5;
-      int EndX = (int)vgetx(EndPos) >> 5;
-      int EndY = (int)vgety(EndPos) >> 5;
+  int CurrentX = StartX;
+  int CurrentY = StartY;
 
-      int CurrentX = StartX;
-      int CurrentY = StartY;
+  mvec2 Dir = vvsub(EndPos, StartPos);
+  float dx = vgetx(Dir);
+  float dy = vgety(Dir);
 
-      mvec2 Dir = vvsub(EndPos, StartPos);
-      float dx = vgetx(Dir);
-      float dy = vgety(Dir);
+  int StepX = (dx > 0) ? 1 : -1;
+  int StepY = (dy > 0) ? 1 : -1;
 
-      int StepX = (dx > 0) ? 1 : -1;
-      int StepY = (dy > 0) ? 1 : -1;
+  float NextBoundaryX = (CurrentX + (dx > 0 ? 1 : 0)) * 32.0f;
+  float NextBoundaryY = (CurrentY + (dy > 0 ? 1 : 0)) * 32.0f;
 
-      float NextBoundaryX = (CurrentX + (dx > 0 ? 1 : 0)) * 32.0f;
-      float NextBoundaryY = (CurrentY + (dy > 0 ? 1 : 0)) * 32.0f;
+  float tMaxX = (dx != 0.0f) ? (NextBoundaryX - vgetx(StartPos)) / dx : FLT_MAX;
+  float tMaxY = (dy != 0.0f) ? (NextBoundaryY - vgety(StartPos)) / dy : FLT_MAX;
 
-      float tMaxX = (dx != 0.0f) ? (NextBoundaryX - vgetx(StartPos)) / dx : FLT_MAX;
-      float tMaxY = (dy != 0.0f) ? (NextBoundaryY - vgety(StartPos)) / dy : FLT_MAX;
+  float tDeltaX = (dx != 0.0f) ? (32.0f * StepX) / dx : FLT_MAX;
+  float tDeltaY = (dy != 0.0f) ? (32.0f * StepY) / dy : FLT_MAX;
 
-      float tDeltaX = (dx != 0.0f) ? (32.0f * StepX) / dx : FLT_MAX;
-      float tDeltaY = (dy != 0.0f) ? (32.0f * StepY) / dy : FLT_MAX;
+  // every step gets one tile closer to the end, a walk that rounds past it would never stop
+  const int NumSteps = abs(EndX - StartX) + abs(EndY - StartY);
 
-      int aCheckedIndices[128];
-      int NumChecked = 0;
+  int aCheckedIndices[128];
+  int NumChecked = 0;
 
-      while (true) {
-        // 3x3 block around the current cell
-        for (int offsetY = -1; offsetY <= 1; ++offsetY) {
-          for (int offsetX = -1; offsetX <= 1; ++offsetX) {
-            int CheckX = CurrentX + offsetX;
-            int CheckY = CurrentY + offsetY;
+  for (int Step = 0;; ++Step) {
+    // 3x3 block around the current cell
+    for (int offsetY = -1; offsetY <= 1; ++offsetY) {
+      for (int offsetX = -1; offsetX <= 1; ++offsetX) {
+        int CheckX = CurrentX + offsetX;
+        int CheckY = CurrentY + offsetY;
 
-            // Bounds check
-            if (CheckX < 0 || CheckY < 0 || CheckX >= MapWidth || CheckY >= MapHeight)
-              continue;
+        // Bounds check
+        if (CheckX < 0 || CheckY < 0 || CheckX >= MapWidth || CheckY >= MapHeight)
+          continue;
 
-            int MapIndex = CheckY * MapWidth + CheckX;
+        int MapIndex = CheckY * MapWidth + CheckX;
 
-            // Check if we already processed this cell for this hook tick
-            bool bAlreadyChecked = false;
-            for (int j = 0; j < NumChecked; ++j) {
-              if (aCheckedIndices[j] == MapIndex) {
-                bAlreadyChecked = true;
-                break;
-              }
-            }
+        // Check if we already processed this cell for this hook tick
+        bool bAlreadyChecked = false;
+        for (int j = 0; j < NumChecked; ++j) {
+          if (aCheckedIndices[j] == MapIndex) {
+            bAlreadyChecked = true;
+            break;
+          }
+        }
 
-            if (bAlreadyChecked)
-              continue;
+        if (bAlreadyChecked)
+          continue;
 
-            // Add to checked list
-            if (NumChecked < 128) {
-              aCheckedIndices[NumChecked++] = MapIndex;
-            }
+        // Add to checked list
+        if (NumChecked < 128) {
+          aCheckedIndices[NumChecked++] = MapIndex;
+        }
 
-            // Now, check against all players in this cell
-            int PlayerId = pWorld->m_Accelerator.m_pGrid->m_pTeeGrid[MapIndex];
-            while (PlayerId >= 0) {
-              SCharacterCore *pEntity = &pWorld->m_pCharacters[PlayerId];
-
-              if (pEntity != pCore && !pEntity->m_Solo && !pCore->m_Solo) {
-                mvec2 ClosestPoint;
-                if (closest_point_on_line(StartPos, EndPos, pEntity->m_Pos, &ClosestPoint)) {
-                  if (vdistance(pEntity->m_Pos, ClosestPoint) < PHYSICALSIZE + 2.0f) {
-                    float dist = vdistance(StartPos, pEntity->m_Pos);
-                    if (dist < ClosestDist) {
-                      ClosestDist = dist;
-                      pCore->m_HookedPlayer = pEntity->m_Id;
-                    }
-                  }
+        // Now, check against all players in this cell
+        int PlayerId = th_head(&pWorld->m_Accelerator.m_Heads, MapIndex);
+        while (PlayerId >= 0) {
+          SCharacterCore *pEntity = &pWorld->m_pCharacters[PlayerId];
+
+          if (pEntity != pCore && !pEntity->m_Solo && !pCore->m_Solo) {
+            mvec2 ClosestPoint;
+            if (closest_point_on_line(StartPos, EndPos, pEntity->m_Pos, &ClosestPoint)) {
+              if (vdistance(pEntity->m_Pos, ClosestPoint) < PHYSICALSIZE + 2.0f) {
+                float dist = vdistance(StartPos, pEntity->m_Pos);
+                if (dist < ClosestDist) {
+                  ClosestDist = dist;
+                  pCore->m_HookedPlayer = pEntity->m_Id;
                 }
               }
-              PlayerId = pWorld->m_Accelerator.m_pTeeList[PlayerId].m_Child;
             }
           }
-        }
-
-        if (CurrentX == EndX && CurrentY == EndY) {
-          break;
-        }
-
-        if (tMaxX < tMaxY) {
-          tMaxX += tDeltaX;
-          CurrentX += StepX;
-        } else {
-          tMaxY += tDeltaY;
-          CurrentY += StepY;
+          PlayerId = pWorld->m_Accelerator.m_pTeeList[PlayerId].m_Child;
         }
       }
+    }
 
-      if (pCore->m_HookedPlayer != -1) {
-        pCore->m_HookState = HOOK_GRABBED;
-      }
+    if (Step == NumSteps) {
+      break;
     }
 
-    if (pCore->m_HookState == HOOK_FLYING) {
-      if (GoingToHitGround) {
-        pCore->m_HookState = HOOK_GRABBED;
-      } else if (GoingToRetract) {
-        pCore->m_HookState = HOOK_RETRACT_START;
-      }
-      int NumOuts = pCore->m_pCollision->m_aNumTeleOuts[teleNr];
-      if (GoingThroughTele && NumOuts > 0) {
-        pCore->m_HookedPlayer = -1;
-        mvec2 TargetDirection = vnormalize(vec2_init(pCore->m_Input.m_TargetX, pCore->m_Input.m_TargetY));
-        pCore->m_NewHook = true;
-        pCore->m_HookPos =
-            vvadd(pCore->m_pCollision->m_apTeleOuts[teleNr][pCore->m_Input.m_TeleOut % NumOuts], vfmul(TargetDirection, PHYSICALSIZE * 1.5f));
-        pCore->m_HookDir = TargetDirection;
-        pCore->m_HookTeleBase = pCore->m_HookPos;
-      } else {
-        pCore->m_HookPos = NewPos;
-      }
+    if (tMaxX < tMaxY) {
+      tMaxX += tDeltaX;
+      CurrentX += StepX;
+    } else {
+      tMaxY += tDeltaY;
+      CurrentY += StepY;
     }
   }
 
-  if (pCore->m_HookState == HOOK_GRABBED) {
-    if (pCore->m_HookedPlayer != -1) {
-      SCharacterCore *pCharCore = &pCore->m_pWorld->m_pCharacters[pCore->m_HookedPlayer];
-      if (pCharCore && pCore->m_Id != -1)
-        pCore->m_HookPos = pCharCore->m_Pos;
-      else {
-        pCore->m_HookedPlayer = -1;
-        pCore->m_HookState = HOOK_RETRACTED;
-        pCore->m_HookPos = pCore->m_Pos;
-      }
-    } else if (vsqdistance(pCore->m_HookPos, pCore->m_Pos) > 46 * 46) {
-      mvec2 HookVel = vfmul(vnormalize_nomask(vvsub(pCore->m_HookPos, pCore->m_Pos)), pCore->m_pTuning->m_HookDragAccel);
-      if (vgety(HookVel) > 0)
-        HookVel = vsety(HookVel, vgety(HookVel) * 0.3f);
-      if (pCore->m_Input.m_Direction != 0 && compare_sign_bits(vgetx(HookVel), pCore->m_Input.m_Direction))
-        HookVel = vsetx(HookVel, vgetx(HookVel) * 0.95f);
-      else
-        HookVel = vsetx(HookVel, vgetx(HookVel) * 0.75f);
-
-      mvec2 NewVel = vvadd(pCore->m_Vel, HookVel);
+  if (pCore->m_HookedPlayer != -1) {
+    pCore->m_HookState = HOOK_GRABBED;
+  }
+}
 
-      const float NewVelLength = vsqlength(NewVel);
-      if (NewVelLength < pCore->m_pTuning->m_HookDragSpeed * pCore->m_pTuning->m_HookDragSpeed || NewVelLength < vsqlength(pCore->m_Vel))
-        pCore->m_Vel = NewVel;
-    }
+// applies the tile hit of the hook ray, Hit and teleNr as returned by intersect_line_tele_hook
+static void cc_hook_flying_finish(SCharacterCore *pCore, mvec2 NewPos, unsigned char Hit, unsigned char teleNr) {
+  if (pCore->m_HookState != HOOK_FLYING)
+    return;
+  if (Hit == TILE_NOHOOK)
+    pCore->m_HookState = HOOK_RETRACT_START;
+  else if (Hit && Hit != TILE_TELEINHOOK)
+    pCore->m_HookState = HOOK_GRABBED;
+  int NumOuts = pCore->m_pCollision->m_aNumTeleOuts[teleNr];
+  if (Hit == TILE_TELEINHOOK && NumOuts > 0) {
+    pCore->m_HookedPlayer = -1;
+    mvec2 TargetDirection = vnormalize(vec2_init(pCore->m_Input.m_TargetX, pCore->m_Input.m_TargetY));
+    pCore->m_NewHook = true;
+    pCore->m_HookPos =
+        vvadd(pCore->m_pCollision->m_apTeleOuts[teleNr][pCore->m_Input.m_TeleOut % NumOuts], vfmul(TargetDirection, PHYSICALSIZE * 1.5f));
+    pCore->m_HookDir = TargetDirection;
+    pCore->m_HookTeleBase = pCore->m_HookPos;
+  } else {
+    pCore->m_HookPos = NewPos;
+  }
+}
 
-    pCore->m_HookTick++;
-    if (pCore->m_HookedPlayer != -1 &&
-        (pCore->m_HookTick > GAME_TICK_SPEED + GAME_TICK_SPEED / 5 || (pCore->m_HookedPlayer >= pCore->m_pWorld->m_NumCharacters))) {
+// hook drag and the end of player hooks
+static void cc_hook_grabbed(SCharacterCore *pCore) {
+  if (pCore->m_HookState != HOOK_GRABBED)
+    return;
+  if (pCore->m_HookedPlayer != -1) {
+    SCharacterCore *pCharCore = &pCore->m_pWorld->m_pCharacters[pCore->m_HookedPlayer];
+    if (pCharCore && pCore->m_Id != -1)
+      pCore->m_HookPos = pCharCore->m_Pos;
+    else {
       pCore->m_HookedPlayer = -1;
       pCore->m_HookState = HOOK_RETRACTED;
       pCore->m_HookPos = pCore->m_Pos;
     }
+  } else if (vsqdistance(pCore->m_HookPos, pCore->m_Pos) > 46 * 46) {
+    mvec2 HookVel = vfmul(vnormalize_nomask(vvsub(pCore->m_HookPos, pCore->m_Pos)), pCore->m_pTuning->m_HookDragAccel);
+    if (vgety(HookVel) > 0)
+      HookVel = vsety(HookVel, vgety(HookVel) * 0.3f);
+    if (pCore->m_Input.m_Direction != 0 && compare_sign_bits(vgetx(HookVel), pCore->m_Input.m_Direction))
+      HookVel = vsetx(HookVel, vgetx(HookVel) * 0.95f);
+    else
+      HookVel = vsetx(HookVel, vgetx(HookVel) * 0.75f);
+
+    mvec2 NewVel = vvadd(pCore->m_Vel, HookVel);
+
+    const float NewVelLength = vsqlength(NewVel);
+    if (NewVelLength < pCore->m_pTuning->m_HookDragSpeed * pCore->m_pTuning->m_HookDragSpeed || NewVelLength < vsqlength(pCore->m_Vel))
+      pCore->m_Vel = NewVel;
   }
+
+  pCore->m_HookTick++;
+  if (pCore->m_HookedPlayer != -1 &&
+      (pCore->m_HookTick > GAME_TICK_SPEED + GAME_TICK_SPEED / 5 || (pCore->m_HookedPlayer >= pCore->m_pWorld->m_NumCharacters))) {
+    pCore->m_HookedPlayer = -1;
+    pCore->m_HookState = HOOK_RETRACTED;
+    pCore->m_HookPos = pCore->m_Pos;
+  }
+}
+
+// hook state machine, tile and player hooking
+static void cc_pre_tick_hook(SCharacterCore *pCore) {
+  if (pCore->m_HookState == HOOK_IDLE) {
+    pCore->m_HookedPlayer = -1;
+    pCore->m_HookPos = pCore->m_Pos;
+  } else if (pCore->m_HookState >= HOOK_RETRACT_START && pCore->m_HookState < HOOK_RETRACT_END) {
+    pCore->m_HookState++;
+  } else if (pCore->m_HookState == HOOK_RETRACT_END) {
+    pCore->m_HookState = HOOK_RETRACTED;
+  } else if (pCore->m_HookState == HOOK_FLYING) {
+    mvec2 NewPos = cc_hook_target(pCore);
+    unsigned char teleNr = 0;
+    const unsigned char Hit = intersect_line_tele_hook(pCore->m_pCollision, pCore->m_HookPos, NewPos, &NewPos,
+                                                       pCore->m_pCollision->m_MapData.tele_layer.type ? &teleNr : NULL);
+    cc_hook_players(pCore, pCore->m_HookPos, NewPos);
+    cc_hook_flying_finish(pCore, NewPos, Hit, teleNr);
+  }
+  cc_hook_grabbed(pCore);
+}
+
+void cc_pre_tick(SCharacterCore *pCore) {
+  const int Jump = cc_pre_tick_input(pCore);
+  cc_pre_tick_control(pCore, Jump);
+  cc_pre_tick_hook(pCore);
+}
+
+// Lanes of pRays whose hook passes close enough to another tee to grab it. Every ray is compared with every tee, the distance gets a
+// margin so cc_hook_players still makes the exact decision. Big worlds walk the tee grid for all rays instead.
+static int wc_hook_ray_tees(const SWorldCore *pWorld, const SHookRayLanes *pRays, const int *pIds, int LaneMask) {
+  if (pWorld->m_NumCharacters > HOOK_RAY_TEE_SCAN_MAX)
+    return LaneMask;
+  const __m256 FromX = _mm256_loadu_ps(pRays->m_aFromX);
+  const __m256 FromY = _mm256_loadu_ps(pRays->m_aFromY);
+  const __m256 DirX = _mm256_sub_ps(_mm256_loadu_ps(pRays->m_aOutX), FromX);
+  const __m256 DirY = _mm256_sub_ps(_mm256_loadu_ps(pRays->m_aOutY), FromY);
+  const __m256 SqLength = _mm256_add_ps(_mm256_mul_ps(DirX, DirX), _mm256_mul_ps(DirY, DirY));
+  // rays of length 0 can't grab anyone, see closest_point_on_line
+  const __m256 Valid = _mm256_cmp_ps(SqLength, _mm256_setzero_ps(), _CMP_GT_OQ);
+  LaneMask &= _mm256_movemask_ps(Valid);
+  const __m256 InvSqLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_blendv_ps(_mm256_set1_ps(1.0f), SqLength, Valid));
+  const __m256i Ids = _mm256_loadu_si256((const __m256i *)pIds);
+  const __m256 Limit = _mm256_set1_ps((PHYSICALSIZE + 3.0f) * (PHYSICALSIZE + 3.0f));
+  int Near = 0;
+  for (int i = 0; i < pWorld->m_NumCharacters && Near != LaneMask; ++i) {
+    const __m256 ToX = _mm256_sub_ps(_mm256_set1_ps(vgetx(pWorld->m_pCharacters[i].m_Pos)), FromX);
+    const __m256 ToY = _mm256_sub_ps(_mm256_set1_ps(vgety(pWorld->m_pCharacters[i].m_Pos)), FromY);
+    __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ToX, DirX), _mm256_mul_ps(ToY, DirY)), InvSqLength);
+    t = _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    const __m256 OffX = _mm256_sub_ps(ToX, _mm256_mul_ps(DirX, t));
+    const __m256 OffY = _mm256_sub_ps(ToY, _mm256_mul_ps(DirY, t));
+    const __m256 Close = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(OffX, OffX), _mm256_mul_ps(OffY, OffY)), Limit, _CMP_LT_OQ);
+    // a hook never grabs its own tee
+    const __m256 Other = _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(Ids, _mm256_set1_epi32(i)), _mm256_set1_epi32(-1)));
+    Near |= _mm256_movemask_ps(_mm256_and_ps(Close, Other));
+  }
+  return Near & LaneMask;
+}
+
+// casts the rays of the flying hooks of the tees in pIds and finishes their hook tick
+static void wc_cast_hooks(SWorldCore *pWorld, SHookRayLanes *pRays, int *pIds, int Num) {
+  for (int i = Num; i < HOOK_RAY_LANES; ++i)
+    pIds[i] = -1;
+  intersect_line_tele_hook_x8(pWorld->m_pCollision, pRays, (1 << Num) - 1);
+  const int Near = wc_hook_ray_tees(pWorld, pRays, pIds, (1 << Num) - 1);
+  for (int i = 0; i < Num; ++i) {
+    SCharacterCore *pChar = &pWorld->m_pCharacters[pIds[i]];
+    const mvec2 NewPos = vec2_init(pRays->m_aOutX[i], pRays->m_aOutY[i]);
+    if (Near & 1 << i)
+      cc_hook_players(pChar, pChar->m_HookPos, NewPos);
+    cc_hook_flying_finish(pChar, NewPos, pRays->m_aHit[i], pRays->m_aTeleNr[i]);
+    cc_hook_grabbed(pChar);
+  }
+}
+
+// cc_pre_tick_hook for every tee of a world, the flying hooks are cast HOOK_RAY_LANES at a time. Hooks only change their own tee, so
+// the order doesn't matter.
+static void wc_pre_tick_hooks(SWorldCore *pWorld) {
+  SHookRayLanes Rays;
+  int aIds[HOOK_RAY_LANES];
+  int Num = 0;
+  for (int i = 0; i < pWorld->m_NumCharacters; ++i) {
+    SCharacterCore *pChar = &pWorld->m_pCharacters[i];
+    if (pChar->m_HookState != HOOK_FLYING) {
+      cc_pre_tick_hook(pChar);
+      continue;
+    }
+    const mvec2 NewPos = cc_hook_target(pChar);
+    Rays.m_aFromX[Num] = vgetx(pChar->m_HookPos);
+    Rays.m_aFromY[Num] = vgety(pChar->m_HookPos);
+    Rays.m_aToX[Num] = vgetx(NewPos);
+    Rays.m_aToY[Num] = vgety(NewPos);
+    aIds[Num++] = i;
+    if (Num == HOOK_RAY_LANES) {
+      wc_cast_hooks(pWorld, &Rays, aIds, Num);
+      Num = 0;
+    }
+  }
+  if (Num)
+    wc_cast_hooks(pWorld, &Rays, aIds, Num);
 }
 
 void cc_remove_ninja(SCharacterCore *pCore) {
@@ -1805,6 +2360,32 @@ void cc_do_weapon_switch(SCharacterCore *pCore) {
 
 void wc_remove_entity(SWorldCore *pWorld, SEntity *pEnt);
 
+// returns whether the hammer of pCore hit pTarget
+static bool cc_hammer_hit(SCharacterCore *pCore, SCharacterCore *pTarget, mvec2 ProjStartPos) {
+  if (vdistance(pTarget->m_Pos, ProjStartPos) < HALFPHYSICALSIZE + PHYSICALSIZE) {
+    if (pTarget == pCore || pTarget->m_Solo)
+      return false;
+
+    mvec2 Dir;
+    if (vsqdistance(pTarget->m_Pos, pCore->m_Pos) > 0.0f)
+      Dir = vnormalize(vvsub(pTarget->m_Pos, pCore->m_Pos));
+    else
+      Dir = vec2_init(0.f, -1.f);
+
+    float Strength = pCore->m_pTuning->m_HammerStrength;
+
+    mvec2 Temp = vvadd(pTarget->m_Vel, vfmul(vnormalize(vvadd(Dir, vec2_init(0.f, -1.1f))), 10.0f));
+    Temp = vvsub(clamp_vel(pTarget->m_MoveRestrictions, Temp), pTarget->m_Vel);
+
+    mvec2 Force = vfmul(vvadd(vec2_init(0.f, -1.0f), Temp), Strength);
+
+    cc_take_damage(pTarget, Force);
+    cc_unfreeze(pTarget);
+    return true;
+  }
+  return false;
+}
+
 void cc_fire_weapon(SCharacterCore *pCore) {
   if (pCore->m_aWeaponGot[pCore->m_QueuedWeapon] && pCore->m_ReloadTimer == 0 && !pCore->m_aWeaponGot[WEAPON_NINJA]) {
     pCore->m_LastWeapon = pCore->m_ActiveWeapon;
@@ -1850,32 +2431,17 @@ void cc_fire_weapon(SCharacterCore *pCore) {
     if (pCore->m_Solo)
       break;
 
+    // every tee is handled on its own, so the order they are visited in doesn't matter
     int Hits = 0;
-    for (int i = 0; i < pCore->m_pWorld->m_NumCharacters; ++i) {
-      if (vdistance(pCore->m_pWorld->m_pCharacters[i].m_Pos, ProjStartPos) < HALFPHYSICALSIZE + PHYSICALSIZE) {
-        SCharacterCore *pTarget = &pCore->m_pWorld->m_pCharacters[i];
-
-        if (pTarget == pCore || pTarget->m_Solo)
-          continue;
-
-        mvec2 Dir;
-        if (vsqdistance(pTarget->m_Pos, pCore->m_Pos) > 0.0f)
-          Dir = vnormalize(vvsub(pTarget->m_Pos, pCore->m_Pos));
-        else
-          Dir = vec2_init(0.f, -1.f);
-
-        float Strength = pCore->m_pTuning->m_HammerStrength;
-
-        mvec2 Temp = vvadd(pTarget->m_Vel, vfmul(vnormalize(vvadd(Dir, vec2_init(0.f, -1.1f))), 10.0f));
-        Temp = vvsub(clamp_vel(pTarget->m_MoveRestrictions, Temp), pTarget->m_Vel);
-
-        mvec2 Force = vfmul(vvadd(vec2_init(0.f, -1.0f), Temp), Strength);
-
-        cc_take_damage(pTarget, Force);
-        cc_unfreeze(pTarget);
-
-        Hits++;
-      }
+    const float Reach = HALFPHYSICALSIZE + PHYSICALSIZE + 1.0f;
+    STeeQuery Query;
+    if (tq_init(&Query, pCore->m_pWorld, vgetx(ProjStartPos) - Reach, vgety(ProjStartPos) - Reach, vgetx(ProjStartPos) + Reach,
+                vgety(ProjStartPos) + Reach)) {
+      for (int Id = tq_next(&Query); Id >= 0; Id = tq_next(&Query))
+        Hits += cc_hammer_hit(pCore, &pCore->m_pWorld->m_pCharacters[Id], ProjStartPos);
+    } else {
+      for (int i = 0; i < pCore->m_pWorld->m_NumCharacters; ++i)
+        Hits += cc_hammer_hit(pCore, &pCore->m_pWorld->m_pCharacters[i], ProjStartPos);
     }
 
     // if we Hit anything, we have to wait for the reload
@@ -1889,34 +2455,42 @@ void cc_fire_weapon(SCharacterCore *pCore) {
   case WEAPON_GUN: {
     if (pCore->m_HasTelegunGun) {
       const int Lifetime = (int)(GAME_TICK_SPEED * pCore->m_pTuning->m_GunLifetime);
-      SProjectile *pNewProj = malloc(sizeof(SProjectile));
+      SProjectile *pNewProj = (SProjectile *)wc_new_entity(pCore->m_pWorld);
+      if (!pNewProj)
+        break;
       prj_init(pNewProj, pCore->m_pWorld, WEAPON_GUN, pCore->m_Id, ProjStartPos, Direction, Lifetime, false, false, 0, 0);
-      wc_insert_entity(pCore->m_pWorld, (SEntity *)pNewProj);
+      wc_link_entity(pCore->m_pWorld, (SEntity *)pNewProj);
     }
     break;
   }
 
   case WEAPON_SHOTGUN: {
     const float LaserReach = pCore->m_pTuning->m_LaserReach;
-    SLaser *pNewLaser = malloc(sizeof(SLaser));
+    SLaser *pNewLaser = (SLaser *)wc_new_entity(pCore->m_pWorld);
+    if (!pNewLaser)
+      break;
     lsr_init(pNewLaser, pCore->m_pWorld, WEAPON_SHOTGUN, pCore->m_Id, pCore->m_Pos, Direction, LaserReach);
-    wc_insert_entity(pCore->m_pWorld, (SEntity *)pNewLaser);
+    wc_link_entity(pCore->m_pWorld, (SEntity *)pNewLaser);
     break;
   }
 
   case WEAPON_GRENADE: {
     const int Lifetime = (int)(GAME_TICK_SPEED * pCore->m_pTuning->m_GrenadeLifetime);
-    SProjectile *pNewProj = malloc(sizeof(SProjectile));
+    SProjectile *pNewProj = (SProjectile *)wc_new_entity(pCore->m_pWorld);
+    if (!pNewProj)
+      break;
     prj_init(pNewProj, pCore->m_pWorld, WEAPON_GRENADE, pCore->m_Id, ProjStartPos, Direction, Lifetime, false, true, 0, 0);
-    wc_insert_entity(pCore->m_pWorld, (SEntity *)pNewProj);
+    wc_link_entity(pCore->m_pWorld, (SEntity *)pNewProj);
     break;
   }
 
   case WEAPON_LASER: {
     const float LaserReach = pCore->m_pTuning->m_LaserReach;
-    SLaser *pNewLaser = malloc(sizeof(SLaser));
+    SLaser *pNewLaser = (SLaser *)wc_new_entity(pCore->m_pWorld);
+    if (!pNewLaser)
+      break;
     lsr_init(pNewLaser, pCore->m_pWorld, WEAPON_LASER, pCore->m_Id, pCore->m_Pos, Direction, LaserReach);
-    wc_insert_entity(pCore->m_pWorld, (SEntity *)pNewLaser);
+    wc_link_entity(pCore->m_pWorld, (SEntity *)pNewLaser);
     break;
   }
 
@@ -1953,8 +2527,7 @@ void cc_handle_weapons(SCharacterCore *pCore) {
 }
 
 void cc_tick(SCharacterCore *pCore) {
-  if (pCore->m_RespawnDelay)
-    --pCore->m_RespawnDelay;
+  cc_tick_respawn_delay(pCore);
 
   cc_tick_deferred(pCore);
 
@@ -1963,9 +2536,7 @@ void cc_tick(SCharacterCore *pCore) {
 
   cc_ddrace_postcore_tick(pCore);
 
-  pCore->m_PrevPos = pCore->m_Pos;
-  if (pCore->m_HitNum > 0)
-    --pCore->m_HitNum;
+  cc_tick_end(pCore);
 }
 
 void cc_on_input(SCharacterCore *pCore, const SPlayerInput *pNewInput) {
@@ -2079,7 +2650,11 @@ bool wc_on_entity(SWorldCore *pCore, int Index, int x, int y, int Layer, int Fla
     else
       Dir = 3;
     float Deg = Dir * (PI / 2);
-    SProjectile *pBullet = malloc(sizeof(SProjectile));
+    SProjectile *pBullet = (SProjectile *)wc_new_entity(pCore);
+    if (!pBullet) {
+      printf("Error: Failed to allocate a crazy shotgun bullet.\n");
+      return false;
+    }
     prj_init(pBullet, pCore,
              WEAPON_SHOTGUN,                // Type
              -1,                            // Owner
@@ -2090,7 +2665,7 @@ bool wc_on_entity(SWorldCore *pCore, int Index, int x, int y, int Layer, int Fla
              true,                          // Explosive
              Layer, Number);
     pBullet->m_Bouncing = 2 - (Dir % 2);
-    wc_insert_entity(pCore, (SEntity *)pBullet);
+    wc_link_entity(pCore, (SEntity *)pBullet);
   } else if (Index == ENTITY_CRAZY_SHOTGUN) {
     int Dir;
     if (!Flags)
@@ -2102,7 +2677,11 @@ bool wc_on_entity(SWorldCore *pCore, int Index, int x, int y, int Layer, int Fla
     else
       Dir = 3;
     float Deg = Dir * (PI / 2);
-    SProjectile *pBullet = malloc(sizeof(SProjectile));
+    SProjectile *pBullet = (SProjectile *)wc_new_entity(pCore);
+    if (!pBullet) {
+      printf("Error: Failed to allocate a crazy shotgun bullet.\n");
+      return false;
+    }
     prj_init(pBullet, pCore,
              WEAPON_SHOTGUN,                // Type
              -1,                            // Owner
@@ -2113,7 +2692,7 @@ bool wc_on_entity(SWorldCore *pCore, int Index, int x, int y, int Layer, int Fla
              false,                         // Explosive
              Layer, Number);
     pBullet->m_Bouncing = 2 - (Dir % 2);
-    wc_insert_entity(pCore, (SEntity *)pBullet);
+    wc_link_entity(pCore, (SEntity *)pBullet);
   }
 
   if (Index >= ENTITY_LASER_FAST_CCW && Index <= ENTITY_LASER_FAST_CW) {
@@ -2191,19 +2770,16 @@ bool wc_on_entity(SWorldCore *pCore, int Index, int x, int y, int Layer, int Fla
 void wc_create_all_entities(SWorldCore *pCore) {
   for (int y = 0; y < pCore->m_pCollision->m_MapData.height; y++) {
     for (int x = 0; x < pCore->m_pCollision->m_MapData.width; x++) {
-      const int Index = pCore->m_pCollision->m_pWidthLookup[y] + x;
+      const int Index = map_index(pCore->m_pCollision, x, y);
 
       // Game layer
       {
+        // TILE_NPC and TILE_NPH are applied to the tunings by init_collision, the world must not write to the shared collision
         const int GameIndex = pCore->m_pCollision->m_MapData.game_layer.data[Index];
-        if (GameIndex == TILE_NPC) {
-          pCore->m_pTunings[0].m_PlayerCollision = 0;
-        } else if (GameIndex == TILE_EHOOK) {
+        if (GameIndex == TILE_EHOOK) {
           pCore->m_pConfig->m_SvEndlessDrag = 1;
         } else if (GameIndex == TILE_NOHIT) {
           pCore->m_pConfig->m_SvHit = 0;
-        } else if (GameIndex == TILE_NPH) {
-          pCore->m_pTunings[0].m_PlayerHooking = 0;
         } else if (GameIndex >= ENTITY_OFFSET) {
           wc_on_entity(pCore, GameIndex - ENTITY_OFFSET, x, y, LAYER_GAME, pCore->m_pCollision->m_MapData.game_layer.flags[Index], 0);
         }
@@ -2211,14 +2787,10 @@ void wc_create_all_entities(SWorldCore *pCore) {
 
       if (pCore->m_pCollision->m_MapData.front_layer.data) {
         const int FrontIndex = pCore->m_pCollision->m_MapData.front_layer.data[Index];
-        if (FrontIndex == TILE_NPC) {
-          pCore->m_pTunings[0].m_PlayerCollision = 0;
-        } else if (FrontIndex == TILE_EHOOK) {
+        if (FrontIndex == TILE_EHOOK) {
           pCore->m_pConfig->m_SvEndlessDrag = 1;
         } else if (FrontIndex == TILE_NOHIT) {
           pCore->m_pConfig->m_SvHit = 0;
-        } else if (FrontIndex == TILE_NPH) {
-          pCore->m_pTunings[0].m_PlayerHooking = 0;
         } else if (FrontIndex >= ENTITY_OFFSET) {
           wc_on_entity(pCore, FrontIndex - ENTITY_OFFSET, x, y, LAYER_FRONT, pCore->m_pCollision->m_MapData.front_layer.flags[Index], 0);
         }
@@ -2235,24 +2807,9 @@ void wc_create_all_entities(SWorldCore *pCore) {
   }
 }
 
-STeeGrid tg_empty(void) { return (STeeGrid){0}; }
-void tg_init(STeeGrid *pGrid, int width, int height) {
-  free(pGrid->m_pTeeGrid);
-  pGrid->m_pTeeGrid = malloc(sizeof(int) * width * height);
-  memset(pGrid->m_pTeeGrid, -1, sizeof(int) * width * height);
-  pGrid->hash = 0; // gets set by the last used world
-}
-
-void tg_destroy(STeeGrid *pGrid) {
-  free(pGrid->m_pTeeGrid);
-  *pGrid = tg_empty();
-}
-
-void wc_init(SWorldCore *pCore, SCollision *pCollision, STeeGrid *pGrid, SConfig *pConfig) {
+void wc_init(SWorldCore *pCore, SCollision *pCollision, SConfig *pConfig) {
   memset(pCore, 0, sizeof(SWorldCore));
   pCore->m_pCollision = pCollision;
-  pCore->m_Accelerator.m_pGrid = pGrid;
-  pCore->m_Accelerator.hash = ((uint64_t)rand() << 32) | rand();
   pCore->m_pConfig = pConfig;
 
   init_switchers(pCore, pCollision->m_HighestSwitchNumber);
@@ -2263,88 +2820,74 @@ void wc_init(SWorldCore *pCore, SCollision *pCollision, STeeGrid *pGrid, SConfig
 }
 
 void wc_free(SWorldCore *pCore) {
-  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
-    SEntity *pEntity = pCore->m_apFirstEntityTypes[i];
-    while (pEntity) {
-      SEntity *pFree = pEntity;
-      pEntity = pEntity->m_pNextTypeEntity;
-      free(pFree);
-    }
+  ep_destroy(&pCore->m_EntityPool);
+  if (pCore->m_pFlatBlock) {
+    _mm_free(pCore->m_pFlatBlock);
+  } else {
+    free(pCore->m_pSwitches);
+    free(pCore->m_Accelerator.m_pTeeList);
+    free(pCore->m_pCharacters);
   }
-  free(pCore->m_pSwitches);
-  free(pCore->m_Accelerator.m_pTeeList);
-  free(pCore->m_pCharacters);
+  ta_free(&pCore->m_Accelerator);
   memset(pCore, 0, sizeof(SWorldCore));
 }
 
+// rebuilds the tile hash from our own tee links
 static void wc_clear_grid(SWorldCore *pCore) {
-  // clear grid
-  memset(pCore->m_Accelerator.m_pGrid->m_pTeeGrid, -1, pCore->m_pCollision->m_MapData.width * pCore->m_pCollision->m_MapData.height * sizeof(int));
+  STeeAccelerator *pAcc = &pCore->m_Accelerator;
+  th_clear(&pAcc->m_Heads, pCore->m_NumCharacters);
+  pAcc->m_QueryValid = false;
   // hook it up to our own things
   for (int i = 0; i < pCore->m_NumCharacters; ++i) {
-    STeeLink *pChar = &pCore->m_Accelerator.m_pTeeList[i];
+    STeeLink *pChar = &pAcc->m_pTeeList[i];
     if (pChar->m_Parent == -1)
-      pCore->m_Accelerator.m_pGrid->m_pTeeGrid[pChar->m_Tile] = i;
+      th_set_head(&pAcc->m_Heads, pChar->m_Tile, i);
   }
 }
 
 static void wc_accelerator_tick(SWorldCore *pCore) {
-  if (pCore->m_Accelerator.hash != pCore->m_Accelerator.m_pGrid->hash) {
-    wc_clear_grid(pCore);
-    pCore->m_Accelerator.m_pGrid->hash = pCore->m_Accelerator.hash;
-  }
-
+  STeeAccelerator *pAcc = &pCore->m_Accelerator;
   // set up accelerator
   for (int i = 0; i < pCore->m_NumCharacters; ++i) {
     SCharacterCore *pChar = &pCore->m_pCharacters[i];
-    STeeLink *pLink = &pCore->m_Accelerator.m_pTeeList[pChar->m_Id];
+    STeeLink *pLink = &pAcc->m_pTeeList[pChar->m_Id];
     int PrevIdx = pLink->m_Tile;
     int Idx = ((int)vgety(pChar->m_Pos) >> 5) * pChar->m_pCollision->m_MapData.width + ((int)vgetx(pChar->m_Pos) >> 5);
     if (PrevIdx == Idx)
       continue;
 
-    pLink = &pCore->m_Accelerator.m_pTeeList[pChar->m_Id];
-
     // remove ourselves from the previous index
     if (pLink->m_Parent >= 0) {
-      pCore->m_Accelerator.m_pTeeList[pLink->m_Parent].m_Child = pLink->m_Child;
+      pAcc->m_pTeeList[pLink->m_Parent].m_Child = pLink->m_Child;
     }
     if (pLink->m_Child >= 0) {
-      pCore->m_Accelerator.m_pTeeList[pLink->m_Child].m_Parent = pLink->m_Parent;
+      pAcc->m_pTeeList[pLink->m_Child].m_Parent = pLink->m_Parent;
     }
 
     // only update grid head if we were the head
-    if (pCore->m_Accelerator.m_pGrid->m_pTeeGrid[PrevIdx] == (int32_t)pLink->m_TeeId) {
-      if (pLink->m_Child >= 0)
-        pCore->m_Accelerator.m_pGrid->m_pTeeGrid[PrevIdx] = pLink->m_Child;
-      else
-        pCore->m_Accelerator.m_pGrid->m_pTeeGrid[PrevIdx] = -1;
-    }
-
+    if (th_head(&pAcc->m_Heads, PrevIdx) == (int32_t)pLink->m_TeeId)
+      th_set_head(&pAcc->m_Heads, PrevIdx, pLink->m_Child);
     if (pLink->m_Parent < 0 && pLink->m_Child < 0)
-      pCore->m_Accelerator.m_pGrid->m_pTeeGrid[PrevIdx] = -1;
+      th_set_head(&pAcc->m_Heads, PrevIdx, -1);
 
     // add ourselves onto the current index
     // move ourselves into the top of the list at our grid spot
     pLink->m_Tile = Idx;
     pLink->m_Parent = -1;
     pLink->m_Child = -1;
-    if (pCore->m_Accelerator.m_pGrid->m_pTeeGrid[Idx] >= 0) {
-      STeeLink *pTopLink = &pCore->m_Accelerator.m_pTeeList[pCore->m_Accelerator.m_pGrid->m_pTeeGrid[Idx]];
+    int TopTee = th_head(&pAcc->m_Heads, Idx);
+    if (TopTee >= 0) {
+      STeeLink *pTopLink = &pAcc->m_pTeeList[TopTee];
       if (pTopLink != pLink) {
         pLink->m_Child = pTopLink->m_TeeId;
         pTopLink->m_Parent = pLink->m_TeeId;
       }
     }
-    pCore->m_Accelerator.m_pGrid->m_pTeeGrid[Idx] = pChar->m_Id;
+    th_set_head(&pAcc->m_Heads, Idx, pChar->m_Id);
   }
 }
 
-void wc_tick(SWorldCore *pCore) {
-  ++pCore->m_GameTick;
-
-  // Tick entities
-
+static void wc_tick_entities(SWorldCore *pCore) {
   // Tick projectiles
   SEntity *pEntity = pCore->m_apFirstEntityTypes[WORLD_ENTTYPE_PROJECTILE];
   while (pEntity) {
@@ -2360,6 +2903,29 @@ void wc_tick(SWorldCore *pCore) {
     lsr_tick((SLaser *)pEntity);
     pEntity = pEntity->m_pNextTypeEntity;
   }
+}
+
+static void wc_remove_marked_entities(SWorldCore *pCore) {
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
+    SEntity *pEntity = pCore->m_apFirstEntityTypes[i];
+    while (pEntity) {
+      SEntity *pFree = pEntity;
+      pEntity = pEntity->m_pNextTypeEntity;
+      if (pFree->m_MarkedForDestroy) {
+        wc_remove_entity(pCore, pFree);
+        ep_free(&pCore->m_EntityPool, pFree);
+      }
+    }
+  }
+}
+
+void wc_tick(SWorldCore *pCore) {
+  ++pCore->m_GameTick;
+  // tees might have been moved by hand since the last tick
+  pCore->m_Accelerator.m_QueryValid = false;
+
+  // Tick entities
+  wc_tick_entities(pCore);
 
   for (int i = 0; i < pCore->m_NumCharacters; ++i)
     cc_do_pickup(&pCore->m_pCharacters[i]);
@@ -2367,35 +2933,627 @@ void wc_tick(SWorldCore *pCore) {
   // Tick characters
   if (pCore->m_NumCharacters > 1)
     wc_accelerator_tick(pCore);
-  for (int i = 0; i < pCore->m_NumCharacters; ++i)
-    cc_pre_tick(&pCore->m_pCharacters[i]);
-  for (int i = 0; i < pCore->m_NumCharacters; ++i)
-    cc_tick(&pCore->m_pCharacters[i]);
+  if (pCore->m_NumCharacters > 1) {
+    for (int i = 0; i < pCore->m_NumCharacters; ++i) {
+      SCharacterCore *pChar = &pCore->m_pCharacters[i];
+      cc_pre_tick_control(pChar, cc_pre_tick_input(pChar));
+    }
+    wc_pre_tick_hooks(pCore);
+  } else if (pCore->m_NumCharacters) {
+    cc_pre_tick(&pCore->m_pCharacters[0]);
+  }
+  for (int i = 0; i < pCore->m_NumCharacters; ++i) {
+    SCharacterCore *pChar = &pCore->m_pCharacters[i];
+    const mvec2 OldPos = pChar->m_Pos;
+    cc_tick(pChar);
+    // ninja, teleports and deaths move single tees around, the following tees still have to find them
+    if (memcmp(&OldPos, &pChar->m_Pos, sizeof(float) * 2))
+      ta_mark_moved(&pCore->m_Accelerator, i);
+  }
+  // from here on every tee moves
+  pCore->m_Accelerator.m_QueryValid = false;
 
   // Do tick deferred
   // funny thing no other entities than the character actually have a deferred
   // tick function lol
-  for (int i = 0; i < pCore->m_NumCharacters; ++i)
-    cc_world_tick_deferred(&pCore->m_pCharacters[i]);
+  if (pCore->m_NumCharacters > 1)
+    wc_move_characters(pCore);
+  else if (pCore->m_NumCharacters)
+    cc_world_tick_deferred(&pCore->m_pCharacters[0]);
 
   // Remove all entities that are marked for destroy
+  wc_remove_marked_entities(pCore);
+}
+
+// Ballistic fast-forward {{{
+
+// most ticks wc_tick_ballistic tries at once
+#define BALLISTIC_MAX_TICKS 32
+
+// A tee in this state gets through a tick without its hook, a jump, a shot or freeze changing its course. The input doesn't change
+// between the ticks of wc_tick_repeat, so it stays in this state.
+static bool cc_ballistic_state(const SCharacterCore *pCore) {
+  const SPlayerInput *pInput = &pCore->m_Input;
+  if (pCore->m_FreezeTime > 0 || pCore->m_DeepFrozen || pCore->m_TeleGunTeleport || pCore->m_ActiveWeapon == WEAPON_NINJA)
+    return false;
+  if (pCore->m_LiveFrozen && (pInput->m_Direction || pInput->m_Jump))
+    return false;
+  // no hook out, a held hook only stays retracted
+  if (pCore->m_HookState > HOOK_RETRACT_END || (pCore->m_HookState == HOOK_IDLE && pInput->m_Hook))
+    return false;
+  // a held jump was already used
+  if (pInput->m_Jump && !(pCore->m_Jumped & 1))
+    return false;
+  // never WillFire in cc_fire_weapon
+  return !(pInput->m_Fire & 1) && (pCore->m_PrevFire || !pInput->m_Fire);
+}
+
+// nothing to pick up, no ground to stand on and no death or speedup tiles
+static inline bool cc_ballistic_tile(const SCharacterCore *pCore) {
+  const int Idx = pCore->m_BlockIdx;
+  return !(pCore->m_pCollision->m_pTileInfos[Idx] & (INFO_PICKUPNEXT | INFO_CANGROUND)) &&
+         !(pCore->m_pCollision->m_pTileActions[Idx] & (1u << ACTION_HITKILL | 1u << ACTION_SPEEDUP));
+}
+
+// the rectangle move_box checks for solids, for a box around all of the moves
+static inline bool broad_move_check(const SCollision *pCollision, mvec2 Min, mvec2 Max) {
+  const mvec2 Offset = _mm_set1_ps(HALFPHYSICALSIZE + 1.0f);
+  const mvec2 MinAdj = _mm_sub_ps(Min, Offset);
+  const mvec2 MaxAdj = _mm_add_ps(Max, Offset);
+  return broad_rect_check(pCollision, BROAD_SOLID, (int)vgetx(MinAdj) >> 5, (int)vgety(MinAdj) >> 5, (int)vgetx(MaxAdj) >> 5,
+                          (int)vgety(MaxAdj) >> 5);
+}
+
+// Up to MaxTicks ticks of a single tee world without entities, as long as the tee is in cc_ballistic_state and flies through free air.
+// The ticks only run what can change the tee there, broad_indices_check and the broad check of move_box are done once for the box
+// around all of the ticks afterwards. If that finds a tile, the world goes back to where it was and a shorter stretch is tried.
+// Returns the number of ticks done.
+static int wc_tick_ballistic(SWorldCore *pCore, int MaxTicks) {
   for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
-    SEntity *pEntity = pCore->m_apFirstEntityTypes[i];
-    while (pEntity) {
-      SEntity *pFree = pEntity;
-      pEntity = pEntity->m_pNextTypeEntity;
-      if (pFree->m_MarkedForDestroy) {
-        wc_remove_entity(pCore, pFree);
-        free(pFree);
+    if (pCore->m_apFirstEntityTypes[i])
+      return 0;
+  }
+  SCharacterCore *pChar = &pCore->m_pCharacters[0];
+  if (!cc_ballistic_state(pChar) || !cc_ballistic_tile(pChar))
+    return 0;
+
+  const SCharacterCore Start = *pChar;
+  while (MaxTicks > 0) {
+    mvec2 TileMin = _mm_set1_ps(FLT_MAX), TileMax = _mm_set1_ps(-FLT_MAX);
+    mvec2 MoveMin = TileMin, MoveMax = TileMax;
+    bool Moved = false, Left = false;
+    int Ticks = 0;
+    for (; Ticks < MaxTicks && (!Ticks || cc_ballistic_tile(pChar)); ++Ticks) {
+      // cc_pre_tick, the tile rules out the ground check and the state a new hook or jump
+      cc_pre_tick_control(pChar, cc_pre_tick_input(pChar));
+      cc_pre_tick_hook(pChar);
+
+      // cc_tick without other tees and tiles
+      cc_tick_respawn_delay(pChar);
+      cc_tick_new_hook(pChar);
+      cc_handle_weapons(pChar);
+      cc_tick_postcore_reset(pChar);
+      cc_jump_rules(pChar);
+      TileMin = _mm_min_ps(TileMin, _mm_min_ps(pChar->m_PrevPos, pChar->m_Pos));
+      TileMax = _mm_max_ps(TileMax, _mm_max_ps(pChar->m_PrevPos, pChar->m_Pos));
+      cc_tick_end(pChar);
+
+      // cc_move with a move_box that doesn't hit anything
+      float OldVel, RampValue;
+      if (cc_outside_map(pChar, cc_move_ramp(pChar, &OldVel, &RampValue))) {
+        Left = true;
+        break;
       }
+      pChar->m_Vel = vvclamp(pChar->m_Vel, vec2_init(-MAX_VELOCITY, -MAX_VELOCITY), vec2_init(MAX_VELOCITY, MAX_VELOCITY));
+      mvec2 NewPos = pChar->m_Pos;
+      if (vsqlength(pChar->m_Vel) > 0.00001f * 0.00001f) {
+        NewPos = vvadd(pChar->m_Pos, pChar->m_Vel);
+        MoveMin = _mm_min_ps(MoveMin, _mm_min_ps(pChar->m_Pos, NewPos));
+        MoveMax = _mm_max_ps(MoveMax, _mm_max_ps(pChar->m_Pos, NewPos));
+        Moved = true;
+      }
+      cc_move_finish(pChar, NewPos, false, OldVel, RampValue);
+      cc_quantize(pChar);
+    }
+
+    if (!Left && !broad_indices_check(pChar->m_pCollision, TileMin, TileMax) &&
+        !(Moved && broad_move_check(pChar->m_pCollision, MoveMin, MoveMax))) {
+      pCore->m_GameTick += Ticks;
+      pCore->m_Accelerator.m_QueryValid = false;
+      return Ticks;
     }
+    // the ticks before the one that left the map are fine, a shorter box might miss the tile
+    *pChar = Start;
+    MaxTicks = Left ? Ticks : Ticks / 2;
   }
+  return 0;
 }
 
+// }}}
+
+// Resting fast-forward {{{
+
+// Besides entities a tick only reads the game tick for ninja, for the push between two tees on the same spot and in cc_freeze, everything
+// else follows from the tees, the switches and the inputs. So once a tick with no entities, no ninja and no such push leaves all of that
+// as it was, the following ticks with the same inputs do the same. The freeze and respawn timers may count down in such a tick, their
+// values only matter when they run out and, for the freeze timer, when cc_freeze gets to restart it.
+static bool wc_rest_candidate(const SWorldCore *pCore) {
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
+    if (pCore->m_apFirstEntityTypes[i])
+      return false;
+  }
+  // a tee at rest has no velocity left after move_box and cc_quantize
+  for (int i = 0; i < pCore->m_NumCharacters; ++i) {
+    const SCharacterCore *pChar = &pCore->m_pCharacters[i];
+    if (vgetx(pChar->m_Vel) != 0.f || vgety(pChar->m_Vel) != 0.f || pChar->m_ActiveWeapon == WEAPON_NINJA)
+      return false;
+  }
+  return true;
+}
+
+// The number of ticks after the one that started with pBefore and pSwitchesBefore that can be skipped, 0 unless that tick only counted
+// the timers down.
+static int wc_rest_ticks(const SWorldCore *pCore, const SCharacterCore *pBefore, const SSwitch *pSwitchesBefore) {
+  // the padding of the switches is never initialized
+  for (int i = 0; i < pCore->m_NumSwitches; ++i) {
+    const SSwitch *pA = &pSwitchesBefore[i], *pB = &pCore->m_pSwitches[i];
+    if (pA->m_Status != pB->m_Status || pA->m_Initial != pB->m_Initial || pA->m_EndTick != pB->m_EndTick || pA->m_Type != pB->m_Type ||
+        pA->m_LastUpdateTick != pB->m_LastUpdateTick)
+      return 0;
+  }
+  const size_t Offset = offsetof(SCharacterCore, m_pCollision);
+  int Ticks = INT_MAX;
+  for (int i = 0; i < pCore->m_NumCharacters; ++i) {
+    const SCharacterCore *pChar = &pCore->m_pCharacters[i];
+    SCharacterCore Expected;
+    memcpy(&Expected, &pBefore[i], sizeof(SCharacterCore));
+    if (Expected.m_FreezeTime > 0)
+      --Expected.m_FreezeTime;
+    if (Expected.m_RespawnDelay)
+      --Expected.m_RespawnDelay;
+    if (memcmp((const char *)&Expected + Offset, (const char *)pChar + Offset, sizeof(SCharacterCore) - Offset))
+      return 0;
+    // a timer that ran out in the tick changes what the next one does
+    if ((pBefore[i].m_RespawnDelay && !pChar->m_RespawnDelay) || (pBefore[i].m_FreezeTime > 0 && pChar->m_FreezeTime <= 0))
+      return 0;
+    // the kill flag of an input works again once the delay is over
+    if (pChar->m_RespawnDelay)
+      Ticks = imin(Ticks, pChar->m_RespawnDelay);
+    // cc_unfreeze at 1, and cc_freeze restarts the timer once the freeze started a second ago
+    if (pChar->m_FreezeTime > 0)
+      Ticks = imin(Ticks, imin(pChar->m_FreezeTime - 2, pChar->m_FreezeStart + GAME_TICK_SPEED - pCore->m_GameTick));
+    for (int j = 0; j < i; ++j) {
+      if (!memcmp(&pCore->m_pCharacters[j].m_Pos, &pChar->m_Pos, sizeof(float) * 2))
+        return 0;
+    }
+  }
+  return imax(Ticks, 0);
+}
+
+static void wc_rest_skip(SWorldCore *pCore, int Ticks) {
+  for (int i = 0; i < pCore->m_NumCharacters; ++i) {
+    SCharacterCore *pChar = &pCore->m_pCharacters[i];
+    if (pChar->m_FreezeTime > 0)
+      pChar->m_FreezeTime -= Ticks;
+    if (pChar->m_RespawnDelay)
+      pChar->m_RespawnDelay -= Ticks;
+  }
+  pCore->m_GameTick += Ticks;
+  pCore->m_Accelerator.m_QueryValid = false;
+}
+
+// }}}
+
+// Multi-tick stepping {{{
+
+static void wc_trace_tick(const SWorldCore *pCore, STickTrace *pTrace, int Tick) {
+  const int Num = pCore->m_NumCharacters;
+  const SCharacterCore *pChars = pCore->m_pCharacters;
+  const int Base = Tick * Num;
+  if (pTrace->m_pPosX)
+    for (int i = 0; i < Num; ++i)
+      pTrace->m_pPosX[Base + i] = vgetx(pChars[i].m_Pos);
+  if (pTrace->m_pPosY)
+    for (int i = 0; i < Num; ++i)
+      pTrace->m_pPosY[Base + i] = vgety(pChars[i].m_Pos);
+  if (pTrace->m_pVelX)
+    for (int i = 0; i < Num; ++i)
+      pTrace->m_pVelX[Base + i] = vgetx(pChars[i].m_Vel);
+  if (pTrace->m_pVelY)
+    for (int i = 0; i < Num; ++i)
+      pTrace->m_pVelY[Base + i] = vgety(pChars[i].m_Vel);
+  if (pTrace->m_pHookState)
+    for (int i = 0; i < Num; ++i)
+      pTrace->m_pHookState[Base + i] = pChars[i].m_HookState;
+}
+
+// A tick counts the respawn delay down before anything in it can kill, so only a tee that died in the tick has the full delay after it.
+// Kills through the input are caught before the tick.
+static int cc_tick_event(const SCharacterCore *pCore, bool KilledByInput) {
+  if (KilledByInput || pCore->m_RespawnDelay == RESPAWN_DELAY)
+    return TICK_STOP_DEATH;
+  if (pCore->m_FinishTick == pCore->m_pWorld->m_GameTick)
+    return TICK_STOP_FINISH;
+  return 0;
+}
+
+// the number of ticks from Tick on that get the same inputs as Tick
+static int same_inputs(const SPlayerInput *pInputs, int NumChars, int Tick, int NumTicks) {
+  if (!pInputs)
+    return NumTicks - Tick;
+  const SPlayerInput *pFirst = &pInputs[(size_t)Tick * NumChars];
+  int Num = 1;
+  while (Tick + Num < NumTicks && !memcmp(&pInputs[(size_t)(Tick + Num) * NumChars], pFirst, NumChars * sizeof(SPlayerInput)))
+    ++Num;
+  return Num;
+}
+
+int wc_tick_n(SWorldCore *pCore, const SPlayerInput *pInputs, int NumChars, int NumTicks, STickTrace *pTrace) {
+  if (pInputs && (NumChars < 0 || NumChars > pCore->m_NumCharacters)) {
+    printf("Error: Inputs for %d characters in a world with %d.\n", NumChars, pCore->m_NumCharacters);
+    return 0;
+  }
+  const int StopOn = pTrace ? pTrace->m_StopOn : 0;
+  const bool Record = pTrace && (pTrace->m_pPosX || pTrace->m_pPosY || pTrace->m_pVelX || pTrace->m_pVelY || pTrace->m_pHookState);
+  if (pTrace) {
+    pTrace->m_Stopped = 0;
+    pTrace->m_StoppedCharacter = -1;
+  }
+
+  // the tees and switches before a tick that might leave them at rest, allocated the first time one comes up
+  SCharacterCore *pRestChars = NULL;
+  SSwitch *pRestSwitches = NULL;
+  int Span = 1, Tick = 0;
+  while (Tick < NumTicks) {
+    // nothing happens in a ballistic stretch that could stop it, but the ticks in it aren't seen one by one
+    if (!pInputs && !Record && pCore->m_NumCharacters == 1) {
+      const int Done = wc_tick_ballistic(pCore, imin(Span, NumTicks - Tick));
+      if (Done) {
+        Tick += Done;
+        Span = imin(Span * 2, BALLISTIC_MAX_TICKS);
+        continue;
+      }
+      Span = 1;
+    }
+
+    bool Rest = Tick + 1 < NumTicks && wc_rest_candidate(pCore);
+    if (Rest && !pRestChars) {
+      pRestChars = malloc(pCore->m_NumCharacters * sizeof(SCharacterCore) + pCore->m_NumSwitches * sizeof(SSwitch));
+      pRestSwitches = pRestChars ? (SSwitch *)(pRestChars + pCore->m_NumCharacters) : NULL;
+      Rest = pRestChars;
+    }
+    if (Rest) {
+      memcpy(pRestChars, pCore->m_pCharacters, pCore->m_NumCharacters * sizeof(SCharacterCore));
+      if (pCore->m_NumSwitches)
+        memcpy(pRestSwitches, pCore->m_pSwitches, pCore->m_NumSwitches * sizeof(SSwitch));
+    }
+
+    int Killed = -1;
+    if (pInputs) {
+      const SPlayerInput *pTickInputs = &pInputs[(size_t)Tick * NumChars];
+      for (int i = 0; i < NumChars; ++i) {
+        SCharacterCore *pChar = &pCore->m_pCharacters[i];
+        const bool Alive = !pChar->m_RespawnDelay;
+        cc_on_input(pChar, &pTickInputs[i]);
+        if (Alive && pChar->m_RespawnDelay && Killed < 0)
+          Killed = i;
+      }
+    }
+    wc_tick(pCore);
+    if (Record)
+      wc_trace_tick(pCore, pTrace, Tick);
+    ++Tick;
+
+    if (StopOn) {
+      int Event = 0, i = 0;
+      for (; i < pCore->m_NumCharacters && !Event; ++i)
+        Event = cc_tick_event(&pCore->m_pCharacters[i], Killed == i) & StopOn;
+      if (Event) {
+        pTrace->m_Stopped = Event;
+        pTrace->m_StoppedCharacter = i - 1;
+        break;
+      }
+    }
+
+    // the ticks of a resting world only count the timers down, so nothing in them can stop it
+    if (Rest) {
+      const int Skip = imin(wc_rest_ticks(pCore, pRestChars, pRestSwitches), same_inputs(pInputs, NumChars, Tick - 1, NumTicks) - 1);
+      if (Skip > 0) {
+        wc_rest_skip(pCore, Skip);
+        for (int i = 0; Record && i < Skip; ++i)
+          wc_trace_tick(pCore, pTrace, Tick + i);
+        Tick += Skip;
+      }
+    }
+  }
+  free(pRestChars);
+  return Tick;
+}
+
+void wc_tick_repeat(SWorldCore *pCore, int NumTicks) { wc_tick_n(pCore, NULL, 0, NumTicks, NULL); }
+
+// }}}
+
+// Batched ticking {{{
+
+// Hot character state of up to BATCH_LANES single character worlds in SoA form. Only the pure arithmetic parts of the tick run on these
+// lanes, everything that touches the map or entities stays scalar on the SCharacterCore.
+#define BATCH_LANES 8
+
+typedef struct {
+  float m_aPosX[BATCH_LANES];
+  float m_aPosY[BATCH_LANES];
+  float m_aVelX[BATCH_LANES];
+  float m_aVelY[BATCH_LANES];
+  float m_aHookPosX[BATCH_LANES];
+  float m_aHookPosY[BATCH_LANES];
+  float m_aHookDirX[BATCH_LANES];
+  float m_aHookDirY[BATCH_LANES];
+  float m_aOldVel[BATCH_LANES];
+  float m_aRamp[BATCH_LANES];
+} SBatchLanes;
+
+static inline __m256 batch_saturate_add(__m256 Max, __m256 Current, __m256 Modifier) {
+  // same branches as saturate_add, both sides get evaluated and blended
+  const __m256 Min = _mm256_xor_ps(Max, _mm256_set1_ps(-0.0f));
+  const __m256 Sum = _mm256_add_ps(Current, Modifier);
+  __m256 Neg = _mm256_blendv_ps(Sum, Min, _mm256_cmp_ps(Sum, Min, _CMP_LT_OQ));
+  Neg = _mm256_blendv_ps(Neg, Current, _mm256_cmp_ps(Current, Min, _CMP_LT_OQ));
+  __m256 Pos = _mm256_blendv_ps(Sum, Max, _mm256_cmp_ps(Sum, Max, _CMP_GT_OQ));
+  Pos = _mm256_blendv_ps(Pos, Current, _mm256_cmp_ps(Current, Max, _CMP_GT_OQ));
+  return _mm256_blendv_ps(Pos, Neg, _mm256_cmp_ps(Modifier, _mm256_setzero_ps(), _CMP_LT_OQ));
+}
+
+static void batch_pre_tick_control(SWorldCore **ppWorlds, int Num, const int *pJumps) {
+  float aVelX[BATCH_LANES] = {0}, aVelY[BATCH_LANES] = {0};
+  float aGravity[BATCH_LANES] = {0}, aJumpVel[BATCH_LANES] = {0}, aJumpMask[BATCH_LANES] = {0};
+  float aMaxSpeed[BATCH_LANES] = {0}, aAccel[BATCH_LANES] = {0}, aFriction[BATCH_LANES] = {0};
+  float aDirection[BATCH_LANES] = {0};
+  for (int i = 0; i < Num; ++i) {
+    SCharacterCore *pCore = &ppWorlds[i]->m_pCharacters[0];
+    const STuningParams *pTuning = pCore->m_pTuning;
+    aVelX[i] = vgetx(pCore->m_Vel);
+    aVelY[i] = vgety(pCore->m_Vel);
+    aGravity[i] = pTuning->m_Gravity;
+    if (pJumps[i] != JUMP_NONE) {
+      aJumpMask[i] = -1.f; // only the sign bit matters for the blend
+      aJumpVel[i] = pJumps[i] == JUMP_GROUND ? -pTuning->m_GroundJumpImpulse : -pTuning->m_AirJumpImpulse;
+    }
+    aMaxSpeed[i] = pCore->m_Grounded ? pTuning->m_GroundControlSpeed : pTuning->m_AirControlSpeed;
+    aAccel[i] = pCore->m_Grounded ? pTuning->m_GroundControlAccel : pTuning->m_AirControlAccel;
+    aFriction[i] = pCore->m_Grounded ? pTuning->m_GroundFriction : pTuning->m_AirFriction;
+    aDirection[i] = (float)pCore->m_Input.m_Direction;
+  }
+
+  __m256 VelY = _mm256_add_ps(_mm256_loadu_ps(aVelY), _mm256_loadu_ps(aGravity));
+  VelY = _mm256_blendv_ps(VelY, _mm256_loadu_ps(aJumpVel), _mm256_loadu_ps(aJumpMask));
+
+  const __m256 VelX = _mm256_loadu_ps(aVelX);
+  const __m256 Direction = _mm256_loadu_ps(aDirection);
+  const __m256 Accel = _mm256_loadu_ps(aAccel);
+  const __m256 Modifier = _mm256_blendv_ps(Accel, _mm256_xor_ps(Accel, _mm256_set1_ps(-0.0f)), Direction);
+  const __m256 Controlled = batch_saturate_add(_mm256_loadu_ps(aMaxSpeed), VelX, Modifier);
+  const __m256 Idle = _mm256_cmp_ps(Direction, _mm256_setzero_ps(), _CMP_EQ_OQ);
+  _mm256_storeu_ps(aVelX, _mm256_blendv_ps(Controlled, _mm256_mul_ps(VelX, _mm256_loadu_ps(aFriction)), Idle));
+  _mm256_storeu_ps(aVelY, VelY);
+
+  for (int i = 0; i < Num; ++i)
+    ppWorlds[i]->m_pCharacters[0].m_Vel = vec2_init(aVelX[i], aVelY[i]);
+}
+
+// vvclamp to +-MAX_VELOCITY. written as compare and blend so a nan velocity (old speedups can produce those) ends up at the same bound as in the
+// scalar max/min pair, the compiler is free to swap the operands of the min/max intrinsics under fast math
+static inline __m256 batch_clamp_vel(__m256 Vel) {
+  const __m256 MaxVel = _mm256_set1_ps(MAX_VELOCITY);
+  const __m256 MinVel = _mm256_set1_ps(-MAX_VELOCITY);
+  Vel = _mm256_blendv_ps(MinVel, Vel, _mm256_cmp_ps(Vel, MinVel, _CMP_GT_OQ));
+  return _mm256_blendv_ps(MaxVel, Vel, _mm256_cmp_ps(Vel, MaxVel, _CMP_LT_OQ));
+}
+
+// first half of cc_move for all lanes. lanes that leave the map die right away and are marked in the returned mask
+static int batch_move_prepare(SWorldCore **ppWorlds, int Num, SBatchLanes *pLanes) {
+  float aLimitX[BATCH_LANES], aLimitY[BATCH_LANES];
+  for (int i = 0; i < BATCH_LANES; ++i) {
+    const SCharacterCore *pCore = &ppWorlds[i < Num ? i : 0]->m_pCharacters[0];
+    pLanes->m_aPosX[i] = vgetx(pCore->m_Pos);
+    pLanes->m_aPosY[i] = vgety(pCore->m_Pos);
+    pLanes->m_aVelX[i] = vgetx(pCore->m_Vel);
+    pLanes->m_aVelY[i] = vgety(pCore->m_Vel);
+    aLimitX[i] = (float)pCore->m_pCollision->m_MapData.width * 32.f - (HALFPHYSICALSIZE + 2);
+    aLimitY[i] = (float)pCore->m_pCollision->m_MapData.height * 32.f - (HALFPHYSICALSIZE + 2);
+  }
+
+  for (int i = 0; i < Num; ++i) {
+    SCharacterCore *pCore = &ppWorlds[i]->m_pCharacters[0];
+    // the length and the exp approximation stay scalar so they round exactly like cc_move does
+    pCore->m_VelMag = vlength(pCore->m_Vel);
+    pCore->m_VelRamp = cc_vel_ramp(pCore->m_pTuning, pCore->m_VelMag * 50);
+    pLanes->m_aRamp[i] = pCore->m_VelRamp;
+  }
+  for (int i = Num; i < BATCH_LANES; ++i)
+    pLanes->m_aRamp[i] = 1.f;
+
+  const __m256 VelX = _mm256_loadu_ps(pLanes->m_aVelX);
+  const __m256 VelY = _mm256_loadu_ps(pLanes->m_aVelY);
+  const __m256 OldVel = _mm256_mul_ps(VelX, _mm256_loadu_ps(pLanes->m_aRamp));
+  _mm256_storeu_ps(pLanes->m_aOldVel, OldVel);
+  const __m256 MaxNewPosX = _mm256_add_ps(_mm256_loadu_ps(pLanes->m_aPosX), OldVel);
+  const __m256 MaxNewPosY = _mm256_add_ps(_mm256_loadu_ps(pLanes->m_aPosY), VelY);
+  const __m256 MinPos = _mm256_set1_ps(HALFPHYSICALSIZE + 2);
+  const __m256 Out =
+      _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(MaxNewPosX, MinPos, _CMP_LT_OQ), _mm256_cmp_ps(MaxNewPosY, MinPos, _CMP_LT_OQ)),
+                   _mm256_or_ps(_mm256_cmp_ps(MaxNewPosX, _mm256_loadu_ps(aLimitX), _CMP_GE_OQ),
+                                _mm256_cmp_ps(MaxNewPosY, _mm256_loadu_ps(aLimitY), _CMP_GE_OQ)));
+
+  _mm256_storeu_ps(pLanes->m_aVelX, batch_clamp_vel(OldVel));
+  _mm256_storeu_ps(pLanes->m_aVelY, batch_clamp_vel(VelY));
+  return _mm256_movemask_ps(Out) & ((1 << Num) - 1);
+}
+
+static inline __m256 batch_round_pos(__m256 Pos) { return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_add_ps(Pos, _mm256_set1_ps(0.5f)))); }
+
+static inline __m256 batch_round_vel(__m256 Vel) {
+  const __m256 Half = _mm256_set1_ps(0.5f);
+  const __m256 Scale = _mm256_set1_ps(256.0f);
+  const __m256 Scaled = _mm256_mul_ps(Vel, Scale);
+  const __m256 Adjusted =
+      _mm256_blendv_ps(_mm256_sub_ps(Scaled, Half), _mm256_add_ps(Scaled, Half), _mm256_cmp_ps(Scaled, _mm256_setzero_ps(), _CMP_GE_OQ));
+  return _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvttps_epi32(Adjusted)), Scale);
+}
+
+// cc_quantize for all lanes
+static void batch_quantize(SWorldCore **ppWorlds, int Num, SBatchLanes *pLanes) {
+  for (int i = 0; i < BATCH_LANES; ++i) {
+    const SCharacterCore *pCore = &ppWorlds[i < Num ? i : 0]->m_pCharacters[0];
+    pLanes->m_aPosX[i] = vgetx(pCore->m_Pos);
+    pLanes->m_aPosY[i] = vgety(pCore->m_Pos);
+    pLanes->m_aVelX[i] = vgetx(pCore->m_Vel);
+    pLanes->m_aVelY[i] = vgety(pCore->m_Vel);
+    pLanes->m_aHookPosX[i] = vgetx(pCore->m_HookPos);
+    pLanes->m_aHookPosY[i] = vgety(pCore->m_HookPos);
+    pLanes->m_aHookDirX[i] = vgetx(pCore->m_HookDir);
+    pLanes->m_aHookDirY[i] = vgety(pCore->m_HookDir);
+  }
+
+  _mm256_storeu_ps(pLanes->m_aPosX, batch_round_pos(_mm256_loadu_ps(pLanes->m_aPosX)));
+  _mm256_storeu_ps(pLanes->m_aPosY, batch_round_pos(_mm256_loadu_ps(pLanes->m_aPosY)));
+  _mm256_storeu_ps(pLanes->m_aHookPosX, batch_round_pos(_mm256_loadu_ps(pLanes->m_aHookPosX)));
+  _mm256_storeu_ps(pLanes->m_aHookPosY, batch_round_pos(_mm256_loadu_ps(pLanes->m_aHookPosY)));
+  _mm256_storeu_ps(pLanes->m_aVelX, batch_round_vel(_mm256_loadu_ps(pLanes->m_aVelX)));
+  _mm256_storeu_ps(pLanes->m_aVelY, batch_round_vel(_mm256_loadu_ps(pLanes->m_aVelY)));
+  _mm256_storeu_ps(pLanes->m_aHookDirX, batch_round_vel(_mm256_loadu_ps(pLanes->m_aHookDirX)));
+  _mm256_storeu_ps(pLanes->m_aHookDirY, batch_round_vel(_mm256_loadu_ps(pLanes->m_aHookDirY)));
+
+  for (int i = 0; i < Num; ++i) {
+    SCharacterCore *pCore = &ppWorlds[i]->m_pCharacters[0];
+    pCore->m_Pos = vec2_init(pLanes->m_aPosX[i], pLanes->m_aPosY[i]);
+    pCore->m_Vel = vec2_init(pLanes->m_aVelX[i], pLanes->m_aVelY[i]);
+    pCore->m_HookPos = vec2_init(pLanes->m_aHookPosX[i], pLanes->m_aHookPosY[i]);
+    pCore->m_HookDir = vec2_init(pLanes->m_aHookDirX[i], pLanes->m_aHookDirY[i]);
+    cc_calc_indices(pCore);
+  }
+}
+
+// one wc_tick for up to BATCH_LANES worlds with exactly one character each
+// the worlds of a batch may run on different maps, this picks the lanes of Pending on the map of lane First so they run together
+static int batch_map_lanes(SWorldCore **ppWorlds, int Num, int Pending, int First) {
+  int MapMask = 0;
+  for (int i = First; i < Num; ++i)
+    if (Pending & (1 << i) && ppWorlds[i]->m_pCollision == ppWorlds[First]->m_pCollision)
+      MapMask |= 1 << i;
+  return MapMask;
+}
+
+static void wc_tick_lanes(SWorldCore **ppWorlds, int Num) {
+  SBatchLanes Lanes;
+  int aJumps[BATCH_LANES];
+
+  for (int i = 0; i < Num; ++i) {
+    SWorldCore *pWorld = ppWorlds[i];
+    ++pWorld->m_GameTick;
+    wc_tick_entities(pWorld);
+    cc_do_pickup(&pWorld->m_pCharacters[0]);
+    aJumps[i] = cc_pre_tick_input(&pWorld->m_pCharacters[0]);
+  }
+
+  batch_pre_tick_control(ppWorlds, Num, aJumps);
+
+  // the hooks of single tee worlds never grab a tee, the flying ones only need their tile hits
+  SHookRayLanes Rays;
+  int Flying = 0;
+  for (int i = 0; i < Num; ++i) {
+    SCharacterCore *pCore = &ppWorlds[i]->m_pCharacters[0];
+    if (pCore->m_HookState != HOOK_FLYING) {
+      cc_pre_tick_hook(pCore);
+      continue;
+    }
+    const mvec2 NewPos = cc_hook_target(pCore);
+    Rays.m_aFromX[i] = vgetx(pCore->m_HookPos);
+    Rays.m_aFromY[i] = vgety(pCore->m_HookPos);
+    Rays.m_aToX[i] = vgetx(NewPos);
+    Rays.m_aToY[i] = vgety(NewPos);
+    Flying |= 1 << i;
+  }
+  for (int Pending = Flying, i = 0; Pending; ++i) {
+    if (!(Pending & (1 << i)))
+      continue;
+    const int MapMask = batch_map_lanes(ppWorlds, Num, Pending, i);
+    intersect_line_tele_hook_x8(ppWorlds[i]->m_pCollision, &Rays, MapMask);
+    Pending &= ~MapMask;
+  }
+  for (int i = 0; i < Num; ++i) {
+    SCharacterCore *pCore = &ppWorlds[i]->m_pCharacters[0];
+    if (Flying & (1 << i)) {
+      cc_hook_flying_finish(pCore, vec2_init(Rays.m_aOutX[i], Rays.m_aOutY[i]), Rays.m_aHit[i], Rays.m_aTeleNr[i]);
+      cc_hook_grabbed(pCore);
+    }
+    cc_tick(pCore);
+  }
+
+  const int DeadMask = batch_move_prepare(ppWorlds, Num, &Lanes);
+  SMoveBoxLanes Moves;
+  for (int i = 0; i < BATCH_LANES; ++i) {
+    const SCharacterCore *pCore = &ppWorlds[i < Num ? i : 0]->m_pCharacters[0];
+    Moves.m_aPosX[i] = Lanes.m_aPosX[i];
+    Moves.m_aPosY[i] = Lanes.m_aPosY[i];
+    Moves.m_aVelX[i] = Lanes.m_aVelX[i];
+    Moves.m_aVelY[i] = Lanes.m_aVelY[i];
+    Moves.m_aElasticityX[i] = pCore->m_pTuning->m_GroundElasticityX;
+    Moves.m_aElasticityY[i] = pCore->m_pTuning->m_GroundElasticityY;
+    Moves.m_aGrounded[i] = false;
+  }
+  for (int Pending = ~DeadMask & ((1 << Num) - 1), i = 0; Pending; ++i) {
+    if (!(Pending & (1 << i)))
+      continue;
+    const int MapMask = batch_map_lanes(ppWorlds, Num, Pending, i);
+    move_box_x8(ppWorlds[i]->m_pCollision, &Moves, MapMask);
+    Pending &= ~MapMask;
+  }
+  for (int i = 0; i < Num; ++i) {
+    SCharacterCore *pCore = &ppWorlds[i]->m_pCharacters[0];
+    if (DeadMask & (1 << i)) {
+      cc_die(pCore);
+      continue;
+    }
+    pCore->m_Vel = vec2_init(Moves.m_aVelX[i], Moves.m_aVelY[i]);
+    cc_move_finish(pCore, vec2_init(Moves.m_aPosX[i], Moves.m_aPosY[i]), Moves.m_aGrounded[i], Lanes.m_aOldVel[i], Lanes.m_aRamp[i]);
+  }
+
+  batch_quantize(ppWorlds, Num, &Lanes);
+
+  for (int i = 0; i < Num; ++i)
+    wc_remove_marked_entities(ppWorlds[i]);
+}
+
+void wc_tick_batch(SWorldCore **ppWorlds, int Num) {
+  SWorldCore *apLanes[BATCH_LANES];
+  int NumLanes = 0;
+  for (int i = 0; i < Num; ++i) {
+    // only single character worlds map onto lanes, everything else takes the normal path
+    if (ppWorlds[i]->m_NumCharacters != 1) {
+      wc_tick(ppWorlds[i]);
+      continue;
+    }
+    apLanes[NumLanes++] = ppWorlds[i];
+    if (NumLanes == BATCH_LANES) {
+      wc_tick_lanes(apLanes, NumLanes);
+      NumLanes = 0;
+    }
+  }
+  if (NumLanes)
+    wc_tick_lanes(apLanes, NumLanes);
+}
+
+// }}}
+
 SCharacterCore *wc_add_character(SWorldCore *pWorld, int Num) {
   if (Num <= 0) {
     return NULL; // nothing to add
   }
+  if (pWorld->m_pFlatBlock) {
+    printf("Error: can't add characters to a flat world.\n");
+    return NULL;
+  }
 
   const int OldSize = pWorld->m_NumCharacters;
   const int NewSize = OldSize + Num;
@@ -2444,7 +3602,7 @@ SCharacterCore *wc_add_character(SWorldCore *pWorld, int Num) {
     // Add to grid list structure
     STeeLink *pLink = &pWorld->m_Accelerator.m_pTeeList[pChar->m_Id];
     int Idx = ((int)vgety(pChar->m_Pos) >> 5) * pChar->m_pCollision->m_MapData.width + ((int)vgetx(pChar->m_Pos) >> 5);
-    int TopTee = pWorld->m_Accelerator.m_pGrid->m_pTeeGrid[Idx];
+    int TopTee = th_head(&pWorld->m_Accelerator.m_Heads, Idx);
 
     if (TopTee >= 0) {
       STeeLink *pTopLink = &pWorld->m_Accelerator.m_pTeeList[TopTee];
@@ -2454,7 +3612,7 @@ SCharacterCore *wc_add_character(SWorldCore *pWorld, int Num) {
       pLink->m_Child = -1;
     }
 
-    pWorld->m_Accelerator.m_pGrid->m_pTeeGrid[Idx] = pChar->m_Id;
+    th_set_head(&pWorld->m_Accelerator.m_Heads, Idx, pChar->m_Id);
     pLink->m_Parent = -1;
     pLink->m_Tile = Idx;
   }
@@ -2469,6 +3627,10 @@ SCharacterCore *wc_add_character(SWorldCore *pWorld, int Num) {
 void wc_remove_character(SWorldCore *pWorld, int CharacterId) {
   if (!pWorld || CharacterId < 0 || CharacterId >= pWorld->m_NumCharacters)
     return;
+  if (pWorld->m_pFlatBlock) {
+    printf("Error: can't remove characters from a flat world.\n");
+    return;
+  }
 
   wc_clear_grid(pWorld);
   SCharacterCore *pChars = pWorld->m_pCharacters;
@@ -2493,36 +3655,111 @@ void wc_remove_character(SWorldCore *pWorld, int CharacterId) {
   }
 }
 
-void wc_create_explosion(SWorldCore *pWorld, mvec2 Pos, int Owner) {
 #define EXPLOSION_RADIUS 135.0f
 #define EXPLOSION_INNER_RADIUS 48.0f
-  for (int i = 0; i < pWorld->m_NumCharacters; i++) {
-    SCharacterCore *pChr = &pWorld->m_pCharacters[i];
-    mvec2 Diff = vvsub(pChr->m_Pos, Pos);
-    float l = vlength(Diff);
-    if (l >= EXPLOSION_RADIUS + PHYSICALSIZE)
-      continue;
-    mvec2 ForceDir = vec2_init(0, 1);
-    if (l)
-      ForceDir = vnormalize_nomask(Diff);
-    l = 1 - fclamp((l - EXPLOSION_INNER_RADIUS) / (EXPLOSION_RADIUS - EXPLOSION_INNER_RADIUS), 0.0f, 1.0f);
-    float Strength;
-    if (Owner != -1)
-      Strength = pWorld->m_pCharacters[Owner].m_pTuning->m_ExplosionStrength;
-    else
-      Strength = pWorld->m_pTunings[0].m_ExplosionStrength;
 
-    float Dmg = Strength * l;
-    if (!(int)Dmg)
-      continue;
+static void wc_explosion_hit(SWorldCore *pWorld, SCharacterCore *pChr, mvec2 Pos, int Owner) {
+  mvec2 Diff = vvsub(pChr->m_Pos, Pos);
+  float l = vlength(Diff);
+  if (l >= EXPLOSION_RADIUS + PHYSICALSIZE)
+    return;
+  mvec2 ForceDir = vec2_init(0, 1);
+  if (l)
+    ForceDir = vnormalize_nomask(Diff);
+  l = 1 - fclamp((l - EXPLOSION_INNER_RADIUS) / (EXPLOSION_RADIUS - EXPLOSION_INNER_RADIUS), 0.0f, 1.0f);
+  float Strength;
+  if (Owner != -1)
+    Strength = pWorld->m_pCharacters[Owner].m_pTuning->m_ExplosionStrength;
+  else
+    Strength = pWorld->m_pTunings[0].m_ExplosionStrength;
+
+  float Dmg = Strength * l;
+  if (!(int)Dmg)
+    return;
+
+  pChr->m_HitNum += Dmg;
+  // explosions without an owner always hit
+  if (Owner == -1 || !pWorld->m_pCharacters[Owner].m_GrenadeHitDisabled || Owner == pChr->m_Id) {
+    if (pChr->m_Solo && Owner != pChr->m_Id)
+      return;
+    cc_take_damage(pChr, vfmul(ForceDir, Dmg * 2));
+  }
+}
+
+void wc_create_explosion(SWorldCore *pWorld, mvec2 Pos, int Owner) {
+  // every tee is handled on its own, so the order they are visited in doesn't matter
+  const float Reach = EXPLOSION_RADIUS + PHYSICALSIZE + 1.0f;
+  STeeQuery Query;
+  if (tq_init(&Query, pWorld, vgetx(Pos) - Reach, vgety(Pos) - Reach, vgetx(Pos) + Reach, vgety(Pos) + Reach)) {
+    for (int Id = tq_next(&Query); Id >= 0; Id = tq_next(&Query))
+      wc_explosion_hit(pWorld, &pWorld->m_pCharacters[Id], Pos, Owner);
+    return;
+  }
+  for (int i = 0; i < pWorld->m_NumCharacters; i++)
+    wc_explosion_hit(pWorld, &pWorld->m_pCharacters[i], Pos, Owner);
+}
+
+static inline void wc_intersect_test(SCharacterCore *pEntity, mvec2 Pos0, mvec2 Pos1, float Radius, mvec2 *pNewPos, float *pClosestLen,
+                                     SCharacterCore **ppClosest) {
+  mvec2 IntersectPos;
+  if (closest_point_on_line(Pos0, Pos1, pEntity->m_Pos, &IntersectPos)) {
+    float Len = vdistance(pEntity->m_Pos, IntersectPos);
+    if (Len < PHYSICALSIZE + Radius) {
+      Len = vdistance(Pos0, IntersectPos);
+      // ties go to the lower index no matter in which order the tees are visited
+      if (Len < *pClosestLen || (Len == *pClosestLen && *ppClosest && pEntity < *ppClosest)) {
+        *pNewPos = IntersectPos;
+        *pClosestLen = Len;
+        *ppClosest = pEntity;
+      }
+    }
+  }
+}
 
-    pChr->m_HitNum += Dmg;
-    if (!pWorld->m_pCharacters[Owner].m_GrenadeHitDisabled || Owner == pChr->m_Id) {
-      if (pChr->m_Solo && Owner != pChr->m_Id)
+// only visits the tees whose tile the segment (grown by the hit distance) sweeps over. returns false if the tiles can't be used
+static bool wc_intersect_character_grid(SWorldCore *pWorld, mvec2 Pos0, mvec2 Pos1, float Radius, mvec2 *pNewPos, const SCharacterCore *pNotThis,
+                                        float *pClosestLen, SCharacterCore **ppClosest) {
+  const int Width = pWorld->m_pCollision->m_MapData.width;
+  // one unit of slack so rounding can't drop a tee that is right at the edge
+  const float Reach = PHYSICALSIZE + Radius + 1.0f;
+  const float X0 = vgetx(Pos0), Y0 = vgety(Pos0);
+  const float Dx = vgetx(Pos1) - X0, Dy = vgety(Pos1) - Y0;
+  const float MinX = fminf(X0, X0 + Dx) - Reach, MaxX = fmaxf(X0, X0 + Dx) + Reach;
+  const float MinY = fminf(Y0, Y0 + Dy) - Reach, MaxY = fmaxf(Y0, Y0 + Dy) + Reach;
+  if (!ta_query_ready(pWorld, MinX, MinY, MaxX, MaxY))
+    return false;
+
+  const STeeAccelerator *pAcc = &pWorld->m_Accelerator;
+  for (int y = (int)MinY >> 5; y <= (int)MaxY >> 5; ++y) {
+    // the part of the segment that can touch a tee in this row
+    const float Lo = y * 32.0f - Reach, Hi = y * 32.0f + 32.0f + Reach;
+    float T0 = 0.0f, T1 = 1.0f;
+    if (Dy != 0.0f) {
+      float Ta = (Lo - Y0) / Dy, Tb = (Hi - Y0) / Dy;
+      T0 = fmaxf(fminf(Ta, Tb), 0.0f);
+      T1 = fminf(fmaxf(Ta, Tb), 1.0f);
+      if (T0 > T1)
         continue;
-      cc_take_damage(pChr, vfmul(ForceDir, Dmg * 2));
+    } else if (Y0 < Lo || Y0 > Hi) {
+      continue;
+    }
+    const float Xa = X0 + Dx * T0, Xb = X0 + Dx * T1;
+    const int StartX = imax((int)(fminf(Xa, Xb) - Reach) >> 5, 0);
+    const int EndX = imin((int)(fmaxf(Xa, Xb) + Reach) >> 5, Width - 1);
+    for (int x = StartX; x <= EndX; ++x) {
+      for (int Id = th_head(&pAcc->m_Query, y * Width + x); Id >= 0; Id = pAcc->m_pQueryNext[Id]) {
+        SCharacterCore *pEntity = &pWorld->m_pCharacters[Id];
+        if (pEntity != pNotThis && !ta_moved(pAcc, Id))
+          wc_intersect_test(pEntity, Pos0, Pos1, Radius, pNewPos, pClosestLen, ppClosest);
+      }
     }
   }
+  for (int i = 0; i < pAcc->m_NumMoved; ++i) {
+    SCharacterCore *pEntity = &pWorld->m_pCharacters[pAcc->m_aMoved[i]];
+    if (pEntity != pNotThis)
+      wc_intersect_test(pEntity, Pos0, Pos1, Radius, pNewPos, pClosestLen, ppClosest);
+  }
+  return true;
 }
 
 SCharacterCore *wc_intersect_character(SWorldCore *pWorld, mvec2 Pos0, mvec2 Pos1, float Radius, mvec2 *pNewPos, const SCharacterCore *pNotThis,
@@ -2530,39 +3767,34 @@ SCharacterCore *wc_intersect_character(SWorldCore *pWorld, mvec2 Pos0, mvec2 Pos
   float ClosestLen = vdistance(Pos0, Pos1) * 100.0f;
   SCharacterCore *pClosest = NULL;
 
-  for (int i = 0; i < pWorld->m_NumCharacters; ++i) {
-    SCharacterCore *pEntity = &pWorld->m_pCharacters[i];
-    if (pEntity == pNotThis)
-      continue;
+  if (pThisOnly) {
+    if (pThisOnly != pNotThis)
+      wc_intersect_test((SCharacterCore *)pThisOnly, Pos0, Pos1, Radius, pNewPos, &ClosestLen, &pClosest);
+    return pClosest;
+  }
 
-    if (pThisOnly && pEntity != pThisOnly)
-      continue;
+  if (wc_intersect_character_grid(pWorld, Pos0, Pos1, Radius, pNewPos, pNotThis, &ClosestLen, &pClosest))
+    return pClosest;
 
-    mvec2 IntersectPos;
-    if (closest_point_on_line(Pos0, Pos1, pEntity->m_Pos, &IntersectPos)) {
-      float Len = vdistance(pEntity->m_Pos, IntersectPos);
-      if (Len < PHYSICALSIZE + Radius) {
-        Len = vdistance(Pos0, IntersectPos);
-        if (Len < ClosestLen) {
-          *pNewPos = IntersectPos;
-          ClosestLen = Len;
-          pClosest = pEntity;
-        }
-      }
-    }
+  for (int i = 0; i < pWorld->m_NumCharacters; ++i) {
+    SCharacterCore *pEntity = &pWorld->m_pCharacters[i];
+    if (pEntity != pNotThis)
+      wc_intersect_test(pEntity, Pos0, Pos1, Radius, pNewPos, &ClosestLen, &pClosest);
   }
 
   return pClosest;
 }
 
-void wc_insert_entity(SWorldCore *pWorld, SEntity *pEnt) {
-  pEnt->m_pWorld = pWorld;
-  pEnt->m_pCollision = pWorld->m_pCollision;
-  if (pWorld->m_apFirstEntityTypes[pEnt->m_ObjType])
-    pWorld->m_apFirstEntityTypes[pEnt->m_ObjType]->m_pPrevTypeEntity = pEnt;
-  pEnt->m_pNextTypeEntity = pWorld->m_apFirstEntityTypes[pEnt->m_ObjType];
-  pEnt->m_pPrevTypeEntity = NULL;
-  pWorld->m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+SEntity *wc_new_entity(SWorldCore *pWorld) { return ep_alloc(&pWorld->m_EntityPool); }
+
+bool wc_insert_entity(SWorldCore *pWorld, SEntity *pEnt) {
+  // the pool frees every entity of the world, anything it didn't hand out would end up in its free list
+  if (!ep_owns(&pWorld->m_EntityPool, pEnt)) {
+    printf("Error: Entity wasn't allocated with wc_new_entity of this world.\n");
+    return false;
+  }
+  wc_link_entity(pWorld, pEnt);
+  return true;
 }
 
 void wc_remove_entity(SWorldCore *pWorld, SEntity *pEnt) {
@@ -2583,48 +3815,212 @@ void wc_remove_entity(SWorldCore *pWorld, SEntity *pEnt) {
   pEnt->m_pPrevTypeEntity = NULL;
 }
 
-void wc_copy_world(SWorldCore *__restrict__ pTo, SWorldCore *__restrict__ pFrom) {
-  pTo->m_GameTick = pFrom->m_GameTick;
-  pTo->m_pCollision = pFrom->m_pCollision;
-  pTo->m_pConfig = pFrom->m_pConfig;
-  pTo->m_pTunings = pFrom->m_pTunings;
-  pTo->m_Accelerator.m_pGrid = pFrom->m_Accelerator.m_pGrid;
-  // TODO: fix, this is very bad:
-  pTo->m_Accelerator.hash = ((uint64_t)rand() << 32) | rand();
-
+static void wc_copy_entities(SWorldCore *__restrict__ pTo, SWorldCore *__restrict__ pFrom) {
   // delete old entities
-  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
-    SEntity *pEntity = pTo->m_apFirstEntityTypes[i];
-    while (pEntity) {
-      SEntity *pFree = pEntity;
-      pEntity = pEntity->m_pNextTypeEntity;
-      free(pFree);
-    }
+  ep_reset(&pTo->m_EntityPool);
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i)
     pTo->m_apFirstEntityTypes[i] = NULL;
-  }
 
   // insert new entities
 #pragma clang loop unroll(full)
   for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
     SEntity *pEntity = pFrom->m_apFirstEntityTypes[i];
     while (pEntity) {
+      SEntity *pNew = wc_new_entity(pTo);
+      if (!pNew) {
+        printf("Error: Failed to allocate the entities of a world copy.\n");
+        return;
+      }
       switch (i) {
-      case WORLD_ENTTYPE_PROJECTILE: {
-        SEntity *pNew = malloc(sizeof(SProjectile));
+      case WORLD_ENTTYPE_PROJECTILE:
         memcpy(pNew, pEntity, sizeof(SProjectile));
-        wc_insert_entity(pTo, pNew);
         break;
-      }
-      case WORLD_ENTTYPE_LASER: {
-        SEntity *pNew = malloc(sizeof(SLaser));
+      case WORLD_ENTTYPE_LASER:
         memcpy(pNew, pEntity, sizeof(SLaser));
-        wc_insert_entity(pTo, pNew);
         break;
       }
-      }
+      wc_link_entity(pTo, pNew);
+      pEntity = pEntity->m_pNextTypeEntity;
+    }
+  }
+}
+
+// Flat worlds {{{
+
+static inline int wc_flat_num_chunks(int MaxEntities) { return (MaxEntities + ENTITY_CHUNK_SIZE - 1) / ENTITY_CHUNK_SIZE; }
+
+static size_t wc_flat_size(int NumChunks, int NumCharacters, int NumSwitches) {
+  return (size_t)NumChunks * sizeof(SEntityChunk) + (size_t)NumCharacters * (sizeof(SCharacterCore) + sizeof(STeeLink)) +
+         (size_t)NumSwitches * sizeof(SSwitch);
+}
+
+// points the world arrays and the fixed entity chunks into the block. layout: chunks, characters, tee links, switches
+static void wc_flat_assign(SWorldCore *pWorld, char *pBlock, int NumChunks) {
+  SEntityChunk *pChunks = (SEntityChunk *)pBlock;
+  for (int i = 0; i < NumChunks; ++i)
+    pChunks[i].m_pNext = i + 1 < NumChunks ? &pChunks[i + 1] : NULL;
+  memset(&pWorld->m_EntityPool, 0, sizeof(SEntityPool));
+  pWorld->m_EntityPool.m_pFirstChunk = NumChunks ? pChunks : NULL;
+  pWorld->m_EntityPool.m_NumFixedChunks = NumChunks;
+  ep_reset(&pWorld->m_EntityPool);
+
+  pBlock += (size_t)NumChunks * sizeof(SEntityChunk);
+  pWorld->m_pCharacters = (SCharacterCore *)pBlock;
+  pBlock += (size_t)pWorld->m_NumCharacters * sizeof(SCharacterCore);
+  pWorld->m_Accelerator.m_pTeeList = (STeeLink *)pBlock;
+  pBlock += (size_t)pWorld->m_NumCharacters * sizeof(STeeLink);
+  pWorld->m_pSwitches = pWorld->m_NumSwitches ? (SSwitch *)pBlock : NULL;
+  pWorld->m_pFlatBlock = pChunks;
+}
+
+bool wc_flatten(SWorldCore *pWorld, int MaxEntities) {
+  if (pWorld->m_pFlatBlock)
+    return true;
+
+  // room for the entities the world already has too, so moving them over never allocates
+  int NumEntities = 0;
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
+    for (const SEntity *pEntity = pWorld->m_apFirstEntityTypes[i]; pEntity; pEntity = pEntity->m_pNextTypeEntity)
+      ++NumEntities;
+  }
+  const int NumChunks = wc_flat_num_chunks(imax(MaxEntities, NumEntities));
+  const size_t Size = wc_flat_size(NumChunks, pWorld->m_NumCharacters, pWorld->m_NumSwitches);
+  char *pBlock = _mm_malloc(Size ? Size : 64, 64);
+  if (!pBlock) {
+    printf("Error: failed to allocate flat world block.\n");
+    return false;
+  }
+
+  SCharacterCore *pOldCharacters = pWorld->m_pCharacters;
+  STeeLink *pOldLinks = pWorld->m_Accelerator.m_pTeeList;
+  SSwitch *pOldSwitches = pWorld->m_pSwitches;
+  SEntityPool OldPool = pWorld->m_EntityPool;
+  SEntity *apOldEntities[NUM_WORLD_ENTTYPES];
+  memcpy(apOldEntities, pWorld->m_apFirstEntityTypes, sizeof(apOldEntities));
+
+  wc_flat_assign(pWorld, pBlock, NumChunks);
+  pWorld->m_FlatSize = Size;
+  if (pWorld->m_NumCharacters) {
+    memcpy(pWorld->m_pCharacters, pOldCharacters, pWorld->m_NumCharacters * sizeof(SCharacterCore));
+    memcpy(pWorld->m_Accelerator.m_pTeeList, pOldLinks, pWorld->m_NumCharacters * sizeof(STeeLink));
+  }
+  if (pWorld->m_NumSwitches)
+    memcpy(pWorld->m_pSwitches, pOldSwitches, pWorld->m_NumSwitches * sizeof(SSwitch));
+  free(pOldCharacters);
+  free(pOldLinks);
+  free(pOldSwitches);
+
+  // move the entities over, back to front so the order stays the same
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
+    SEntity *pEntity = apOldEntities[i];
+    while (pEntity && pEntity->m_pNextTypeEntity)
       pEntity = pEntity->m_pNextTypeEntity;
+    pWorld->m_apFirstEntityTypes[i] = NULL;
+    while (pEntity) {
+      SEntity *pNew = wc_new_entity(pWorld);
+      memcpy(pNew, pEntity, sizeof(SEntitySlot));
+      wc_link_entity(pWorld, pNew);
+      pEntity = pEntity->m_pPrevTypeEntity;
     }
   }
+  pWorld->m_pNextTraverseEntity = NULL;
+  ep_destroy(&OldPool);
+  return true;
+}
+
+#define REBASE(Type, p) ((p) ? (Type *)((uintptr_t)(p) + Delta) : NULL)
+
+// gives pTo a block with the same layout as the one of pFrom. only allocates if the layouts differ, returns false with pTo emptied if
+// that fails
+static bool wc_flat_prepare(SWorldCore *__restrict__ pTo, SWorldCore *__restrict__ pFrom) {
+  const int NumChunks = pFrom->m_EntityPool.m_NumFixedChunks;
+  if (pTo->m_pFlatBlock && pTo->m_FlatSize == pFrom->m_FlatSize && pTo->m_EntityPool.m_NumFixedChunks == NumChunks &&
+      pTo->m_NumCharacters == pFrom->m_NumCharacters && pTo->m_NumSwitches == pFrom->m_NumSwitches)
+    return true;
+  wc_free(pTo);
+  char *pBlock = _mm_malloc(pFrom->m_FlatSize ? pFrom->m_FlatSize : 64, 64);
+  if (!pBlock) {
+    printf("Error: failed to allocate flat world block.\n");
+    return false;
+  }
+  pTo->m_NumCharacters = pFrom->m_NumCharacters;
+  pTo->m_NumSwitches = pFrom->m_NumSwitches;
+  pTo->m_FlatSize = pFrom->m_FlatSize;
+  wc_flat_assign(pTo, pBlock, NumChunks);
+  return true;
+}
+
+static void wc_copy_flat(SWorldCore *__restrict__ pTo, SWorldCore *__restrict__ pFrom) {
+  const int NumChunks = pFrom->m_EntityPool.m_NumFixedChunks;
+
+  // chunks that pTo allocated outside of its block hang off its last fixed chunk and have to stay there
+  SEntityChunk *pSpill = NumChunks ? ((SEntityChunk *)pTo->m_pFlatBlock)[NumChunks - 1].m_pNext : pTo->m_EntityPool.m_pFirstChunk;
+  memcpy(pTo->m_pFlatBlock, pFrom->m_pFlatBlock, pFrom->m_FlatSize);
+  const uintptr_t Delta = (uintptr_t)pTo->m_pFlatBlock - (uintptr_t)pFrom->m_pFlatBlock;
+
+  SEntityChunk *pChunks = (SEntityChunk *)pTo->m_pFlatBlock;
+  for (int i = 0; i < NumChunks; ++i)
+    pChunks[i].m_pNext = i + 1 < NumChunks ? &pChunks[i + 1] : pSpill;
+  for (int i = 0; i < pTo->m_NumCharacters; ++i) {
+    pTo->m_pCharacters[i].m_pCollision = pTo->m_pCollision;
+    pTo->m_pCharacters[i].m_pWorld = pTo;
+  }
+
+  if (ep_spilled(&pFrom->m_EntityPool)) {
+    wc_copy_entities(pTo, pFrom);
+    return;
+  }
+
+  SEntityPool *pPool = &pTo->m_EntityPool;
+  pPool->m_pChunk = REBASE(SEntityChunk, pFrom->m_EntityPool.m_pChunk);
+  pPool->m_ChunkIdx = pFrom->m_EntityPool.m_ChunkIdx;
+  pPool->m_NumBumped = pFrom->m_EntityPool.m_NumBumped;
+  pPool->m_pFree = REBASE(SEntitySlot, pFrom->m_EntityPool.m_pFree);
+  for (SEntitySlot *pSlot = pPool->m_pFree; pSlot; pSlot = pSlot->m_pNextFree)
+    pSlot->m_pNextFree = REBASE(SEntitySlot, pSlot->m_pNextFree);
+
+  // relink in reverse so the entities end up in the same order as with wc_copy_entities
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
+    SEntity *pEntity = REBASE(SEntity, pFrom->m_apFirstEntityTypes[i]);
+    SEntity *pHead = NULL;
+    while (pEntity) {
+      SEntity *pNext = REBASE(SEntity, pEntity->m_pNextTypeEntity);
+      pEntity->m_pWorld = pTo;
+      pEntity->m_pCollision = pTo->m_pCollision;
+      pEntity->m_pPrevTypeEntity = NULL;
+      pEntity->m_pNextTypeEntity = pHead;
+      if (pHead)
+        pHead->m_pPrevTypeEntity = pEntity;
+      pHead = pEntity;
+      pEntity = pNext;
+    }
+    pTo->m_apFirstEntityTypes[i] = pHead;
+  }
+}
+
+#undef REBASE
+
+// }}}
+
+void wc_copy_world(SWorldCore *__restrict__ pTo, SWorldCore *__restrict__ pFrom) {
+  // without a block of its own the copy of a flat world becomes a regular one
+  const bool Flat = pFrom->m_pFlatBlock && wc_flat_prepare(pTo, pFrom);
+  if (!Flat && pTo->m_pFlatBlock)
+    wc_free(pTo);
+
+  pTo->m_GameTick = pFrom->m_GameTick;
+  pTo->m_pCollision = pFrom->m_pCollision;
+  pTo->m_pConfig = pFrom->m_pConfig;
+  pTo->m_pTunings = pFrom->m_pTunings;
+  th_copy(&pTo->m_Accelerator.m_Heads, &pFrom->m_Accelerator.m_Heads);
+  pTo->m_Accelerator.m_QueryValid = false;
+
+  if (Flat) {
+    wc_copy_flat(pTo, pFrom);
+    return;
+  }
+
+  wc_copy_entities(pTo, pFrom);
 
   // copy characters and tee links
   if (pTo->m_NumCharacters != pFrom->m_NumCharacters) {
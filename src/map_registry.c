@@ -0,0 +1,440 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // syscall
+#endif
+#include <ddnet_physics/map_registry.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <process.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// the few threading calls the registry needs, SRW locks and condition variables on Windows, pthreads everywhere else
+#ifdef _WIN32
+typedef SRWLOCK mutex_t;
+typedef CONDITION_VARIABLE cond_t;
+typedef HANDLE thread_t;
+#define THREAD_ENTRY unsigned __stdcall
+#define THREAD_RETURN 0
+
+static inline void mutex_init(mutex_t *pMutex) { InitializeSRWLock(pMutex); }
+static inline void mutex_destroy(mutex_t *pMutex) { (void)pMutex; }
+static inline void mutex_lock(mutex_t *pMutex) { AcquireSRWLockExclusive(pMutex); }
+static inline void mutex_unlock(mutex_t *pMutex) { ReleaseSRWLockExclusive(pMutex); }
+static inline void cond_init(cond_t *pCond) { InitializeConditionVariable(pCond); }
+static inline void cond_destroy(cond_t *pCond) { (void)pCond; }
+static inline void cond_wait(cond_t *pCond, mutex_t *pMutex) { SleepConditionVariableSRW(pCond, pMutex, INFINITE, 0); }
+static inline void cond_signal(cond_t *pCond) { WakeConditionVariable(pCond); }
+static inline void cond_broadcast(cond_t *pCond) { WakeAllConditionVariable(pCond); }
+static inline bool thread_start(thread_t *pThread, unsigned(__stdcall *pfnEntry)(void *), void *pUser) {
+  *pThread = (HANDLE)_beginthreadex(NULL, 0, pfnEntry, pUser, 0, NULL);
+  return *pThread != NULL;
+}
+static inline void thread_join(thread_t Thread) {
+  WaitForSingleObject(Thread, INFINITE);
+  CloseHandle(Thread);
+}
+#else
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+typedef pthread_t thread_t;
+#define THREAD_ENTRY void *
+#define THREAD_RETURN NULL
+
+static inline void mutex_init(mutex_t *pMutex) { pthread_mutex_init(pMutex, NULL); }
+static inline void mutex_destroy(mutex_t *pMutex) { pthread_mutex_destroy(pMutex); }
+static inline void mutex_lock(mutex_t *pMutex) { pthread_mutex_lock(pMutex); }
+static inline void mutex_unlock(mutex_t *pMutex) { pthread_mutex_unlock(pMutex); }
+static inline void cond_init(cond_t *pCond) { pthread_cond_init(pCond, NULL); }
+static inline void cond_destroy(cond_t *pCond) { pthread_cond_destroy(pCond); }
+static inline void cond_wait(cond_t *pCond, mutex_t *pMutex) { pthread_cond_wait(pCond, pMutex); }
+static inline void cond_signal(cond_t *pCond) { pthread_cond_signal(pCond); }
+static inline void cond_broadcast(cond_t *pCond) { pthread_cond_broadcast(pCond); }
+static inline bool thread_start(thread_t *pThread, void *(*pfnEntry)(void *), void *pUser) {
+  return pthread_create(pThread, NULL, pfnEntry, pUser) == 0;
+}
+static inline void thread_join(thread_t Thread) { pthread_join(Thread, NULL); }
+#endif
+
+enum { MAP_QUEUED, MAP_LOADING, MAP_READY, MAP_FAILED };
+
+#define MAX_NUMA_NODES 16
+
+struct MapHandle {
+  SMapRegistry *m_pRegistry;
+  SMapHandle *m_pNext;
+  SMapHandle *m_pNextQueued;
+  char *m_pPath;
+  uint64_t m_Hash;
+  uint64_t m_FileSize;
+  int m_State;
+  int m_RefCount;
+  uint64_t m_LastUse;
+  size_t m_Memory;
+  SCollision m_Collision;
+  SCollision *m_apReplicas[MAX_NUMA_NODES];
+};
+
+struct MapRegistry {
+  mutex_t m_Lock;
+  // m_QueueCond wakes the loader, m_LoadedCond everyone waiting in mr_collision
+  cond_t m_QueueCond;
+  cond_t m_LoadedCond;
+  thread_t m_Thread;
+  bool m_Quit;
+  SMapHandle *m_pMaps;
+  SMapHandle *m_pQueueFirst;
+  SMapHandle *m_pQueueLast;
+  size_t m_MemoryBudget;
+  uint64_t m_UseCounter;
+  char *m_pCacheDir;
+  int m_NumNumaNodes;
+  SMapRegistryStats m_Stats;
+};
+
+static char *copy_string(const char *pStr) {
+  const size_t Size = strlen(pStr) + 1;
+  char *pCopy = malloc(Size);
+  if (pCopy)
+    memcpy(pCopy, pStr, Size);
+  return pCopy;
+}
+
+// FNV-1a over the whole file
+static bool hash_file(const char *pPath, uint64_t *pHash, uint64_t *pSize) {
+  FILE *pFile = fopen(pPath, "rb");
+  if (!pFile)
+    return false;
+  uint64_t Hash = 14695981039346656037ull;
+  uint64_t Size = 0;
+  unsigned char aBuf[1 << 16];
+  size_t Read;
+  while ((Read = fread(aBuf, 1, sizeof(aBuf), pFile)) > 0) {
+    for (size_t i = 0; i < Read; ++i) {
+      Hash ^= aBuf[i];
+      Hash *= 1099511628211ull;
+    }
+    Size += Read;
+  }
+  const bool Error = ferror(pFile);
+  fclose(pFile);
+  *pHash = Hash;
+  *pSize = Size;
+  return !Error;
+}
+
+static int num_numa_nodes(void) {
+  int Last = 0;
+#ifdef __linux__
+  // "0" or "0-3"
+  FILE *pFile = fopen("/sys/devices/system/node/possible", "r");
+  if (pFile) {
+    int First;
+    if (fscanf(pFile, "%d-%d", &First, &Last) < 2)
+      Last = 0;
+    fclose(pFile);
+  }
+#endif
+  return Last < 0 ? 1 : Last >= MAX_NUMA_NODES ? MAX_NUMA_NODES : Last + 1;
+}
+
+static int current_numa_node(void) {
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int Cpu, Node;
+  if (syscall(SYS_getcpu, &Cpu, &Node, NULL) == 0 && Node < MAX_NUMA_NODES)
+    return Node;
+#endif
+  return 0;
+}
+
+static bool load_entry(SMapRegistry *pRegistry, SMapHandle *pMap, bool *pFromCache) {
+  char aCachePath[4096] = "";
+  *pFromCache = false;
+  if (pRegistry->m_pCacheDir) {
+    snprintf(aCachePath, sizeof(aCachePath), "%s/%016llx.cache", pRegistry->m_pCacheDir, (unsigned long long)pMap->m_Hash);
+    FILE *pFile = fopen(aCachePath, "rb");
+    if (pFile) {
+      fclose(pFile);
+      if (load_collision_cache(&pMap->m_Collision, aCachePath)) {
+        *pFromCache = true;
+        return true;
+      }
+    }
+  }
+
+  map_data_t Map = load_map(pMap->m_pPath);
+  if (!Map.game_layer.data) {
+    printf("Error: Failed to load map %s.\n", pMap->m_pPath);
+    return false;
+  }
+  if (!init_collision(&pMap->m_Collision, &Map)) {
+    printf("Error: Failed to load collision map %s.\n", pMap->m_pPath);
+    return false;
+  }
+  // a map that can't be cached still works, the next load just runs init_collision again
+  if (aCachePath[0])
+    save_collision_cache(&pMap->m_Collision, aCachePath);
+  return true;
+}
+
+// Unlinks unused maps, least recently used first, until the loaded maps fit into the budget. They are freed by the caller after
+// unlocking.
+static SMapHandle *evict_maps(SMapRegistry *pRegistry) {
+  SMapHandle *pEvicted = NULL;
+  while (pRegistry->m_MemoryBudget && pRegistry->m_Stats.m_Memory > pRegistry->m_MemoryBudget) {
+    SMapHandle **ppOldest = NULL;
+    for (SMapHandle **ppMap = &pRegistry->m_pMaps; *ppMap; ppMap = &(*ppMap)->m_pNext)
+      if ((*ppMap)->m_State == MAP_READY && (*ppMap)->m_RefCount == 0 && (!ppOldest || (*ppMap)->m_LastUse < (*ppOldest)->m_LastUse))
+        ppOldest = ppMap;
+    if (!ppOldest)
+      break;
+    SMapHandle *pMap = *ppOldest;
+    *ppOldest = pMap->m_pNext;
+    pMap->m_pNext = pEvicted;
+    pEvicted = pMap;
+    pRegistry->m_Stats.m_Memory -= pMap->m_Memory;
+    --pRegistry->m_Stats.m_NumMaps;
+    ++pRegistry->m_Stats.m_Evictions;
+  }
+  return pEvicted;
+}
+
+static void unlink_map(SMapRegistry *pRegistry, SMapHandle *pMap) {
+  SMapHandle **ppMap = &pRegistry->m_pMaps;
+  while (*ppMap != pMap)
+    ppMap = &(*ppMap)->m_pNext;
+  *ppMap = pMap->m_pNext;
+  pMap->m_pNext = NULL;
+  --pRegistry->m_Stats.m_NumMaps;
+}
+
+static void free_entry(SMapHandle *pMap) {
+  if (pMap->m_State == MAP_READY)
+    free_collision(&pMap->m_Collision);
+  for (int i = 0; i < MAX_NUMA_NODES; ++i) {
+    free_collision(pMap->m_apReplicas[i]);
+    free(pMap->m_apReplicas[i]);
+  }
+  free(pMap->m_pPath);
+  free(pMap);
+}
+
+static void free_entries(SMapHandle *pMap) {
+  while (pMap) {
+    SMapHandle *pNext = pMap->m_pNext;
+    free_entry(pMap);
+    pMap = pNext;
+  }
+}
+
+static THREAD_ENTRY loader_thread(void *pUser) {
+  SMapRegistry *pRegistry = pUser;
+  mutex_lock(&pRegistry->m_Lock);
+  while (true) {
+    while (!pRegistry->m_Quit && !pRegistry->m_pQueueFirst)
+      cond_wait(&pRegistry->m_QueueCond, &pRegistry->m_Lock);
+    if (pRegistry->m_Quit)
+      break;
+    SMapHandle *pMap = pRegistry->m_pQueueFirst;
+    pRegistry->m_pQueueFirst = pMap->m_pNextQueued;
+    if (!pRegistry->m_pQueueFirst)
+      pRegistry->m_pQueueLast = NULL;
+    pMap->m_State = MAP_LOADING;
+    mutex_unlock(&pRegistry->m_Lock);
+
+    // nobody else touches a map while it is loading
+    bool FromCache;
+    const bool Loaded = load_entry(pRegistry, pMap, &FromCache);
+    SCollisionMemory Memory = {0};
+    if (Loaded)
+      collision_memory(&pMap->m_Collision, &Memory);
+
+    mutex_lock(&pRegistry->m_Lock);
+    pMap->m_State = Loaded ? MAP_READY : MAP_FAILED;
+    pMap->m_Memory = Memory.m_Total;
+    pRegistry->m_Stats.m_Memory += Memory.m_Total;
+    if (Loaded)
+      ++*(FromCache ? &pRegistry->m_Stats.m_CacheLoads : &pRegistry->m_Stats.m_Loads);
+    cond_broadcast(&pRegistry->m_LoadedCond);
+    SMapHandle *pEvicted = NULL;
+    if (!Loaded && pMap->m_RefCount == 0) {
+      // everyone released it while it was loading
+      unlink_map(pRegistry, pMap);
+      pEvicted = pMap;
+    } else {
+      pEvicted = evict_maps(pRegistry);
+    }
+    mutex_unlock(&pRegistry->m_Lock);
+    free_entries(pEvicted);
+    mutex_lock(&pRegistry->m_Lock);
+  }
+  mutex_unlock(&pRegistry->m_Lock);
+  return THREAD_RETURN;
+}
+
+SMapRegistry *mr_create(size_t MemoryBudget, const char *pCacheDir) {
+  SMapRegistry *pRegistry = calloc(1, sizeof(SMapRegistry));
+  if (!pRegistry)
+    return NULL;
+  pRegistry->m_MemoryBudget = MemoryBudget;
+  pRegistry->m_NumNumaNodes = num_numa_nodes();
+  if (pCacheDir && !(pRegistry->m_pCacheDir = copy_string(pCacheDir))) {
+    free(pRegistry);
+    return NULL;
+  }
+  mutex_init(&pRegistry->m_Lock);
+  cond_init(&pRegistry->m_QueueCond);
+  cond_init(&pRegistry->m_LoadedCond);
+  if (!thread_start(&pRegistry->m_Thread, loader_thread, pRegistry)) {
+    printf("Error: could not start the map loader thread\n");
+    cond_destroy(&pRegistry->m_LoadedCond);
+    cond_destroy(&pRegistry->m_QueueCond);
+    mutex_destroy(&pRegistry->m_Lock);
+    free(pRegistry->m_pCacheDir);
+    free(pRegistry);
+    return NULL;
+  }
+  return pRegistry;
+}
+
+void mr_destroy(SMapRegistry *pRegistry) {
+  if (!pRegistry)
+    return;
+  mutex_lock(&pRegistry->m_Lock);
+  pRegistry->m_Quit = true;
+  cond_signal(&pRegistry->m_QueueCond);
+  mutex_unlock(&pRegistry->m_Lock);
+  thread_join(pRegistry->m_Thread);
+
+  free_entries(pRegistry->m_pMaps);
+  cond_destroy(&pRegistry->m_LoadedCond);
+  cond_destroy(&pRegistry->m_QueueCond);
+  mutex_destroy(&pRegistry->m_Lock);
+  free(pRegistry->m_pCacheDir);
+  free(pRegistry);
+}
+
+SMapHandle *mr_acquire(SMapRegistry *pRegistry, const char *pPath) {
+  uint64_t Hash, FileSize;
+  if (!hash_file(pPath, &Hash, &FileSize)) {
+    printf("Error: could not read map %s\n", pPath);
+    return NULL;
+  }
+
+  mutex_lock(&pRegistry->m_Lock);
+  SMapHandle *pMap = pRegistry->m_pMaps;
+  while (pMap && (pMap->m_Hash != Hash || pMap->m_FileSize != FileSize || pMap->m_State == MAP_FAILED))
+    pMap = pMap->m_pNext;
+  if (pMap) {
+    ++pRegistry->m_Stats.m_Hits;
+  } else {
+    pMap = calloc(1, sizeof(SMapHandle));
+    if (!pMap || !(pMap->m_pPath = copy_string(pPath))) {
+      mutex_unlock(&pRegistry->m_Lock);
+      free(pMap);
+      return NULL;
+    }
+    pMap->m_pRegistry = pRegistry;
+    pMap->m_Hash = Hash;
+    pMap->m_FileSize = FileSize;
+    pMap->m_State = MAP_QUEUED;
+    pMap->m_pNext = pRegistry->m_pMaps;
+    pRegistry->m_pMaps = pMap;
+    ++pRegistry->m_Stats.m_NumMaps;
+    if (pRegistry->m_pQueueLast)
+      pRegistry->m_pQueueLast->m_pNextQueued = pMap;
+    else
+      pRegistry->m_pQueueFirst = pMap;
+    pRegistry->m_pQueueLast = pMap;
+    cond_signal(&pRegistry->m_QueueCond);
+  }
+  ++pMap->m_RefCount;
+  pMap->m_LastUse = ++pRegistry->m_UseCounter;
+  mutex_unlock(&pRegistry->m_Lock);
+  return pMap;
+}
+
+bool mr_ready(const SMapHandle *pHandle) {
+  SMapRegistry *pRegistry = pHandle->m_pRegistry;
+  mutex_lock(&pRegistry->m_Lock);
+  const bool Ready = pHandle->m_State == MAP_READY || pHandle->m_State == MAP_FAILED;
+  mutex_unlock(&pRegistry->m_Lock);
+  return Ready;
+}
+
+SCollision *mr_collision(SMapHandle *pHandle) {
+  SMapRegistry *pRegistry = pHandle->m_pRegistry;
+  mutex_lock(&pRegistry->m_Lock);
+  while (pHandle->m_State == MAP_QUEUED || pHandle->m_State == MAP_LOADING)
+    cond_wait(&pRegistry->m_LoadedCond, &pRegistry->m_Lock);
+  SCollision *pCollision = pHandle->m_State == MAP_READY ? &pHandle->m_Collision : NULL;
+  mutex_unlock(&pRegistry->m_Lock);
+  return pCollision;
+}
+
+SCollision *mr_local_collision(SMapHandle *pHandle) {
+  SCollision *pCollision = mr_collision(pHandle);
+  SMapRegistry *pRegistry = pHandle->m_pRegistry;
+  if (!pCollision || pRegistry->m_NumNumaNodes <= 1)
+    return pCollision;
+  const int Node = current_numa_node();
+  mutex_lock(&pRegistry->m_Lock);
+  SCollision *pReplica = pHandle->m_apReplicas[Node];
+  mutex_unlock(&pRegistry->m_Lock);
+  if (pReplica)
+    return pReplica;
+
+  // built by this thread so its pages end up on this node, if another thread of the node was faster its replica wins
+  pReplica = malloc(sizeof(SCollision));
+  if (!pReplica || !replicate_collision(pReplica, pCollision)) {
+    free(pReplica);
+    return pCollision;
+  }
+  SCollisionMemory Memory;
+  collision_memory(pReplica, &Memory);
+  mutex_lock(&pRegistry->m_Lock);
+  SCollision *pExisting = pHandle->m_apReplicas[Node];
+  if (!pExisting) {
+    pHandle->m_apReplicas[Node] = pReplica;
+    pHandle->m_Memory += Memory.m_Total;
+    pRegistry->m_Stats.m_Memory += Memory.m_Total;
+  }
+  mutex_unlock(&pRegistry->m_Lock);
+  if (pExisting) {
+    free_collision(pReplica);
+    free(pReplica);
+    return pExisting;
+  }
+  return pReplica;
+}
+
+void mr_release(SMapHandle *pHandle) {
+  if (!pHandle)
+    return;
+  SMapRegistry *pRegistry = pHandle->m_pRegistry;
+  mutex_lock(&pRegistry->m_Lock);
+  SMapHandle *pEvicted = NULL;
+  if (--pHandle->m_RefCount == 0 && pHandle->m_State == MAP_FAILED) {
+    // failed maps are not kept around, the next acquire tries again
+    unlink_map(pRegistry, pHandle);
+    pEvicted = pHandle;
+  } else {
+    pEvicted = evict_maps(pRegistry);
+  }
+  mutex_unlock(&pRegistry->m_Lock);
+  free_entries(pEvicted);
+}
+
+void mr_stats(SMapRegistry *pRegistry, SMapRegistryStats *pOut) {
+  mutex_lock(&pRegistry->m_Lock);
+  *pOut = pRegistry->m_Stats;
+  mutex_unlock(&pRegistry->m_Lock);
+}
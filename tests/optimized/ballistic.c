@@ -0,0 +1,208 @@
+#include "ddnet_map_loader.h"
+#include <ddnet_physics/collision.h>
+#include <ddnet_physics/gamecore.h>
+#include <omp.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_WORLDS 64
+#define NUM_SEGMENTS 200
+#define MAX_SEGMENT_TICKS 64
+#define NUM_RUNS 5
+#define MIN_FALL_TILES 12
+
+// wc_tick_repeat against calling wc_tick for every tick. The input changes every few ticks and is held in between, the tees hook,
+// jump and fall around the map. Both have to end up in the same state after every segment. A tee dropped into the tallest free column
+// of the map falls without input through nothing but air, which always takes the ballistic path, that fall is compared tick by tick.
+
+// xorshift32
+static inline unsigned int fast_rand_u32(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline int fast_rand_range(unsigned int *state, int min, int max) { return min + (fast_rand_u32(state) % (max - min + 1)); }
+
+// input for the next segment and its length
+static int next_segment(SPlayerInput *pInput, unsigned int *pSeed) {
+  *pInput = (SPlayerInput){0};
+  pInput->m_Direction = fast_rand_range(pSeed, -1, 1);
+  pInput->m_Jump = fast_rand_range(pSeed, 0, 3) == 0;
+  pInput->m_Hook = fast_rand_range(pSeed, 0, 2) == 0;
+  pInput->m_TargetX = fast_rand_range(pSeed, -1000, 1000);
+  pInput->m_TargetY = fast_rand_range(pSeed, -1000, 1000);
+  return fast_rand_range(pSeed, 1, MAX_SEGMENT_TICKS);
+}
+
+// everything but the world pointer, both worlds share the collision and tunings
+static bool same_character(const SCharacterCore *pA, const SCharacterCore *pB) {
+  const size_t Offset = offsetof(SCharacterCore, m_pCollision);
+  return !memcmp((const char *)pA + Offset, (const char *)pB + Offset, sizeof(SCharacterCore) - Offset);
+}
+
+static double run_worlds(SWorldCore *pStart, bool Repeat, long long *pNumTicks) {
+  double Best = 1e30;
+  for (int run = 0; run < NUM_RUNS; ++run) {
+    double Elapsed = 0;
+    *pNumTicks = 0;
+    for (int w = 0; w < NUM_WORLDS; ++w) {
+      SWorldCore World = wc_empty();
+      wc_copy_world(&World, pStart);
+      unsigned int Seed = 0x9E3779B9u * (w + 1);
+      for (int s = 0; s < NUM_SEGMENTS; ++s) {
+        SPlayerInput Input;
+        const int Ticks = next_segment(&Input, &Seed);
+        cc_on_input(&World.m_pCharacters[0], &Input);
+        const double StartTime = omp_get_wtime();
+        if (Repeat) {
+          wc_tick_repeat(&World, Ticks);
+        } else {
+          for (int t = 0; t < Ticks; ++t)
+            wc_tick(&World);
+        }
+        Elapsed += omp_get_wtime() - StartTime;
+        *pNumTicks += Ticks;
+      }
+      wc_free(&World);
+    }
+    if (Elapsed < Best)
+      Best = Elapsed;
+  }
+  return Best;
+}
+
+// the tallest run of rows in which the three tiles around a column hold neither solids nor other tile indices, returns its height
+static int free_column(SCollision *pCollision, int *pX, int *pY) {
+  int Best = 0;
+  for (int x = 3; x < pCollision->m_MapData.width - 3; ++x) {
+    int Run = 0;
+    for (int y = 2; y < pCollision->m_MapData.height - 2; ++y) {
+      if (broad_rect_check(pCollision, BROAD_SOLID, x - 1, y, x + 1, y) || broad_rect_check(pCollision, BROAD_INDICES, x - 1, y, x + 1, y)) {
+        Run = 0;
+        continue;
+      }
+      if (++Run > Best) {
+        Best = Run;
+        *pX = x;
+        *pY = y - Run + 1;
+      }
+    }
+  }
+  return Best;
+}
+
+// wc_tick_repeat for every number of ticks the fall lasts against as many wc_tick calls, returns the number of mismatches or -1 if the
+// map has no column to fall through
+static int check_free_fall(SCollision *pCollision, SWorldCore *pStart) {
+  int X, Y;
+  const int Height = free_column(pCollision, &X, &Y);
+  if (Height < MIN_FALL_TILES)
+    return -1;
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
+    if (pStart->m_apFirstEntityTypes[i])
+      return -1;
+  }
+
+  SWorldCore Start = wc_empty(), Ref = wc_empty();
+  wc_copy_world(&Start, pStart);
+  SCharacterCore *pChar = &Start.m_pCharacters[0];
+  const SPlayerInput Input = {0};
+  cc_on_input(pChar, &Input);
+  pChar->m_Pos = vec2_init(X * 32 + 16, Y * 32 + 16);
+  pChar->m_PrevPos = pChar->m_Pos;
+  pChar->m_Vel = vec2_init(0, 0);
+  // one plain tick to settle the tile state on the new spot
+  wc_tick(&Start);
+  wc_copy_world(&Ref, &Start);
+
+  // until the tee gets within two tiles of the bottom of the column
+  const float Bottom = (Y + Height - 2) * 32;
+  int NumMismatches = 0, Ticks = 0;
+  while (vgety(Ref.m_pCharacters[0].m_Pos) < Bottom) {
+    wc_tick(&Ref);
+    ++Ticks;
+    SWorldCore World = wc_empty();
+    wc_copy_world(&World, &Start);
+    wc_tick_repeat(&World, Ticks);
+    if ((!same_character(&World.m_pCharacters[0], &Ref.m_pCharacters[0]) || World.m_GameTick != Ref.m_GameTick) && NumMismatches++ < 10)
+      printf("Mismatch of the free fall after %d ticks\n", Ticks);
+    wc_free(&World);
+  }
+  printf("free fall through %d tiles at x %d: %d ticks, %d mismatches\n", Height, X, Ticks, NumMismatches);
+  wc_free(&Start);
+  wc_free(&Ref);
+  return NumMismatches;
+}
+
+// returns the number of mismatching segments
+static int check_worlds(SWorldCore *pStart) {
+  int NumMismatches = 0;
+  for (int w = 0; w < NUM_WORLDS; ++w) {
+    SWorldCore World = wc_empty(), Ref = wc_empty();
+    wc_copy_world(&World, pStart);
+    wc_copy_world(&Ref, pStart);
+    unsigned int Seed = 0x9E3779B9u * (w + 1);
+    for (int s = 0; s < NUM_SEGMENTS; ++s) {
+      SPlayerInput Input;
+      const int Ticks = next_segment(&Input, &Seed);
+      cc_on_input(&World.m_pCharacters[0], &Input);
+      cc_on_input(&Ref.m_pCharacters[0], &Input);
+      wc_tick_repeat(&World, Ticks);
+      for (int t = 0; t < Ticks; ++t)
+        wc_tick(&Ref);
+      const SCharacterCore *pChar = &World.m_pCharacters[0];
+      const SCharacterCore *pRef = &Ref.m_pCharacters[0];
+      if (same_character(pChar, pRef) && World.m_GameTick == Ref.m_GameTick)
+        continue;
+      if (NumMismatches++ < 10)
+        printf("Mismatch in world %d, segment %d: pos (%f, %f)/(%f, %f) vel (%f, %f)/(%f, %f)\n", w, s, vgetx(pChar->m_Pos),
+               vgety(pChar->m_Pos), vgetx(pRef->m_Pos), vgety(pRef->m_Pos), vgetx(pChar->m_Vel), vgety(pChar->m_Vel), vgetx(pRef->m_Vel),
+               vgety(pRef->m_Vel));
+      // go on from the reference state
+      wc_free(&World);
+      World = wc_empty();
+      wc_copy_world(&World, &Ref);
+    }
+    wc_free(&World);
+    wc_free(&Ref);
+  }
+  return NumMismatches;
+}
+
+int main(int argc, char **argv) {
+  map_data_t Map = load_map(argc > 1 ? argv[1] : "maps/Aip-Gores.map");
+  SCollision Collision;
+  if (!init_collision(&Collision, &Map)) {
+    printf("Error: Failed to load collision map.\n");
+    return 1;
+  }
+  (void)Map;
+
+  SConfig Config;
+  init_config(&Config);
+  SWorldCore World = wc_empty();
+  wc_init(&World, &Collision, &Config);
+  wc_add_character(&World, 1);
+
+  int NumMismatches = check_worlds(&World);
+  const int FallMismatches = check_free_fall(&Collision, &World);
+  if (FallMismatches < 0)
+    printf("no free column of %d tiles without entities in the world, the free fall is skipped\n", MIN_FALL_TILES);
+  else
+    NumMismatches += FallMismatches;
+  long long NumTicks;
+  const double Loop = run_worlds(&World, false, &NumTicks);
+  const double Repeat = run_worlds(&World, true, &NumTicks);
+  printf("%lld ticks, %d mismatches\n", NumTicks, NumMismatches);
+  printf("wc_tick:\t%.1f ns/tick\n", Loop * 1e9 / NumTicks);
+  printf("wc_tick_repeat:\t%.1f ns/tick\t(%.2fx)\n", Repeat * 1e9 / NumTicks, Loop / Repeat);
+
+  wc_free(&World);
+  free_collision(&Collision);
+  return NumMismatches != 0;
+}
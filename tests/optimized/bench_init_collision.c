@@ -0,0 +1,108 @@
+#include <ddnet_physics/collision.h>
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_RUNS 20
+#define CACHE_PATH "bench_init_collision.cache"
+
+static const char *s_apStageNames[NUM_INIT_STAGES] = {"expand",   "tiles",  "neighbours",   "distance field", "broad",
+                                                        "pyramids", "spawns", "tile actions", "tile blocks"};
+
+void print_help(const char *prog_name) {
+  printf("Usage: %s [OPTIONS] [MAP...]\n", prog_name);
+  printf("Time map loading, every precompute stage of init_collision and the collision cache (default map: maps/Aip-Gores.map).\n\n");
+  printf("Options:\n");
+  printf("  --compact  Use the compact one bit per tile broad phase instead of the 8x8 bit fields\n");
+  printf("  --blocked  Store the tile tables in 8x8 tile blocks instead of rows\n");
+  printf("  --help     Display this help message and exit\n");
+}
+
+static bool bench_map(const char *pPath, int broad_backend, int alloc_policy) {
+  double aBest[NUM_INIT_STAGES];
+  double aSum[NUM_INIT_STAGES] = {0};
+  double BestLoad = 1e30, BestInit = 1e30;
+  int Width = 0, Height = 0;
+  for (int i = 0; i < NUM_INIT_STAGES; ++i)
+    aBest[i] = 1e30;
+
+  for (int run = 0; run < NUM_RUNS; ++run) {
+    double StartTime = omp_get_wtime();
+    map_data_t Map = load_map(pPath);
+    BestLoad = fmin(BestLoad, omp_get_wtime() - StartTime);
+    if (!Map.game_layer.data) {
+      printf("Error: Failed to load map %s.\n", pPath);
+      return false;
+    }
+    Width = Map.width;
+    Height = Map.height;
+
+    SCollision Collision;
+    StartTime = omp_get_wtime();
+    if (!init_collision_backend(&Collision, &Map, broad_backend, alloc_policy)) {
+      printf("Error: Failed to load collision map.\n");
+      return false;
+    }
+    BestInit = fmin(BestInit, omp_get_wtime() - StartTime);
+    for (int i = 0; i < NUM_INIT_STAGES; ++i) {
+      aBest[i] = fmin(aBest[i], Collision.m_aInitTimes[i]);
+      aSum[i] += Collision.m_aInitTimes[i];
+    }
+    if (run == NUM_RUNS - 1 && !save_collision_cache(&Collision, CACHE_PATH))
+      return false;
+    free_collision(&Collision);
+  }
+
+  double BestCache = 1e30;
+  for (int run = 0; run < NUM_RUNS; ++run) {
+    SCollision Collision;
+    double StartTime = omp_get_wtime();
+    if (!load_collision_cache(&Collision, CACHE_PATH))
+      return false;
+    BestCache = fmin(BestCache, omp_get_wtime() - StartTime);
+    free_collision(&Collision);
+  }
+  remove(CACHE_PATH);
+
+  printf("%s (%dx%d tiles), best of %d runs:\n", pPath, Width, Height, NUM_RUNS);
+  printf("  %-16s%10.3f ms\n", "load_map", BestLoad * 1e3);
+  printf("  %-16s%10.3f ms\n", "init_collision", BestInit * 1e3);
+  for (int i = 0; i < NUM_INIT_STAGES; ++i)
+    printf("    %-14s%10.3f ms (mean %.3f ms)\n", s_apStageNames[i], aBest[i] * 1e3, aSum[i] / NUM_RUNS * 1e3);
+  printf("  %-16s%10.3f ms\n", "load cache", BestCache * 1e3);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  int broad_backend = BROAD_BACKEND_BITFIELDS;
+  int alloc_policy = COLLISION_ALLOC_HUGE_PAGES;
+  int num_maps = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--compact") == 0) {
+      broad_backend = BROAD_BACKEND_COMPACT;
+    } else if (strcmp(argv[i], "--blocked") == 0) {
+      alloc_policy |= COLLISION_ALLOC_BLOCKED_TILES;
+    } else if (strcmp(argv[i], "--help") == 0) {
+      print_help(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      printf("Unknown option: %s. Use --help for usage.\n", argv[i]);
+      return 1;
+    }
+  }
+
+  printf("Benchmarking init_collision with the %s broad phase, %d threads with OpenMP.\n",
+         broad_backend == BROAD_BACKEND_COMPACT ? "compact" : "bit field", omp_get_max_threads());
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] == '-')
+      continue;
+    if (!bench_map(argv[i], broad_backend, alloc_policy))
+      return 1;
+    ++num_maps;
+  }
+  if (!num_maps && !bench_map("maps/Aip-Gores.map", broad_backend, alloc_policy))
+    return 1;
+  return 0;
+}
@@ -85,6 +85,8 @@ void print_help(const char *prog_name) {
   printf("Benchmark the physics engine with single or multi-threaded execution.\n\n");
   printf("Options:\n");
   printf("  --multi            Enable multi-threaded execution with OpenMP (default: single-threaded)\n");
+  printf("  --batch            Tick all worlds of a run together with wc_tick_batch (single-threaded)\n");
+  printf("  --blocked          Store the tile tables in 8x8 tile blocks instead of rows\n");
   printf("  --help             Display this help message and exit\n");
 }
 
@@ -100,11 +102,17 @@ static inline void generate_random_input(SPlayerInput *pInput, unsigned int *see
 
 int main(int argc, char *argv[]) {
   int use_multi_threaded = 0;
+  int use_batch = 0;
+  int alloc_policy = COLLISION_ALLOC_HUGE_PAGES;
 
   // Parse command-line options
   for (int i = 1; i < argc; i++) {
     if (strcmp(argv[i], "--multi") == 0) {
       use_multi_threaded = 1;
+    } else if (strcmp(argv[i], "--batch") == 0) {
+      use_batch = 1;
+    } else if (strcmp(argv[i], "--blocked") == 0) {
+      alloc_policy |= COLLISION_ALLOC_BLOCKED_TILES;
     } else if (strcmp(argv[i], "--help") == 0) {
       print_help(argv[0]);
       return 0;
@@ -118,7 +126,7 @@ int main(int argc, char *argv[]) {
 
   map_data_t Map = load_map("maps/Aip-Gores.map");
   SCollision Collision;
-  if (!init_collision(&Collision, &Map)) {
+  if (!init_collision_backend(&Collision, &Map, BROAD_BACKEND_BITFIELDS, alloc_policy)) {
     printf("Error: Failed to load collision map.\n");
     return 1;
   }
@@ -129,9 +137,7 @@ int main(int argc, char *argv[]) {
   init_config(&Config);
 
   SWorldCore StartWorld;
-  STeeGrid Grid;
-  tg_init(&Grid, Collision.m_MapData.width, Collision.m_MapData.height);
-  wc_init(&StartWorld, &Collision, &Grid, &Config);
+  wc_init(&StartWorld, &Collision, &Config);
   wc_add_character(&StartWorld, NUM_CHARACTERS);
   for (int t = 0; t < 50; ++t)
     wc_tick(&StartWorld);
@@ -140,7 +146,12 @@ int main(int argc, char *argv[]) {
   int total_ticks = ITERATIONS * TICKS_PER_ITERATION;
 
   printf("Benchmarking physics with random inputs\n");
-  printf("Mode: %s-threaded\n", use_multi_threaded ? "multi" : "single");
+  if (use_batch && use_multi_threaded) {
+    printf("--batch and --multi can't be combined.\n");
+    return 1;
+  }
+  printf("Mode: %s, %s tiles\n", use_batch ? "batched" : use_multi_threaded ? "multi-threaded" : "single-threaded",
+         Collision.m_BlockedTiles ? "blocked" : "row-major");
   if (use_multi_threaded)
     printf("Using %d threads with OpenMP.\n", omp_get_max_threads());
 
@@ -148,7 +159,32 @@ int main(int argc, char *argv[]) {
     double StartTime, ElapsedTime;
     unsigned int run_seed = global_seed ^ (run * 0x9E3779B9u); // vary seeds per run
 
-    if (use_multi_threaded) {
+    if (use_batch) {
+      // same amount of work as the other modes, but all ITERATIONS worlds advance in lock step
+      SWorldCore aWorlds[ITERATIONS];
+      SWorldCore *apWorlds[ITERATIONS];
+      unsigned int aSeeds[ITERATIONS];
+      StartTime = omp_get_wtime();
+      for (int i = 0; i < ITERATIONS; ++i) {
+        aWorlds[i] = (SWorldCore){};
+        wc_copy_world(&aWorlds[i], &StartWorld);
+        apWorlds[i] = &aWorlds[i];
+        aSeeds[i] = run_seed ^ i;
+      }
+      for (int t = 0; t < TICKS_PER_ITERATION; ++t) {
+        for (int i = 0; i < ITERATIONS; ++i) {
+          for (int c = 0; c < NUM_CHARACTERS; c++) {
+            SPlayerInput Input = {};
+            generate_random_input(&Input, &aSeeds[i]);
+            cc_on_input(&aWorlds[i].m_pCharacters[c], &Input);
+          }
+        }
+        wc_tick_batch(apWorlds, ITERATIONS);
+      }
+      for (int i = 0; i < ITERATIONS; ++i)
+        wc_free(&aWorlds[i]);
+      ElapsedTime = omp_get_wtime() - StartTime;
+    } else if (use_multi_threaded) {
       StartTime = omp_get_wtime();
 #pragma omp parallel for
       for (int i = 0; i < ITERATIONS; ++i) {
@@ -206,7 +242,6 @@ int main(int argc, char *argv[]) {
   printf("%s ticks/s\t%d runs\n", aBuf, NUM_RUNS);
 
   wc_free(&StartWorld);
-  tg_destroy(&Grid);
   free_collision(&Collision);
 
   return 0;
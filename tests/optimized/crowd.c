@@ -0,0 +1,98 @@
+#include "../utils.h"
+#include "ddnet_map_loader.h"
+#include <ddnet_physics/collision.h>
+#include <ddnet_physics/gamecore.h>
+#include <omp.h>
+#include <stdio.h>
+
+#define TICKS_PER_RUN 2000
+#define NUM_RUNS 5
+
+// Many armed tees spamming weapons in one world. The cost per tee tick should stay about the same when the number of tees grows,
+// hit checks of projectiles, lasers, explosions and hammers only look at the tees near them instead of all of them.
+static const int s_aNumTees[] = {8, 16, 32, 64, 128, 256};
+
+// xorshift32
+static inline unsigned int fast_rand_u32(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline int fast_rand_range(unsigned int *state, int min, int max) { return min + (fast_rand_u32(state) % (max - min + 1)); }
+
+static inline void generate_random_input(SPlayerInput *pInput, unsigned int *seed) {
+  pInput->m_Direction = fast_rand_range(seed, -1, 1);
+  pInput->m_Jump = fast_rand_range(seed, 0, 1);
+  // fire most of the time so there are plenty of bullets around
+  pInput->m_Fire = fast_rand_range(seed, 0, 3) != 0 ? (pInput->m_Fire + 1) | 1 : 0;
+  pInput->m_Hook = fast_rand_range(seed, 0, 1);
+  pInput->m_TargetX = fast_rand_range(seed, -1000, 1000);
+  pInput->m_TargetY = fast_rand_range(seed, -1000, 1000);
+  pInput->m_WantedWeapon = fast_rand_range(seed, WEAPON_HAMMER, WEAPON_LASER);
+}
+
+static int count_entities(const SWorldCore *pWorld) {
+  int Num = 0;
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i)
+    for (SEntity *pEnt = pWorld->m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+      ++Num;
+  return Num;
+}
+
+int main(void) {
+  map_data_t Map = load_map("maps/Aip-Gores.map");
+  SCollision Collision;
+  if (!init_collision(&Collision, &Map)) {
+    printf("Error: Failed to load collision map.\n");
+    return 1;
+  }
+  (void)Map;
+
+  SConfig Config;
+  init_config(&Config);
+
+  printf("Benchmarking crowded worlds with random inputs\n");
+  printf("tees\tns/tee tick\tentities/tick\n");
+  for (size_t n = 0; n < sizeof(s_aNumTees) / sizeof(s_aNumTees[0]); ++n) {
+    const int NumTees = s_aNumTees[n];
+    SWorldCore StartWorld;
+    wc_init(&StartWorld, &Collision, &Config);
+    wc_add_character(&StartWorld, NumTees);
+    for (int c = 0; c < NumTees; ++c)
+      for (int w = 0; w < NUM_WEAPONS; ++w)
+        StartWorld.m_pCharacters[c].m_aWeaponGot[w] = true;
+
+    double Best = 1e30;
+    long long NumEntities = 0;
+    for (int run = 0; run < NUM_RUNS; ++run) {
+      unsigned int Seed = 0x9E3779B9u * (run + 1);
+      SWorldCore World = (SWorldCore){};
+      wc_copy_world(&World, &StartWorld);
+      double StartTime = omp_get_wtime();
+      for (int t = 0; t < TICKS_PER_RUN; ++t) {
+        for (int c = 0; c < NumTees; ++c) {
+          SPlayerInput Input = World.m_pCharacters[c].m_Input;
+          generate_random_input(&Input, &Seed);
+          cc_on_input(&World.m_pCharacters[c], &Input);
+        }
+        wc_tick(&World);
+        if (run == 0)
+          NumEntities += count_entities(&World);
+      }
+      double ElapsedTime = omp_get_wtime() - StartTime;
+      // the first run also counts entities, keep it out of the timing
+      if (run > 0 && ElapsedTime < Best)
+        Best = ElapsedTime;
+      wc_free(&World);
+    }
+    printf("%d\t%.1f\t\t%.1f\n", NumTees, Best * 1e9 / ((double)TICKS_PER_RUN * NumTees), (double)NumEntities / TICKS_PER_RUN);
+    wc_free(&StartWorld);
+  }
+
+  free_collision(&Collision);
+  return 0;
+}
@@ -0,0 +1,159 @@
+#include "ddnet_map_loader.h"
+#include <ddnet_physics/collision.h>
+#include <ddnet_physics/gamecore.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_TICKS 1000
+// every so many ticks the flat world is also copied into a regular one and a regular world is copied over a flat one
+#define CROSS_COPY_EVERY 50
+
+// A flattened world against a regular one, both only ever move on through copies, flat into flat and regular into regular. A copy lists
+// the entities in reverse, so the regular world has to take the same copies. The entity capacities go from none over fewer than the
+// tees shoot to plenty, so the copies run with and without entities in spill chunks.
+
+static const int s_aCapacities[] = {0, 4, 64, 1024};
+static const int s_aNumTees[] = {1, 2, 5, 9};
+
+// xorshift32
+static inline unsigned int fast_rand_u32(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline int fast_rand_range(unsigned int *state, int min, int max) { return min + (fast_rand_u32(state) % (max - min + 1)); }
+
+static void give_inputs(SWorldCore *pWorld, unsigned int *pSeed) {
+  for (int i = 0; i < pWorld->m_NumCharacters; ++i) {
+    SPlayerInput Input = {0};
+    Input.m_Direction = fast_rand_range(pSeed, -1, 1);
+    Input.m_Jump = fast_rand_range(pSeed, 0, 1);
+    Input.m_Fire = fast_rand_range(pSeed, 0, 1);
+    Input.m_Hook = fast_rand_range(pSeed, 0, 1);
+    Input.m_TargetX = fast_rand_range(pSeed, -1000, 1000);
+    Input.m_TargetY = fast_rand_range(pSeed, -1000, 1000);
+    Input.m_WantedWeapon = fast_rand_range(pSeed, 0, NUM_WEAPONS - 1);
+    cc_on_input(&pWorld->m_pCharacters[i], &Input);
+  }
+}
+
+static int count_entities(const SWorldCore *pWorld) {
+  int Num = 0;
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i)
+    for (const SEntity *pEntity = pWorld->m_apFirstEntityTypes[i]; pEntity; pEntity = pEntity->m_pNextTypeEntity)
+      ++Num;
+  return Num;
+}
+
+// everything but the world pointer, the worlds share the collision and tunings
+static bool same_world(const SWorldCore *pA, const SWorldCore *pB) {
+  if (pA->m_GameTick != pB->m_GameTick || pA->m_NumCharacters != pB->m_NumCharacters || pA->m_NumSwitches != pB->m_NumSwitches)
+    return false;
+  const size_t Offset = offsetof(SCharacterCore, m_pCollision);
+  for (int i = 0; i < pA->m_NumCharacters; ++i) {
+    if (memcmp((const char *)&pA->m_pCharacters[i] + Offset, (const char *)&pB->m_pCharacters[i] + Offset, sizeof(SCharacterCore) - Offset))
+      return false;
+  }
+  // field by field, the padding of the switches is never initialized
+  for (int i = 0; i < pA->m_NumSwitches; ++i) {
+    const SSwitch *pSwitchA = &pA->m_pSwitches[i], *pSwitchB = &pB->m_pSwitches[i];
+    if (pSwitchA->m_Status != pSwitchB->m_Status || pSwitchA->m_Initial != pSwitchB->m_Initial || pSwitchA->m_EndTick != pSwitchB->m_EndTick ||
+        pSwitchA->m_Type != pSwitchB->m_Type || pSwitchA->m_LastUpdateTick != pSwitchB->m_LastUpdateTick)
+      return false;
+  }
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
+    const SEntity *pEntA = pA->m_apFirstEntityTypes[i], *pEntB = pB->m_apFirstEntityTypes[i];
+    for (; pEntA && pEntB; pEntA = pEntA->m_pNextTypeEntity, pEntB = pEntB->m_pNextTypeEntity) {
+      if (memcmp(&pEntA->m_Pos, &pEntB->m_Pos, sizeof(float) * 2) || pEntA->m_MarkedForDestroy != pEntB->m_MarkedForDestroy)
+        return false;
+    }
+    if (pEntA || pEntB)
+      return false;
+  }
+  return true;
+}
+
+// returns the number of mismatching checks
+static int run_scenario(SCollision *pCollision, SConfig *pConfig, int Capacity, int NumTees) {
+  SWorldCore aRef[2] = {wc_empty(), wc_empty()}, aFlat[2] = {wc_empty(), wc_empty()};
+  SWorldCore Regular = wc_empty(), RegularRef = wc_empty(), Scratch = wc_empty();
+  // built the same way, wc_flatten keeps the entity order
+  for (int i = 0; i < 2; ++i) {
+    SWorldCore *pWorld = i ? &aFlat[0] : &aRef[0];
+    wc_init(pWorld, pCollision, pConfig);
+    wc_add_character(pWorld, NumTees);
+  }
+  if (!wc_flatten(&aFlat[0], Capacity)) {
+    wc_free(&aRef[0]);
+    wc_free(&aFlat[0]);
+    return 1;
+  }
+  // a flat world to copy regular worlds over
+  wc_copy_world(&Scratch, &aFlat[0]);
+
+  unsigned int Seed = 0x9E3779B9u * (Capacity + 1) + NumTees, RefSeed = Seed;
+  int NumMismatches = 0, MaxEntities = 0, Cur = 0;
+  for (int t = 0; t < NUM_TICKS; ++t) {
+    wc_copy_world(&aRef[!Cur], &aRef[Cur]);
+    wc_copy_world(&aFlat[!Cur], &aFlat[Cur]);
+    Cur = !Cur;
+    give_inputs(&aRef[Cur], &RefSeed);
+    wc_tick(&aRef[Cur]);
+    give_inputs(&aFlat[Cur], &Seed);
+    wc_tick(&aFlat[Cur]);
+
+    const int Num = count_entities(&aRef[Cur]);
+    if (Num > MaxEntities)
+      MaxEntities = Num;
+    if (!same_world(&aFlat[Cur], &aRef[Cur]) && NumMismatches++ < 10)
+      printf("Mismatch in tick %d with capacity %d and %d tees\n", t, Capacity, NumTees);
+
+    if (t % CROSS_COPY_EVERY)
+      continue;
+    // flat into regular and regular over flat
+    wc_copy_world(&Regular, &aFlat[Cur]);
+    wc_copy_world(&RegularRef, &aRef[Cur]);
+    wc_copy_world(&Scratch, &aRef[Cur]);
+    if ((!same_world(&Regular, &RegularRef) || !same_world(&Scratch, &RegularRef)) && NumMismatches++ < 10)
+      printf("Mismatch of the cross copies in tick %d with capacity %d and %d tees\n", t, Capacity, NumTees);
+    wc_copy_world(&Scratch, &aFlat[Cur]);
+  }
+  printf("%d\t\t%d\t%d\t\t%s\t%d\n", Capacity, NumTees, MaxEntities, MaxEntities > Capacity ? "yes" : "no", NumMismatches);
+
+  for (int i = 0; i < 2; ++i) {
+    wc_free(&aRef[i]);
+    wc_free(&aFlat[i]);
+  }
+  wc_free(&Regular);
+  wc_free(&RegularRef);
+  wc_free(&Scratch);
+  return NumMismatches;
+}
+
+int main(int argc, char **argv) {
+  map_data_t Map = load_map(argc > 1 ? argv[1] : "maps/Aip-Gores.map");
+  SCollision Collision;
+  if (!init_collision(&Collision, &Map)) {
+    printf("Error: Failed to load collision map.\n");
+    return 1;
+  }
+  (void)Map;
+
+  SConfig Config;
+  init_config(&Config);
+
+  printf("Flat worlds ticked through copies against a regular world, %d ticks\n", NUM_TICKS);
+  printf("capacity\ttees\tmax entities\tspilled\tmismatches\n");
+  int NumMismatches = 0;
+  for (size_t c = 0; c < sizeof(s_aCapacities) / sizeof(s_aCapacities[0]); ++c)
+    for (size_t n = 0; n < sizeof(s_aNumTees) / sizeof(s_aNumTees[0]); ++n)
+      NumMismatches += run_scenario(&Collision, &Config, s_aCapacities[c], s_aNumTees[n]);
+
+  free_collision(&Collision);
+  return NumMismatches != 0;
+}
@@ -0,0 +1,210 @@
+#include "../utils.h"
+#include <ddnet_physics/collision.h>
+#include <ddnet_physics/vmath.h>
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_LINES 1000000
+#define NUM_RUNS 5
+#define MAX_LENGTH 64.0f
+
+typedef struct {
+  mvec2 m_From;
+  mvec2 m_To;
+} SLine;
+
+// xorshift32
+static inline unsigned int fast_rand_u32(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline float fast_rand_float(unsigned int *state, float min, float max) {
+  return min + (fast_rand_u32(state) / (float)UINT32_MAX) * (max - min);
+}
+
+// The sample-every-unit version intersect_line used before, kept as reference for the results and the timing.
+static bool broad_check_ref(const SCollision *pCollision, mvec2 Start, mvec2 End) {
+  const int MinX = (int)fminf(vgetx(Start), vgetx(End)) >> 5;
+  const int MinY = (int)fminf(vgety(Start), vgety(End)) >> 5;
+  const int MaxX = (int)fmaxf(vgetx(Start), vgetx(End)) >> 5;
+  const int MaxY = (int)fmaxf(vgety(Start), vgety(End)) >> 5;
+  if (MinY < 0 || MaxY >= pCollision->m_MapData.height || MinX < 0 || MaxX >= pCollision->m_MapData.width)
+    return false;
+  return broad_rect_check(pCollision, BROAD_SOLID, MinX, MinY, MaxX, MaxY);
+}
+
+static bool intersect_line_ref(SCollision *pCollision, mvec2 Pos0, mvec2 Pos1, mvec2 *pOutCollision, mvec2 *pOutBeforeCollision) {
+  if (!broad_check_ref(pCollision, Pos0, Pos1)) {
+    *pOutCollision = Pos1;
+    *pOutBeforeCollision = Pos1;
+    return false;
+  }
+
+  float Distance = vdistance(Pos0, Pos1);
+  int End = Distance + 1;
+  mvec2 Last = Pos0;
+  int LastIdx = -1;
+  for (int i = 0; i <= End; i++) {
+    float a = i / (float)End;
+    mvec2 Pos = vvfmix(Pos0, Pos1, a);
+    int Nx = (int)(vgetx(Pos) + 0.5f) >> 5;
+    int Ny = (int)(vgety(Pos) + 0.5f) >> 5;
+    int Idx = map_index(pCollision, Nx, Ny);
+    if (LastIdx == Idx)
+      continue;
+    LastIdx = Idx;
+    if (pCollision->m_pTileInfos[Idx] & INFO_ISSOLID) {
+      *pOutCollision = Pos;
+      *pOutBeforeCollision = Last;
+      return true;
+    }
+    Last = Pos;
+  }
+  *pOutCollision = Pos1;
+  *pOutBeforeCollision = Pos1;
+  return false;
+}
+
+static bool same_vec(mvec2 a, mvec2 b) { return vgetx(a) == vgetx(b) && vgety(a) == vgety(b); }
+
+static void fill_hook_rays(SHookRayLanes *pRays, const SLine *pLines) {
+  for (int i = 0; i < HOOK_RAY_LANES; ++i) {
+    pRays->m_aFromX[i] = vgetx(pLines[i].m_From);
+    pRays->m_aFromY[i] = vgety(pLines[i].m_From);
+    pRays->m_aToX[i] = vgetx(pLines[i].m_To);
+    pRays->m_aToY[i] = vgety(pLines[i].m_To);
+  }
+}
+
+// intersect_line_tele_hook_x8 against intersect_line_tele_hook, the lines are used as hook rays
+static int check_hook_rays(SCollision *pCollision, const SLine *pLines) {
+  unsigned char TeleNr;
+  unsigned char *pTeleNr = pCollision->m_MapData.tele_layer.type ? &TeleNr : NULL;
+  int NumMismatches = 0;
+  for (int i = 0; i + HOOK_RAY_LANES <= NUM_LINES; i += HOOK_RAY_LANES) {
+    SHookRayLanes Rays;
+    fill_hook_rays(&Rays, &pLines[i]);
+    // leave out a few lanes, those must not be touched
+    const int LaneMask = i % (HOOK_RAY_LANES * 4) ? 0xff : 0x5a;
+    memset(Rays.m_aHit, 0xee, sizeof(Rays.m_aHit));
+    intersect_line_tele_hook_x8(pCollision, &Rays, LaneMask);
+    for (int j = 0; j < HOOK_RAY_LANES; ++j) {
+      if (!(LaneMask & 1 << j)) {
+        NumMismatches += Rays.m_aHit[j] != 0xee;
+        continue;
+      }
+      mvec2 Out;
+      TeleNr = 0;
+      const unsigned char Hit = intersect_line_tele_hook(pCollision, pLines[i + j].m_From, pLines[i + j].m_To, &Out, pTeleNr);
+      if (Hit != Rays.m_aHit[j] || !same_vec(Out, vec2_init(Rays.m_aOutX[j], Rays.m_aOutY[j])) ||
+          TeleNr != Rays.m_aTeleNr[j]) {
+        if (NumMismatches++ < 10)
+          printf("Hook mismatch: (%f, %f) -> (%f, %f): hit %d/%d out (%f, %f)/(%f, %f)\n", vgetx(pLines[i + j].m_From),
+                 vgety(pLines[i + j].m_From), vgetx(pLines[i + j].m_To), vgety(pLines[i + j].m_To), Rays.m_aHit[j], Hit, Rays.m_aOutX[j],
+                 Rays.m_aOutY[j], vgetx(Out), vgety(Out));
+      }
+    }
+  }
+  return NumMismatches;
+}
+
+int main(void) {
+  map_data_t Map = load_map("maps/Aip-Gores.map");
+  SCollision Collision;
+  if (!init_collision(&Collision, &Map)) {
+    printf("Error: Failed to load collision map.\n");
+    return 1;
+  }
+  // Map is now owned by the collision and not needed here anymore
+  (void)Map;
+
+  SLine *pLines = malloc(NUM_LINES * sizeof(SLine));
+  unsigned int Seed = 0x9E3779B9u;
+  const float MaxX = Collision.m_MapData.width * 32.f - 128.f;
+  const float MaxY = Collision.m_MapData.height * 32.f - 128.f;
+  for (int i = 0; i < NUM_LINES; ++i) {
+    // lines start in the air and are about as long as the distance a projectile covers in one tick
+    do
+      pLines[i].m_From = vec2_init(fast_rand_float(&Seed, 128.f, MaxX), fast_rand_float(&Seed, 128.f, MaxY));
+    while (check_point(&Collision, pLines[i].m_From));
+    float Angle = fast_rand_float(&Seed, 0.f, 2.f * PI);
+    float Length = fast_rand_float(&Seed, 0.f, MAX_LENGTH);
+    pLines[i].m_To = vvadd(pLines[i].m_From, vfmul(vdirection(Angle), Length));
+  }
+
+  int NumHits = 0;
+  int NumMismatches = 0;
+  for (int i = 0; i < NUM_LINES; ++i) {
+    mvec2 Col, Before, RefCol, RefBefore;
+    bool Hit = intersect_line(&Collision, pLines[i].m_From, pLines[i].m_To, &Col, &Before);
+    bool RefHit = intersect_line_ref(&Collision, pLines[i].m_From, pLines[i].m_To, &RefCol, &RefBefore);
+    NumHits += RefHit;
+    if (Hit != RefHit || !same_vec(Col, RefCol) || !same_vec(Before, RefBefore)) {
+      if (NumMismatches++ < 10)
+        printf("Mismatch: (%f, %f) -> (%f, %f): hit %d/%d col (%f, %f)/(%f, %f) before (%f, %f)/(%f, %f)\n", vgetx(pLines[i].m_From),
+               vgety(pLines[i].m_From), vgetx(pLines[i].m_To), vgety(pLines[i].m_To), Hit, RefHit, vgetx(Col), vgety(Col), vgetx(RefCol),
+               vgety(RefCol), vgetx(Before), vgety(Before), vgetx(RefBefore), vgety(RefBefore));
+    }
+  }
+  printf("%d lines, %d hits, %d mismatches\n", NUM_LINES, NumHits, NumMismatches);
+  const int NumHookMismatches = check_hook_rays(&Collision, pLines);
+  printf("%d hook rays, %d mismatches\n", NUM_LINES, NumHookMismatches);
+
+  double BestRef = 1e30, Best = 1e30, BestHook = 1e30, BestHookX8 = 1e30;
+  int Sink = 0;
+  for (int run = 0; run < NUM_RUNS; ++run) {
+    double StartTime = omp_get_wtime();
+    for (int i = 0; i < NUM_LINES; ++i) {
+      mvec2 Col, Before;
+      Sink += intersect_line_ref(&Collision, pLines[i].m_From, pLines[i].m_To, &Col, &Before);
+    }
+    BestRef = fmin(BestRef, omp_get_wtime() - StartTime);
+
+    StartTime = omp_get_wtime();
+    for (int i = 0; i < NUM_LINES; ++i) {
+      mvec2 Col, Before;
+      Sink += intersect_line(&Collision, pLines[i].m_From, pLines[i].m_To, &Col, &Before);
+    }
+    Best = fmin(Best, omp_get_wtime() - StartTime);
+
+    StartTime = omp_get_wtime();
+    for (int i = 0; i < NUM_LINES; ++i) {
+      mvec2 Col;
+      unsigned char TeleNr = 0;
+      Sink += intersect_line_tele_hook(&Collision, pLines[i].m_From, pLines[i].m_To, &Col,
+                                       Collision.m_MapData.tele_layer.type ? &TeleNr : NULL);
+    }
+    BestHook = fmin(BestHook, omp_get_wtime() - StartTime);
+
+    StartTime = omp_get_wtime();
+    for (int i = 0; i + HOOK_RAY_LANES <= NUM_LINES; i += HOOK_RAY_LANES) {
+      SHookRayLanes Rays;
+      fill_hook_rays(&Rays, &pLines[i]);
+      intersect_line_tele_hook_x8(&Collision, &Rays, (1 << HOOK_RAY_LANES) - 1);
+      Sink += Rays.m_aHit[0];
+    }
+    BestHookX8 = fmin(BestHookX8, omp_get_wtime() - StartTime);
+  }
+
+  char aBuf[32];
+  format_int((long long)(NUM_LINES / BestRef), aBuf);
+  printf("sample loop:\t%s calls/s\n", aBuf);
+  format_int((long long)(NUM_LINES / Best), aBuf);
+  printf("intersect_line:\t%s calls/s\t(%.2fx, %d)\n", aBuf, BestRef / Best, Sink);
+  format_int((long long)(NUM_LINES / BestHook), aBuf);
+  printf("hook rays:\t%s rays/s\n", aBuf);
+  format_int((long long)(NUM_LINES / BestHookX8), aBuf);
+  printf("hook rays x8:\t%s rays/s\t(%.2fx)\n", aBuf, BestHook / BestHookX8);
+
+  free(pLines);
+  free_collision(&Collision);
+  return NumMismatches != 0 || NumHookMismatches != 0;
+}
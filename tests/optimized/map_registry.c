@@ -0,0 +1,110 @@
+#include <ddnet_physics/gamecore.h>
+#include <ddnet_physics/map_registry.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_JOBS 256
+#define TICKS_PER_JOB 200
+
+// Workers that switch maps after every job, like a trainer that samples a map per episode. Every job acquires its map from one
+// registry, so all worlds on the same map share one collision and only the first job of a map waits for it to load.
+static const char *s_apMaps[] = {"maps/Aip-Gores.map", "maps/Weapon Finals II.map"};
+#define NUM_MAPS (int)(sizeof(s_apMaps) / sizeof(s_apMaps[0]))
+
+// xorshift32
+static inline unsigned int fast_rand_u32(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline int fast_rand_range(unsigned int *state, int min, int max) { return min + (fast_rand_u32(state) % (max - min + 1)); }
+
+static inline void generate_random_input(SPlayerInput *pInput, unsigned int *seed) {
+  pInput->m_Direction = fast_rand_range(seed, -1, 1);
+  pInput->m_Jump = fast_rand_range(seed, 0, 1);
+  pInput->m_Hook = fast_rand_range(seed, 0, 1);
+  pInput->m_TargetX = fast_rand_range(seed, -1000, 1000);
+  pInput->m_TargetY = fast_rand_range(seed, -1000, 1000);
+}
+
+void print_help(const char *prog_name) {
+  printf("Usage: %s [OPTIONS]\n", prog_name);
+  printf("Run worlds on alternating maps from many threads, sharing the maps through a map registry.\n\n");
+  printf("Options:\n");
+  printf("  --budget <MB>     Memory budget of the registry, 0 keeps every map (default: 0)\n");
+  printf("  --cache <DIR>     Load and save collision caches in DIR\n");
+  printf("  --help            Display this help message and exit\n");
+}
+
+int main(int argc, char *argv[]) {
+  size_t Budget = 0;
+  const char *pCacheDir = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+      Budget = (size_t)atoi(argv[++i]) * 1024 * 1024;
+    } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      pCacheDir = argv[++i];
+    } else if (strcmp(argv[i], "--help") == 0) {
+      print_help(argv[0]);
+      return 0;
+    } else {
+      printf("Unknown option: %s. Use --help for usage.\n", argv[i]);
+      return 1;
+    }
+  }
+
+  SMapRegistry *pRegistry = mr_create(Budget, pCacheDir);
+  if (!pRegistry)
+    return 1;
+  SConfig Config;
+  init_config(&Config);
+
+  printf("Running %d jobs of %d ticks on %d maps with %d threads.\n", NUM_JOBS, TICKS_PER_JOB, NUM_MAPS, omp_get_max_threads());
+  int Failed = 0;
+  const double StartTime = omp_get_wtime();
+#pragma omp parallel for schedule(dynamic) reduction(+ : Failed)
+  for (int Job = 0; Job < NUM_JOBS; ++Job) {
+    SMapHandle *pMap = mr_acquire(pRegistry, s_apMaps[Job % NUM_MAPS]);
+    SCollision *pCollision = pMap ? mr_collision(pMap) : NULL;
+    if (!pCollision) {
+      mr_release(pMap);
+      ++Failed;
+      continue;
+    }
+    SConfig JobConfig = Config;
+    SWorldCore World = wc_empty();
+    wc_init(&World, pCollision, &JobConfig);
+    wc_add_character(&World, 1);
+    unsigned int Seed = Job * 2654435761u + 1;
+    for (int t = 0; t < TICKS_PER_JOB; ++t) {
+      for (int i = 0; i < World.m_NumCharacters; ++i) {
+        SPlayerInput Input = {0};
+        generate_random_input(&Input, &Seed);
+        cc_on_input(&World.m_pCharacters[i], &Input);
+      }
+      wc_tick(&World);
+    }
+    wc_free(&World);
+    mr_release(pMap);
+  }
+  const double Duration = omp_get_wtime() - StartTime;
+
+  SMapRegistryStats Stats;
+  mr_stats(pRegistry, &Stats);
+  mr_destroy(pRegistry);
+  if (Failed) {
+    printf("Error: %d jobs could not load their map.\n", Failed);
+    return 1;
+  }
+  printf("%.3f ms per job\n", Duration * 1e3 / NUM_JOBS);
+  printf("loads: %llu, cache loads: %llu, hits: %llu, evictions: %llu, maps held: %d (%.2f MB)\n", (unsigned long long)Stats.m_Loads,
+         (unsigned long long)Stats.m_CacheLoads, (unsigned long long)Stats.m_Hits, (unsigned long long)Stats.m_Evictions, Stats.m_NumMaps,
+         Stats.m_Memory / (1024.0 * 1024.0));
+  return 0;
+}
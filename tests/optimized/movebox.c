@@ -1,15 +1,25 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // syscall
+#endif
 #include "../utils.h"
 #include <ddnet_physics/collision.h>
 #include <ddnet_physics/vmath.h>
 #include <math.h>
 #include <omp.h>
 #include <stdio.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #define ITERATIONS 3000
 #define TICKS_PER_ITERATION 3000
 #define TOTAL_TICKS (ITERATIONS * TICKS_PER_ITERATION)
 #define NUM_RUNS 10
 #define BAR_WIDTH 50
+#define CHECK_BATCHES (1 << 18)
 
 typedef struct {
   double mean;
@@ -58,6 +68,91 @@ static SStats calculate_stats(double *values, int count) {
   return stats;
 }
 
+// Counts data TLB load misses of this process and all threads it starts afterwards, -1 if the kernel doesn't allow it.
+static int open_tlb_miss_counter(void) {
+#ifdef __linux__
+  struct perf_event_attr Attr;
+  memset(&Attr, 0, sizeof(Attr));
+  Attr.type = PERF_TYPE_HW_CACHE;
+  Attr.size = sizeof(Attr);
+  Attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  Attr.disabled = 1;
+  Attr.inherit = 1;
+  Attr.exclude_kernel = 1;
+  Attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &Attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+static long long read_tlb_miss_counter(int Fd) {
+  long long Count = 0;
+#ifdef __linux__
+  if (Fd >= 0 && read(Fd, &Count, sizeof(Count)) != sizeof(Count))
+    Count = 0;
+#endif
+  return Count;
+}
+
+static void enable_tlb_miss_counter(int Fd, bool Enable) {
+#ifdef __linux__
+  if (Fd >= 0)
+    ioctl(Fd, Enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+// MOVE_BOX_LANES iterations of the benchmark loop in one move_box_x8 call
+static inline void random_move_box_x8(const SCollision *pCollision, unsigned int *seed, float max) {
+  SMoveBoxLanes Lanes;
+  for (int l = 0; l < MOVE_BOX_LANES; ++l) {
+    Lanes.m_aPosX[l] = fast_rand_float(seed, 128.0f, max);
+    Lanes.m_aPosY[l] = fast_rand_float(seed, 128.0f, max);
+    Lanes.m_aVelX[l] = fast_rand_float(seed, -32.0f, 32.0f);
+    Lanes.m_aVelY[l] = fast_rand_float(seed, -32.0f, 32.0f);
+    Lanes.m_aElasticityX[l] = 0.0f;
+    Lanes.m_aElasticityY[l] = 0.0f;
+    Lanes.m_aGrounded[l] = false;
+  }
+  move_box_x8(pCollision, &Lanes, (1 << MOVE_BOX_LANES) - 1);
+}
+
+// Compares move_box_x8 with move_box on random moves, partly masked, bouncing and fast. Returns the number of differing calls.
+static int check_move_box_x8(const SCollision *pCollision, float max) {
+  unsigned int seed = 1;
+  int mismatches = 0;
+  for (int i = 0; i < CHECK_BATCHES; ++i) {
+    const float speed = i % 8 == 0 ? 600.0f : 32.0f;
+    const int lane_mask = i % 2 ? (int)(fast_rand_u32(&seed) & ((1 << MOVE_BOX_LANES) - 1)) : (1 << MOVE_BOX_LANES) - 1;
+    SMoveBoxLanes Lanes;
+    mvec2 aPos[MOVE_BOX_LANES], aVel[MOVE_BOX_LANES], aElasticity[MOVE_BOX_LANES];
+    for (int l = 0; l < MOVE_BOX_LANES; ++l) {
+      aPos[l] = vec2_init(fast_rand_float(&seed, 128.0f + speed, max - speed), fast_rand_float(&seed, 128.0f + speed, max - speed));
+      aVel[l] = vec2_init(fast_rand_float(&seed, -speed, speed), fast_rand_float(&seed, -speed, speed));
+      aElasticity[l] = vec2_init(fast_rand_float(&seed, 0.0f, 1.0f), fast_rand_float(&seed, 0.0f, 1.0f));
+      Lanes.m_aPosX[l] = vgetx(aPos[l]);
+      Lanes.m_aPosY[l] = vgety(aPos[l]);
+      Lanes.m_aVelX[l] = vgetx(aVel[l]);
+      Lanes.m_aVelY[l] = vgety(aVel[l]);
+      Lanes.m_aElasticityX[l] = vgetx(aElasticity[l]);
+      Lanes.m_aElasticityY[l] = vgety(aElasticity[l]);
+      Lanes.m_aGrounded[l] = false;
+    }
+    move_box_x8(pCollision, &Lanes, lane_mask);
+    for (int l = 0; l < MOVE_BOX_LANES; ++l) {
+      mvec2 NewPos = aPos[l], NewVel = aVel[l];
+      bool Grounded = false;
+      if (lane_mask & 1 << l)
+        move_box(pCollision, aPos[l], aVel[l], &NewPos, &NewVel, aElasticity[l], &Grounded);
+      const float aScalar[4] = {vgetx(NewPos), vgety(NewPos), vgetx(NewVel), vgety(NewVel)};
+      const float aBatched[4] = {Lanes.m_aPosX[l], Lanes.m_aPosY[l], Lanes.m_aVelX[l], Lanes.m_aVelY[l]};
+      if (memcmp(aScalar, aBatched, sizeof(aScalar)) != 0 || Grounded != Lanes.m_aGrounded[l])
+        ++mismatches;
+    }
+  }
+  return mismatches;
+}
+
 void print_progress(int current, int total, double elapsed_time) {
   float progress = (float)current / total;
   int pos = (int)(BAR_WIDTH * progress);
@@ -79,16 +174,35 @@ void print_help(const char *prog_name) {
   printf("Usage: %s [OPTIONS]\n", prog_name);
   printf("Benchmark move_box with single or multi-threaded execution.\n\n");
   printf("Options:\n");
-  printf("  --multi    Enable multi-threaded execution with OpenMP (default: single-threaded)\n");
-  printf("  --help     Display this help message and exit\n");
+  printf("  --multi        Enable multi-threaded execution with OpenMP (default: single-threaded)\n");
+  printf("  --compact      Use the compact one bit per tile broad phase instead of the 8x8 bit fields\n");
+  printf("  --small-pages  Don't back the big tables with transparent huge pages\n");
+  printf("  --blocked      Store the tile tables in 8x8 tile blocks instead of rows\n");
+  printf("  --replica      Run on a replica of the collision made by this thread, see replicate_collision()\n");
+  printf("  --batched      Check move_box_x8 against move_box, then benchmark it with %d moves per call\n", MOVE_BOX_LANES);
+  printf("  --help         Display this help message and exit\n");
 }
 
 int main(int argc, char *argv[]) {
   int use_multi_threaded = 0;
+  int broad_backend = BROAD_BACKEND_BITFIELDS;
+  int use_replica = 0;
+  int use_batched = 0;
+  int alloc_policy = COLLISION_ALLOC_HUGE_PAGES;
 
   for (int i = 1; i < argc; i++) {
     if (strcmp(argv[i], "--multi") == 0) {
       use_multi_threaded = 1;
+    } else if (strcmp(argv[i], "--compact") == 0) {
+      broad_backend = BROAD_BACKEND_COMPACT;
+    } else if (strcmp(argv[i], "--small-pages") == 0) {
+      alloc_policy &= ~COLLISION_ALLOC_HUGE_PAGES;
+    } else if (strcmp(argv[i], "--blocked") == 0) {
+      alloc_policy |= COLLISION_ALLOC_BLOCKED_TILES;
+    } else if (strcmp(argv[i], "--replica") == 0) {
+      use_replica = 1;
+    } else if (strcmp(argv[i], "--batched") == 0) {
+      use_batched = 1;
     } else if (strcmp(argv[i], "--help") == 0) {
       print_help(argv[0]);
       return 0;
@@ -100,31 +214,66 @@ int main(int argc, char *argv[]) {
 
   map_data_t Map = load_map("maps/Aip-Gores.map");
   SCollision Collision;
-  if (!init_collision(&Collision, &Map)) {
+  if (!init_collision_backend(&Collision, &Map, broad_backend, alloc_policy)) {
     printf("Error: Failed to load collision map.\n");
     return 1;
   }
   // Map is now owned by the collision and not needed here anymore
   (void)Map;
+  if (use_replica) {
+    SCollision Replica;
+    if (!replicate_collision(&Replica, &Collision))
+      return 1;
+    free_collision(&Collision);
+    Collision = Replica;
+  }
+
+  SCollisionMemory Memory;
+  collision_memory(&Collision, &Memory);
+  printf("Collision memory in KiB, %s broad phase, %s tiles:\n", broad_backend == BROAD_BACKEND_COMPACT ? "compact" : "bit field",
+         Collision.m_BlockedTiles ? "blocked" : "row-major");
+  printf("  map layers %zu, tile infos %zu, tile actions %zu, broad check %zu, move restrictions %zu\n", Memory.m_MapLayers >> 10,
+         Memory.m_TileInfos >> 10, Memory.m_TileActions >> 10, Memory.m_TileBroadCheck >> 10, Memory.m_MoveRestrictions >> 10);
+  printf("  pickups %zu, speedups %zu, distance field %zu\n", Memory.m_Pickups >> 10, Memory.m_Speedups >> 10, Memory.m_DistanceField >> 10);
+  printf("  broad bit fields %zu, broad bits %zu, broad pyramids %zu, total %zu\n", Memory.m_BroadBitFields >> 10, Memory.m_BroadBits >> 10,
+         Memory.m_BroadPyramids >> 10, Memory.m_Total >> 10);
 
   double aTPSValues[NUM_RUNS];
   unsigned int global_seed = 0; // (unsigned)time(NULL);
 
-  printf("Benchmarking move_box in %s-threaded mode...\n", use_multi_threaded ? "multi" : "single");
+  float max = fminf(Collision.m_MapData.width * 32.f, Collision.m_MapData.height * 32.f) - 128.f;
+  if (use_batched) {
+    const int mismatches = check_move_box_x8(&Collision, max);
+    if (mismatches) {
+      printf("Error: move_box_x8 differs from move_box in %d of %d calls.\n", mismatches, CHECK_BATCHES * MOVE_BOX_LANES);
+      free_collision(&Collision);
+      return 1;
+    }
+    printf("move_box_x8 matches move_box in %d calls.\n", CHECK_BATCHES * MOVE_BOX_LANES);
+  }
+
+  printf("Benchmarking %s in %s-threaded mode...\n", use_batched ? "move_box_x8" : "move_box", use_multi_threaded ? "multi" : "single");
   if (use_multi_threaded)
     printf("Using %d threads with OpenMP.\n", omp_get_max_threads());
 
-  float max = fminf(Collision.m_MapData.width * 32.f, Collision.m_MapData.height * 32.f) - 128.f;
+  const int tlb_counter = open_tlb_miss_counter();
+  long long tlb_misses = 0;
 
   for (int run = 0; run < NUM_RUNS; run++) {
     double StartTime, ElapsedTime;
     unsigned int run_seed = global_seed ^ (run * 0x9E3779B9u);
 
+    enable_tlb_miss_counter(tlb_counter, true);
     if (use_multi_threaded) {
       StartTime = omp_get_wtime();
 #pragma omp parallel for
       for (int i = 0; i < ITERATIONS; ++i) {
         unsigned int local_seed = run_seed ^ i;
+        if (use_batched) {
+          for (int t = 0; t < TICKS_PER_ITERATION; t += MOVE_BOX_LANES)
+            random_move_box_x8(&Collision, &local_seed, max);
+          continue;
+        }
         for (int t = 0; t < TICKS_PER_ITERATION; ++t) {
           // Generate synthetic random positions and velocities
           mvec2 Pos = vec2_init(fast_rand_float(&local_seed, 128.0f, max), fast_rand_float(&local_seed, 128.0f, max));
@@ -139,6 +288,11 @@ int main(int argc, char *argv[]) {
       StartTime = omp_get_wtime();
       for (int i = 0; i < ITERATIONS; ++i) {
         unsigned int local_seed = run_seed ^ i;
+        if (use_batched) {
+          for (int t = 0; t < TICKS_PER_ITERATION; t += MOVE_BOX_LANES)
+            random_move_box_x8(&Collision, &local_seed, max);
+          continue;
+        }
         for (int t = 0; t < TICKS_PER_ITERATION; ++t) {
           mvec2 Pos = vec2_init(fast_rand_float(&local_seed, 128.0f, max), fast_rand_float(&local_seed, 128.0f, max));
           mvec2 Vel = vec2_init(fast_rand_float(&local_seed, -32.0f, 32.0f), fast_rand_float(&local_seed, -32.0f, 32.0f));
@@ -150,6 +304,7 @@ int main(int argc, char *argv[]) {
       ElapsedTime = omp_get_wtime() - StartTime;
     }
 
+    enable_tlb_miss_counter(tlb_counter, false);
     aTPSValues[run] = (double)TOTAL_TICKS / ElapsedTime;
     print_progress(run + 1, NUM_RUNS, ElapsedTime);
   }
@@ -166,6 +321,11 @@ int main(int argc, char *argv[]) {
   printf("Range (min … max):\t\t%s … ", aBuf);
   format_int((int)stats.max, aBuf);
   printf("%s calls/s\t%d runs\n", aBuf, NUM_RUNS);
+  tlb_misses = read_tlb_miss_counter(tlb_counter);
+  if (tlb_counter >= 0)
+    printf("dTLB load misses:\t\t%.4f per call\n", (double)tlb_misses / ((double)TOTAL_TICKS * NUM_RUNS));
+  else
+    printf("dTLB load misses:\t\tnot available (perf_event_paranoid?)\n");
 
   free_collision(&Collision);
   return 0;
@@ -0,0 +1,202 @@
+#include "ddnet_map_loader.h"
+#include <ddnet_physics/collision.h>
+#include <ddnet_physics/gamecore.h>
+#include <omp.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_SEGMENTS 100
+#define MAX_SEGMENT_TICKS 200
+#define MAX_TEES 8
+#define NUM_RUNS 5
+
+// wc_tick_n and wc_tick_repeat against calling wc_tick for every tick. Every segment holds the inputs of all tees for a while, most tees
+// get no input at all and come to rest, some keep killing themselves and wait for the respawn, others run into freeze. The trace of
+// wc_tick_n has to match every tick of the plain loop and all worlds have to be in the same state after every segment.
+
+static const int s_aNumTees[] = {1, 3, 8};
+
+// xorshift32
+static inline unsigned int fast_rand_u32(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline int fast_rand_range(unsigned int *state, int min, int max) { return min + (fast_rand_u32(state) % (max - min + 1)); }
+
+// inputs of all tees for the next segment, returns its length
+static int next_segment(SPlayerInput *pInputs, int Num, unsigned int *pSeed) {
+  for (int i = 0; i < Num; ++i) {
+    SPlayerInput *pInput = &pInputs[i];
+    *pInput = (SPlayerInput){0};
+    const int Kind = fast_rand_range(pSeed, 0, 7);
+    if (Kind == 0) {
+      set_flag_kill(pInput, 1);
+    } else if (Kind <= 2) {
+      pInput->m_Direction = fast_rand_range(pSeed, -1, 1);
+      pInput->m_Jump = fast_rand_range(pSeed, 0, 1);
+      pInput->m_Fire = fast_rand_range(pSeed, 0, 1);
+      pInput->m_Hook = fast_rand_range(pSeed, 0, 1);
+      pInput->m_TargetX = fast_rand_range(pSeed, -1000, 1000);
+      pInput->m_TargetY = fast_rand_range(pSeed, -1000, 1000);
+    }
+  }
+  return fast_rand_range(pSeed, 1, MAX_SEGMENT_TICKS);
+}
+
+// everything but the world pointer, the worlds share the collision and tunings
+static bool same_world(const SWorldCore *pA, const SWorldCore *pB) {
+  if (pA->m_GameTick != pB->m_GameTick)
+    return false;
+  const size_t Offset = offsetof(SCharacterCore, m_pCollision);
+  for (int i = 0; i < pA->m_NumCharacters; ++i) {
+    if (memcmp((const char *)&pA->m_pCharacters[i] + Offset, (const char *)&pB->m_pCharacters[i] + Offset, sizeof(SCharacterCore) - Offset))
+      return false;
+  }
+  // field by field, the padding of the switches is never initialized
+  for (int i = 0; i < pA->m_NumSwitches; ++i) {
+    const SSwitch *pSwitchA = &pA->m_pSwitches[i], *pSwitchB = &pB->m_pSwitches[i];
+    if (pSwitchA->m_Status != pSwitchB->m_Status || pSwitchA->m_Initial != pSwitchB->m_Initial || pSwitchA->m_EndTick != pSwitchB->m_EndTick ||
+        pSwitchA->m_Type != pSwitchB->m_Type || pSwitchA->m_LastUpdateTick != pSwitchB->m_LastUpdateTick)
+      return false;
+  }
+  return true;
+}
+
+typedef struct {
+  float m_aPosX[MAX_SEGMENT_TICKS * MAX_TEES];
+  float m_aPosY[MAX_SEGMENT_TICKS * MAX_TEES];
+  float m_aVelX[MAX_SEGMENT_TICKS * MAX_TEES];
+  float m_aVelY[MAX_SEGMENT_TICKS * MAX_TEES];
+  int8_t m_aHookState[MAX_SEGMENT_TICKS * MAX_TEES];
+} STrace;
+
+// returns the number of mismatching checks
+static int run_scenario(SCollision *pCollision, SConfig *pConfig, int NumTees, STrace *pTrace) {
+  SWorldCore Ref = wc_empty(), World = wc_empty(), RefRepeat = wc_empty(), Repeat = wc_empty();
+  wc_init(&Ref, pCollision, pConfig);
+  wc_add_character(&Ref, NumTees);
+  wc_copy_world(&World, &Ref);
+  wc_copy_world(&RefRepeat, &Ref);
+  wc_copy_world(&Repeat, &Ref);
+
+  SPlayerInput aSegment[MAX_TEES], aInputs[MAX_SEGMENT_TICKS * MAX_TEES];
+  unsigned int Seed = 0x9E3779B9u * NumTees;
+  int NumMismatches = 0;
+  for (int s = 0; s < NUM_SEGMENTS; ++s) {
+    const int Ticks = next_segment(aSegment, NumTees, &Seed);
+    for (int t = 0; t < Ticks; ++t)
+      memcpy(&aInputs[t * NumTees], aSegment, NumTees * sizeof(SPlayerInput));
+
+    // new inputs every tick
+    STickTrace Trace = {.m_pPosX = pTrace->m_aPosX,
+                        .m_pPosY = pTrace->m_aPosY,
+                        .m_pVelX = pTrace->m_aVelX,
+                        .m_pVelY = pTrace->m_aVelY,
+                        .m_pHookState = pTrace->m_aHookState};
+    wc_tick_n(&World, aInputs, NumTees, Ticks, &Trace);
+    for (int t = 0; t < Ticks; ++t) {
+      for (int i = 0; i < NumTees; ++i)
+        cc_on_input(&Ref.m_pCharacters[i], &aSegment[i]);
+      wc_tick(&Ref);
+      for (int i = 0; i < NumTees; ++i) {
+        const SCharacterCore *pChar = &Ref.m_pCharacters[i];
+        const int Idx = t * NumTees + i;
+        const float aRef[4] = {vgetx(pChar->m_Pos), vgety(pChar->m_Pos), vgetx(pChar->m_Vel), vgety(pChar->m_Vel)};
+        const float aTrace[4] = {pTrace->m_aPosX[Idx], pTrace->m_aPosY[Idx], pTrace->m_aVelX[Idx], pTrace->m_aVelY[Idx]};
+        if ((memcmp(aRef, aTrace, sizeof(aRef)) || pChar->m_HookState != pTrace->m_aHookState[Idx]) && NumMismatches++ < 10)
+          printf("Mismatch of the trace of tee %d in tick %d of segment %d with %d tees\n", i, t, s, NumTees);
+      }
+    }
+    if (!same_world(&World, &Ref) && NumMismatches++ < 10)
+      printf("Mismatch of wc_tick_n after segment %d with %d tees\n", s, NumTees);
+
+    // the inputs only once
+    for (int i = 0; i < NumTees; ++i) {
+      cc_on_input(&Repeat.m_pCharacters[i], &aSegment[i]);
+      cc_on_input(&RefRepeat.m_pCharacters[i], &aSegment[i]);
+    }
+    wc_tick_repeat(&Repeat, Ticks);
+    for (int t = 0; t < Ticks; ++t)
+      wc_tick(&RefRepeat);
+    if (!same_world(&Repeat, &RefRepeat) && NumMismatches++ < 10)
+      printf("Mismatch of wc_tick_repeat after segment %d with %d tees\n", s, NumTees);
+  }
+
+  wc_free(&Ref);
+  wc_free(&World);
+  wc_free(&RefRepeat);
+  wc_free(&Repeat);
+  return NumMismatches;
+}
+
+// tees that stand around without input after they landed
+static void time_idle(SCollision *pCollision, SConfig *pConfig, int NumTees) {
+  const int Ticks = 10000;
+  SWorldCore Start = wc_empty();
+  wc_init(&Start, pCollision, pConfig);
+  wc_add_character(&Start, NumTees);
+  wc_tick_repeat(&Start, 500);
+
+  double BestLoop = 1e30, BestRepeat = 1e30;
+  for (int run = 0; run < NUM_RUNS; ++run) {
+    SWorldCore World = wc_empty();
+    wc_copy_world(&World, &Start);
+    double StartTime = omp_get_wtime();
+    for (int t = 0; t < Ticks; ++t)
+      wc_tick(&World);
+    const double Loop = omp_get_wtime() - StartTime;
+    wc_free(&World);
+
+    World = wc_empty();
+    wc_copy_world(&World, &Start);
+    StartTime = omp_get_wtime();
+    wc_tick_repeat(&World, Ticks);
+    const double Repeat = omp_get_wtime() - StartTime;
+    wc_free(&World);
+
+    if (Loop < BestLoop)
+      BestLoop = Loop;
+    if (Repeat < BestRepeat)
+      BestRepeat = Repeat;
+  }
+  printf("%d\t%.1f\t\t%.1f\t\t\t%.1fx\n", NumTees, BestLoop * 1e9 / Ticks, BestRepeat * 1e9 / Ticks, BestLoop / BestRepeat);
+  wc_free(&Start);
+}
+
+int main(int argc, char **argv) {
+  map_data_t Map = load_map(argc > 1 ? argv[1] : "maps/Aip-Gores.map");
+  SCollision Collision;
+  if (!init_collision(&Collision, &Map)) {
+    printf("Error: Failed to load collision map.\n");
+    return 1;
+  }
+  (void)Map;
+
+  SConfig Config;
+  init_config(&Config);
+  STrace *pTrace = malloc(sizeof(STrace));
+
+  printf("Resting tees, wc_tick_n and wc_tick_repeat against wc_tick, %d segments\n", NUM_SEGMENTS);
+  printf("tees\tmismatches\n");
+  int NumMismatches = 0;
+  for (size_t n = 0; n < sizeof(s_aNumTees) / sizeof(s_aNumTees[0]); ++n) {
+    const int Mismatches = run_scenario(&Collision, &Config, s_aNumTees[n], pTrace);
+    printf("%d\t%d\n", s_aNumTees[n], Mismatches);
+    NumMismatches += Mismatches;
+  }
+
+  printf("\nIdle tees\ntees\tns/tick wc_tick\tns/tick wc_tick_repeat\tspeedup\n");
+  for (size_t n = 0; n < sizeof(s_aNumTees) / sizeof(s_aNumTees[0]); ++n)
+    time_idle(&Collision, &Config, s_aNumTees[n]);
+
+  free(pTrace);
+  free_collision(&Collision);
+  return NumMismatches != 0;
+}
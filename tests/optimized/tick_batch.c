@@ -0,0 +1,174 @@
+#include "ddnet_map_loader.h"
+#include <ddnet_physics/collision.h>
+#include <ddnet_physics/gamecore.h>
+#include <omp.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TICKS 3000
+#define MAX_WORLDS 32
+
+// wc_tick_batch against calling wc_tick on every world. The batches mix single tee worlds, which go through the lanes, with two tee
+// worlds that take the normal path, and alternate between two collisions of the same map so not every lane shares one. Tees kill
+// themselves now and then and get thrown out of the map, so lanes die in the middle of a batch. Every tee has to be in the same state
+// after every tick.
+
+static const int s_aNumWorlds[] = {1, 3, 7, 8, 9, 13, 21, 32};
+
+// xorshift32
+static inline unsigned int fast_rand_u32(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline int fast_rand_range(unsigned int *state, int min, int max) { return min + (fast_rand_u32(state) % (max - min + 1)); }
+
+static void generate_input(SPlayerInput *pInput, unsigned int *pSeed) {
+  *pInput = (SPlayerInput){0};
+  pInput->m_Direction = fast_rand_range(pSeed, -1, 1);
+  pInput->m_Jump = fast_rand_range(pSeed, 0, 1);
+  pInput->m_Fire = fast_rand_range(pSeed, 0, 1);
+  pInput->m_Hook = fast_rand_range(pSeed, 0, 1);
+  pInput->m_TargetX = fast_rand_range(pSeed, -1000, 1000);
+  pInput->m_TargetY = fast_rand_range(pSeed, -1000, 1000);
+  pInput->m_WantedWeapon = fast_rand_range(pSeed, 0, NUM_WEAPONS - 1);
+  set_flag_kill(pInput, fast_rand_range(pSeed, 0, 300) == 0);
+}
+
+static int num_entities(const SWorldCore *pWorld, int Type) {
+  int Num = 0;
+  for (const SEntity *pEntity = pWorld->m_apFirstEntityTypes[Type]; pEntity; pEntity = pEntity->m_pNextTypeEntity)
+    ++Num;
+  return Num;
+}
+
+// the upper two floats of a vector aren't part of the state, the lanes leave zeros where wc_tick leaves whatever the math gave
+static inline void clear_upper(mvec2 *pVec) { *pVec = vec2_init(vgetx(*pVec), vgety(*pVec)); }
+
+static void canonical_character(SCharacterCore *pOut, const SCharacterCore *pChar) {
+  *pOut = *pChar;
+  clear_upper(&pOut->m_PrevPos);
+  clear_upper(&pOut->m_Pos);
+  clear_upper(&pOut->m_Vel);
+  clear_upper(&pOut->m_HookPos);
+  clear_upper(&pOut->m_HookDir);
+  clear_upper(&pOut->m_HookTeleBase);
+  clear_upper(&pOut->m_Ninja.m_ActivationDir);
+  clear_upper(&pOut->m_TeleGunPos);
+}
+
+// everything but the world pointer of the tees and the entities, which point into their own world
+static bool same_world(const SWorldCore *pA, const SWorldCore *pB) {
+  if (pA->m_GameTick != pB->m_GameTick || pA->m_NumCharacters != pB->m_NumCharacters)
+    return false;
+  const size_t Offset = offsetof(SCharacterCore, m_pCollision);
+  for (int i = 0; i < pA->m_NumCharacters; ++i) {
+    SCharacterCore A, B;
+    canonical_character(&A, &pA->m_pCharacters[i]);
+    canonical_character(&B, &pB->m_pCharacters[i]);
+    if (memcmp((const char *)&A + Offset, (const char *)&B + Offset, sizeof(SCharacterCore) - Offset))
+      return false;
+  }
+  for (int i = 0; i < NUM_WORLD_ENTTYPES; ++i) {
+    if (num_entities(pA, i) != num_entities(pB, i))
+      return false;
+  }
+  return true;
+}
+
+// returns the number of mismatching ticks
+static int run_scenario(SCollision *pCollisions, SConfig *pConfig, int NumWorlds, double *pLoopTime, double *pBatchTime) {
+  SWorldCore aRef[MAX_WORLDS], aBatch[MAX_WORLDS];
+  SWorldCore *apRef[MAX_WORLDS], *apBatch[MAX_WORLDS];
+  for (int w = 0; w < NumWorlds; ++w) {
+    aRef[w] = wc_empty();
+    aBatch[w] = wc_empty();
+    wc_init(&aRef[w], &pCollisions[w & 1], pConfig);
+    // every fifth world holds two tees and can't go on a lane
+    wc_add_character(&aRef[w], w % 5 == 4 ? 2 : 1);
+    wc_copy_world(&aBatch[w], &aRef[w]);
+    apRef[w] = &aRef[w];
+    apBatch[w] = &aBatch[w];
+  }
+
+  unsigned int Seed = 0x2545F491u * NumWorlds;
+  int NumMismatches = 0;
+  *pLoopTime = 0;
+  *pBatchTime = 0;
+  for (int t = 0; t < NUM_TICKS; ++t) {
+    for (int w = 0; w < NumWorlds; ++w) {
+      for (int i = 0; i < aRef[w].m_NumCharacters; ++i) {
+        SPlayerInput Input;
+        generate_input(&Input, &Seed);
+        cc_on_input(&aRef[w].m_pCharacters[i], &Input);
+        cc_on_input(&aBatch[w].m_pCharacters[i], &Input);
+        // fast enough to leave the map in the next tick
+        if (fast_rand_range(&Seed, 0, 400) == 0) {
+          const mvec2 Vel = vec2_init(fast_rand_range(&Seed, 0, 1) ? 20000 : -20000, -20000);
+          aRef[w].m_pCharacters[i].m_Vel = Vel;
+          aBatch[w].m_pCharacters[i].m_Vel = Vel;
+        }
+      }
+    }
+
+    double Start = omp_get_wtime();
+    for (int w = 0; w < NumWorlds; ++w)
+      wc_tick(apRef[w]);
+    *pLoopTime += omp_get_wtime() - Start;
+    Start = omp_get_wtime();
+    wc_tick_batch(apBatch, NumWorlds);
+    *pBatchTime += omp_get_wtime() - Start;
+
+    for (int w = 0; w < NumWorlds; ++w) {
+      if (!same_world(&aRef[w], &aBatch[w])) {
+        if (NumMismatches++ < 10)
+          printf("Mismatch of world %d in tick %d with %d worlds\n", w, t, NumWorlds);
+        // keep going from the same state
+        wc_copy_world(&aBatch[w], &aRef[w]);
+      }
+    }
+  }
+
+  for (int w = 0; w < NumWorlds; ++w) {
+    wc_free(&aRef[w]);
+    wc_free(&aBatch[w]);
+  }
+  return NumMismatches;
+}
+
+int main(int argc, char **argv) {
+  const char *pMap = argc > 1 ? argv[1] : "maps/Aip-Gores.map";
+  SCollision aCollisions[2];
+  for (int i = 0; i < 2; ++i) {
+    map_data_t Map = load_map(pMap);
+    if (!init_collision(&aCollisions[i], &Map)) {
+      printf("Error: Failed to load collision map.\n");
+      return 1;
+    }
+  }
+
+  SConfig Config;
+  init_config(&Config);
+
+  printf("wc_tick_batch against wc_tick, %d ticks\n", NUM_TICKS);
+  printf("worlds\tmismatches\tns/world wc_tick\tns/world wc_tick_batch\n");
+  int NumMismatches = 0;
+  for (size_t n = 0; n < sizeof(s_aNumWorlds) / sizeof(s_aNumWorlds[0]); ++n) {
+    const int NumWorlds = s_aNumWorlds[n];
+    double LoopTime, BatchTime;
+    const int Mismatches = run_scenario(aCollisions, &Config, NumWorlds, &LoopTime, &BatchTime);
+    const double Scale = 1e9 / ((double)NUM_TICKS * NumWorlds);
+    printf("%d\t%d\t\t%.1f\t\t\t%.1f\n", NumWorlds, Mismatches, LoopTime * Scale, BatchTime * Scale);
+    NumMismatches += Mismatches;
+  }
+
+  free_collision(&aCollisions[0]);
+  free_collision(&aCollisions[1]);
+  return NumMismatches != 0;
+}
@@ -0,0 +1,195 @@
+#include "ddnet_map_loader.h"
+#include <ddnet_physics/collision.h>
+#include <ddnet_physics/gamecore.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TICKS 2000
+#define NUM_RUNS 5
+#define MAX_TEES 8
+
+// wc_tick_n against the loop of cc_on_input and wc_tick callers write themselves. The trace has to hold what the loop sees after every
+// tick, and with stop events the call has to end after the first tick a tee died or finished in.
+
+// xorshift32
+static inline unsigned int fast_rand_u32(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline int fast_rand_range(unsigned int *state, int min, int max) { return min + (fast_rand_u32(state) % (max - min + 1)); }
+
+static void generate_inputs(SPlayerInput *pInputs, int Num, unsigned int *pSeed) {
+  for (int i = 0; i < Num; ++i) {
+    SPlayerInput *pInput = &pInputs[i];
+    *pInput = (SPlayerInput){0};
+    pInput->m_Direction = fast_rand_range(pSeed, -1, 1);
+    pInput->m_Jump = fast_rand_range(pSeed, 0, 1);
+    pInput->m_Fire = fast_rand_range(pSeed, 0, 1);
+    pInput->m_Hook = fast_rand_range(pSeed, 0, 1);
+    pInput->m_TargetX = fast_rand_range(pSeed, -1000, 1000);
+    pInput->m_TargetY = fast_rand_range(pSeed, -1000, 1000);
+    pInput->m_WantedWeapon = fast_rand_range(pSeed, 0, NUM_WEAPONS - 1);
+    set_flag_kill(pInput, fast_rand_range(pSeed, 0, 500) == 0);
+  }
+}
+
+typedef struct {
+  float m_aPosX[NUM_TICKS * MAX_TEES];
+  float m_aPosY[NUM_TICKS * MAX_TEES];
+  float m_aVelX[NUM_TICKS * MAX_TEES];
+  float m_aVelY[NUM_TICKS * MAX_TEES];
+  int8_t m_aHookState[NUM_TICKS * MAX_TEES];
+} STrace;
+
+static STickTrace trace_of(STrace *pTrace, int StopOn) {
+  return (STickTrace){.m_pPosX = pTrace->m_aPosX,
+                      .m_pPosY = pTrace->m_aPosY,
+                      .m_pVelX = pTrace->m_aVelX,
+                      .m_pVelY = pTrace->m_aVelY,
+                      .m_pHookState = pTrace->m_aHookState,
+                      .m_StopOn = StopOn};
+}
+
+// the loop callers used to write, returns the tick it would have stopped at like wc_tick_n
+static int tick_loop(SWorldCore *pWorld, const SPlayerInput *pInputs, int NumTicks, STrace *pTrace, int StopOn) {
+  const int Num = pWorld->m_NumCharacters;
+  for (int t = 0; t < NumTicks; ++t) {
+    bool aKilled[MAX_TEES] = {0};
+    for (int i = 0; i < Num; ++i) {
+      aKilled[i] = !pWorld->m_pCharacters[i].m_RespawnDelay && get_flag_kill(&pInputs[t * Num + i]);
+      cc_on_input(&pWorld->m_pCharacters[i], &pInputs[t * Num + i]);
+    }
+    wc_tick(pWorld);
+    bool Stop = false;
+    for (int i = 0; i < Num; ++i) {
+      const SCharacterCore *pChar = &pWorld->m_pCharacters[i];
+      pTrace->m_aPosX[t * Num + i] = vgetx(pChar->m_Pos);
+      pTrace->m_aPosY[t * Num + i] = vgety(pChar->m_Pos);
+      pTrace->m_aVelX[t * Num + i] = vgetx(pChar->m_Vel);
+      pTrace->m_aVelY[t * Num + i] = vgety(pChar->m_Vel);
+      pTrace->m_aHookState[t * Num + i] = pChar->m_HookState;
+      const bool Died = aKilled[i] || pChar->m_RespawnDelay == 25;
+      const bool Finished = pChar->m_FinishTick == pWorld->m_GameTick;
+      Stop |= (StopOn & TICK_STOP_DEATH && Died) || (StopOn & TICK_STOP_FINISH && Finished);
+    }
+    if (Stop)
+      return t + 1;
+  }
+  return NumTicks;
+}
+
+static bool same_trace(const STrace *pA, const STrace *pB, int Num) {
+  return !memcmp(pA->m_aPosX, pB->m_aPosX, Num * sizeof(float)) && !memcmp(pA->m_aPosY, pB->m_aPosY, Num * sizeof(float)) &&
+         !memcmp(pA->m_aVelX, pB->m_aVelX, Num * sizeof(float)) && !memcmp(pA->m_aVelY, pB->m_aVelY, Num * sizeof(float)) &&
+         !memcmp(pA->m_aHookState, pB->m_aHookState, Num);
+}
+
+// returns the number of failed checks
+static int run_scenario(SWorldCore *pStart, const SPlayerInput *pInputs, STrace *pTrace, STrace *pRef) {
+  const int Num = pStart->m_NumCharacters;
+  int NumFailed = 0;
+
+  // full runs and runs that stop at the first death or finish
+  for (int StopOn = 0; StopOn <= (TICK_STOP_DEATH | TICK_STOP_FINISH); StopOn += TICK_STOP_DEATH | TICK_STOP_FINISH) {
+    SWorldCore World = wc_empty(), Ref = wc_empty();
+    wc_copy_world(&World, pStart);
+    wc_copy_world(&Ref, pStart);
+    STickTrace Trace = trace_of(pTrace, StopOn);
+    const int Ticks = wc_tick_n(&World, pInputs, Num, NUM_TICKS, &Trace);
+    const int RefTicks = tick_loop(&Ref, pInputs, NUM_TICKS, pRef, StopOn);
+    if (Ticks != RefTicks || !same_trace(pTrace, pRef, Ticks * Num) || World.m_GameTick != Ref.m_GameTick ||
+        (Ticks < NUM_TICKS && !Trace.m_Stopped)) {
+      printf("Mismatch with %d tees, stop on %d: %d/%d ticks, stopped at %d\n", Num, StopOn, Ticks, RefTicks, Trace.m_Stopped);
+      ++NumFailed;
+    }
+    wc_free(&World);
+    wc_free(&Ref);
+  }
+
+  // wc_tick_n without inputs and trace against wc_tick
+  SWorldCore World = wc_empty(), Ref = wc_empty();
+  wc_copy_world(&World, pStart);
+  wc_copy_world(&Ref, pStart);
+  wc_tick_n(&World, NULL, 0, NUM_TICKS, NULL);
+  for (int t = 0; t < NUM_TICKS; ++t)
+    wc_tick(&Ref);
+  for (int i = 0; i < Num; ++i) {
+    const SCharacterCore *pChar = &World.m_pCharacters[i], *pRefChar = &Ref.m_pCharacters[i];
+    if (memcmp(&pChar->m_Pos, &pRefChar->m_Pos, sizeof(float) * 2) || memcmp(&pChar->m_Vel, &pRefChar->m_Vel, sizeof(float) * 2)) {
+      printf("Mismatch with %d tees without input, tee %d\n", Num, i);
+      ++NumFailed;
+    }
+  }
+  wc_free(&World);
+  wc_free(&Ref);
+  return NumFailed;
+}
+
+static void time_scenario(SWorldCore *pStart, const SPlayerInput *pInputs, STrace *pTrace) {
+  const int Num = pStart->m_NumCharacters;
+  double BestLoop = 1e30, BestN = 1e30;
+  for (int run = 0; run < NUM_RUNS; ++run) {
+    SWorldCore World = wc_empty();
+    wc_copy_world(&World, pStart);
+    double StartTime = omp_get_wtime();
+    tick_loop(&World, pInputs, NUM_TICKS, pTrace, 0);
+    const double Loop = omp_get_wtime() - StartTime;
+    wc_free(&World);
+
+    World = wc_empty();
+    wc_copy_world(&World, pStart);
+    STickTrace Trace = trace_of(pTrace, 0);
+    StartTime = omp_get_wtime();
+    wc_tick_n(&World, pInputs, Num, NUM_TICKS, &Trace);
+    const double N = omp_get_wtime() - StartTime;
+    wc_free(&World);
+
+    if (Loop < BestLoop)
+      BestLoop = Loop;
+    if (N < BestN)
+      BestN = N;
+  }
+  printf("%d\t%.1f\t\t%.1f\t\t%.2fx\n", Num, BestLoop * 1e9 / NUM_TICKS, BestN * 1e9 / NUM_TICKS, BestLoop / BestN);
+}
+
+int main(int argc, char **argv) {
+  map_data_t Map = load_map(argc > 1 ? argv[1] : "maps/Aip-Gores.map");
+  SCollision Collision;
+  if (!init_collision(&Collision, &Map)) {
+    printf("Error: Failed to load collision map.\n");
+    return 1;
+  }
+  (void)Map;
+
+  SConfig Config;
+  init_config(&Config);
+  SPlayerInput *pInputs = malloc(sizeof(SPlayerInput) * NUM_TICKS * MAX_TEES);
+  STrace *pTrace = malloc(sizeof(STrace));
+  STrace *pRef = malloc(sizeof(STrace));
+  unsigned int Seed = 0x9E3779B9u;
+
+  printf("tees\tns/tick loop\tns/tick wc_tick_n\tspeedup\n");
+  int NumFailed = 0;
+  for (int NumTees = 1; NumTees <= MAX_TEES; NumTees *= 2) {
+    SWorldCore World = wc_empty();
+    wc_init(&World, &Collision, &Config);
+    wc_add_character(&World, NumTees);
+    generate_inputs(pInputs, NUM_TICKS * NumTees, &Seed);
+    NumFailed += run_scenario(&World, pInputs, pTrace, pRef);
+    time_scenario(&World, pInputs, pTrace);
+    wc_free(&World);
+  }
+
+  free(pInputs);
+  free(pTrace);
+  free(pRef);
+  free_collision(&Collision);
+  return NumFailed != 0;
+}